@@ -0,0 +1,638 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <math/algebra/affineTransform.h>
+#include <math/algebra/matrix.h>
+#include <math/algebra/quaternion.h>
+#include <math/algebra/vector.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace rev::math;
+
+// Micro benchmarks for the algebra headers.
+// Every benchmark runs an operation over state.range() independent elements, so results are reported as
+// elements per second and can be compared against the hand written scalar baselines next to them.
+
+std::default_random_engine rng;
+std::uniform_real_distribution reals(-1.f, 1.f);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Data set up
+template<class T, size_t m, size_t n>
+void randomize(Matrix<T, m, n>& x)
+{
+	for (size_t i = 0; i < m; ++i)
+		for (size_t j = 0; j < n; ++j)
+			x(i, j) = T(reals(rng));
+}
+
+template<class T, size_t n>
+void randomize(Vector<T, n>& x)
+{
+	for (size_t i = 0; i < n; ++i)
+		x[i] = T(reals(rng));
+}
+
+Quatf randomRotation()
+{
+	Vec3f axis;
+	randomize(axis);
+	return Quatf(normalize(axis), 3.f * reals(rng));
+}
+
+AffineTransform randomTransform()
+{
+	AffineTransform x = AffineTransform::identity();
+	x.setRotation(randomRotation());
+	x.position() = Vec3f(reals(rng), reals(rng), reals(rng));
+	return x;
+}
+
+template<class T>
+std::vector<T> randomArray(size_t size)
+{
+	std::vector<T> result(size);
+	for (auto& x : result)
+		randomize(x);
+	return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Matrix products
+//----------------------------------------------------------------------------------------------------------------------
+// Generic Matrix<T,m,n>::operator*. Naive triple loop, or the SSE path for Mat44f
+template<class T, size_t n>
+static void MatrixProductGeneric(benchmark::State& state)
+{
+	using Mat = Matrix<T, n, n>;
+	const size_t count = state.range();
+	auto a = randomArray<Mat>(count);
+	auto b = randomArray<Mat>(count);
+	std::vector<Mat> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = a[i] * b[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Lazy MatrixProduct expression, evaluated on assignment
+template<class T, size_t n>
+static void MatrixProductExpr(benchmark::State& state)
+{
+	using Mat = Matrix<T, n, n>;
+	const size_t count = state.range();
+	auto a = randomArray<Mat>(count);
+	auto b = randomArray<Mat>(count);
+	std::vector<Mat> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const MatrixExpr<T, n, n, Mat>& ea = a[i];
+			const MatrixExpr<T, n, n, Mat>& eb = b[i];
+			c[i] = ea * eb;
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Scalar baseline. Column major raw arrays, fixed size loops the compiler can fully unroll
+template<class T, size_t n>
+static void MatrixProductScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	std::vector<T> a(count * n * n), b(count * n * n), c(count * n * n);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		a[i] = T(reals(rng));
+		b[i] = T(reals(rng));
+	}
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const T* A = &a[e * n * n];
+			const T* B = &b[e * n * n];
+			T* C = &c[e * n * n];
+			for (size_t j = 0; j < n; ++j)
+				for (size_t i = 0; i < n; ++i)
+				{
+					T accum = A[i] * B[j * n];
+					for (size_t k = 1; k < n; ++k)
+						accum += A[k * n + i] * B[j * n + k];
+					C[j * n + i] = accum;
+				}
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Block and transpose expressions
+//----------------------------------------------------------------------------------------------------------------------
+// Product of the 3x3 rotation blocks of two 4x4 matrices through BlockExpr
+static void BlockProductExpr(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Mat44f>(count);
+	auto b = randomArray<Mat44f>(count);
+	std::vector<Mat33f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Mat44f& ai = a[i];
+			const Mat44f& bi = b[i];
+			c[i] = ai.block<3, 3, 0, 0>() * bi.block<3, 3, 0, 0>();
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BlockProductScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Mat44f>(count);
+	auto b = randomArray<Mat44f>(count);
+	std::vector<Mat33f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const float* A = a[e].data();
+			const float* B = b[e].data();
+			float* C = c[e].data();
+			for (size_t j = 0; j < 3; ++j)
+				for (size_t i = 0; i < 3; ++i)
+					C[j * 3 + i] = A[i] * B[j * 4] + A[4 + i] * B[j * 4 + 1] + A[8 + i] * B[j * 4 + 2];
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class T, size_t n>
+static void TransposeExpr(benchmark::State& state)
+{
+	using Mat = Matrix<T, n, n>;
+	const size_t count = state.range();
+	auto a = randomArray<Mat>(count);
+	std::vector<Mat> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = a[i].transpose();
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class T, size_t n>
+static void TransposeScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	std::vector<T> a(count * n * n), c(count * n * n);
+	for (auto& x : a)
+		x = T(reals(rng));
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const T* A = &a[e * n * n];
+			T* C = &c[e * n * n];
+			for (size_t j = 0; j < n; ++j)
+				for (size_t i = 0; i < n; ++i)
+					C[j * n + i] = A[i * n + j];
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Transposed product, as used when inverting orthonormal rotations
+static void TransposeProductExpr(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Mat33f>(count);
+	auto b = randomArray<Mat33f>(count);
+	std::vector<Mat33f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = a[i].transpose() * b[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Vectors
+//----------------------------------------------------------------------------------------------------------------------
+template<class Vec>
+static void VectorAdd(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Vec>(count);
+	auto b = randomArray<Vec>(count);
+	std::vector<Vec> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = a[i] + b[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Vec>
+static void VectorDot(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Vec>(count);
+	auto b = randomArray<Vec>(count);
+	std::vector<float> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = dot(a[i], b[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Vec>
+static void VectorNormalize(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Vec>(count);
+	std::vector<Vec> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = normalize(a[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void VectorCross(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomArray<Vec3f>(count);
+	auto b = randomArray<Vec3f>(count);
+	std::vector<Vec3f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = cross(a[i], b[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Scalar baseline for all the vector operations above, on raw float3 arrays
+static void Vec3ScalarOps(benchmark::State& state)
+{
+	const size_t count = state.range();
+	const int op = int(state.range(1));
+	std::vector<float> a(3 * count), b(3 * count), c(3 * count);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		a[i] = reals(rng);
+		b[i] = reals(rng);
+	}
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const float* A = &a[3 * e];
+			const float* B = &b[3 * e];
+			float* C = &c[3 * e];
+			switch (op)
+			{
+			case 0: // Add
+				C[0] = A[0] + B[0];
+				C[1] = A[1] + B[1];
+				C[2] = A[2] + B[2];
+				break;
+			case 1: // Dot
+				C[0] = A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+				break;
+			case 2: // Normalize
+			{
+				float invNorm = 1.f / std::sqrt(A[0] * A[0] + A[1] * A[1] + A[2] * A[2]);
+				C[0] = A[0] * invNorm;
+				C[1] = A[1] * invNorm;
+				C[2] = A[2] * invNorm;
+				break;
+			}
+			default: // Cross
+				C[0] = A[1] * B[2] - A[2] * B[1];
+				C[1] = A[2] * B[0] - A[0] * B[2];
+				C[2] = A[0] * B[1] - A[1] * B[0];
+			}
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Quaternions
+//----------------------------------------------------------------------------------------------------------------------
+static std::vector<Quatf> randomRotations(size_t count)
+{
+	std::vector<Quatf> result(count);
+	for (auto& q : result)
+		q = randomRotation();
+	return result;
+}
+
+static void QuaternionProduct(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomRotations(count);
+	auto b = randomRotations(count);
+	std::vector<Quatf> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = a[i] * b[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void QuaternionProductScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	std::vector<float> a(4 * count), b(4 * count), c(4 * count);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		a[i] = reals(rng);
+		b[i] = reals(rng);
+	}
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const float* p = &a[4 * e];
+			const float* q = &b[4 * e];
+			float* r = &c[4 * e];
+			r[0] = p[3] * q[0] + p[0] * q[3] + p[1] * q[2] - p[2] * q[1];
+			r[1] = p[3] * q[1] - p[0] * q[2] + p[1] * q[3] + p[2] * q[0];
+			r[2] = p[3] * q[2] + p[0] * q[1] - p[1] * q[0] + p[2] * q[3];
+			r[3] = p[3] * q[3] - p[0] * q[0] - p[1] * q[1] - p[2] * q[2];
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void QuaternionRotate(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto q = randomRotations(count);
+	auto v = randomArray<Vec3f>(count);
+	std::vector<Vec3f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = q[i].rotate(v[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Rotating through the equivalent matrix is the usual alternative to rotate()
+static void QuaternionToMatrix(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto q = randomRotations(count);
+	std::vector<Mat33f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = (Mat33f)q[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void QuaternionLerp(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto a = randomRotations(count);
+	auto b = randomRotations(count);
+	std::vector<Quatf> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = Quatf::lerp(a[i], b[i], 0.3f);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Affine transforms
+//----------------------------------------------------------------------------------------------------------------------
+static std::vector<AffineTransform> randomTransforms(size_t count)
+{
+	std::vector<AffineTransform> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		result.push_back(randomTransform());
+	return result;
+}
+
+static void OrthoNormalInverse(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto x = randomTransforms(count);
+	std::vector<AffineTransform> c(count, AffineTransform::identity());
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = x[i].orthoNormalInverse();
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void OrthoNormalInverseScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto x = randomTransforms(count);
+	std::vector<Mat44f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const float* A = x[e].matrix().data();
+			float* C = c[e].data();
+			// Transposed rotation
+			for (size_t j = 0; j < 3; ++j)
+			{
+				for (size_t i = 0; i < 3; ++i)
+					C[4 * j + i] = A[4 * i + j];
+				C[4 * j + 3] = 0.f;
+			}
+			// Rotated negative translation
+			for (size_t i = 0; i < 3; ++i)
+				C[12 + i] = -(C[i] * A[12] + C[4 + i] * A[13] + C[8 + i] * A[14]);
+			C[15] = 1.f;
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void TransformPosition(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto x = randomTransforms(count);
+	auto v = randomArray<Vec3f>(count);
+	std::vector<Vec3f> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = x[i].transformPosition(v[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void AffineDeterminant(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto x = randomArray<Mat44f>(count);
+	std::vector<float> c(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			c[i] = affineTransformDeterminant(x[i]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void AffineDeterminantScalar(benchmark::State& state)
+{
+	const size_t count = state.range();
+	std::vector<float> x(16 * count), c(count);
+	for (auto& f : x)
+		f = reals(rng);
+
+	for (auto _ : state)
+	{
+		for (size_t e = 0; e < count; ++e)
+		{
+			const float* A = &x[16 * e]; // Column major
+			c[e] =
+				A[0] * (A[5] * A[10] - A[6] * A[9]) -
+				A[4] * (A[1] * A[10] - A[2] * A[9]) +
+				A[8] * (A[1] * A[6] - A[2] * A[5]);
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Element counts: L1 resident, L2 resident and main memory bound
+#define ALGEBRA_SIZES ->Arg(1 << 6)->Arg(1 << 10)->Arg(1 << 16)
+
+BENCHMARK_TEMPLATE(MatrixProductGeneric, float, 2) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductExpr, float, 2) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductScalar, float, 2) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductGeneric, float, 3) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductExpr, float, 3) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductScalar, float, 3) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductGeneric, float, 4) ALGEBRA_SIZES; // SSE specialization
+BENCHMARK_TEMPLATE(MatrixProductExpr, float, 4) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductScalar, float, 4) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductGeneric, double, 4) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductScalar, double, 4) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductGeneric, float, 8) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(MatrixProductScalar, float, 8) ALGEBRA_SIZES;
+
+BENCHMARK(BlockProductExpr) ALGEBRA_SIZES;
+BENCHMARK(BlockProductScalar) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(TransposeExpr, float, 3) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(TransposeScalar, float, 3) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(TransposeExpr, float, 4) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(TransposeScalar, float, 4) ALGEBRA_SIZES;
+BENCHMARK(TransposeProductExpr) ALGEBRA_SIZES;
+
+BENCHMARK_TEMPLATE(VectorAdd, Vec3f) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(VectorAdd, Vec4f) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(VectorDot, Vec3f) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(VectorDot, Vec4f) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(VectorNormalize, Vec3f) ALGEBRA_SIZES;
+BENCHMARK_TEMPLATE(VectorNormalize, Vec4f) ALGEBRA_SIZES;
+BENCHMARK(VectorCross) ALGEBRA_SIZES;
+BENCHMARK(Vec3ScalarOps)
+->ArgNames({ "count", "op" }) // op: 0 add, 1 dot, 2 normalize, 3 cross
+->ArgsProduct({ { 1 << 6, 1 << 10, 1 << 16 }, { 0, 1, 2, 3 } });
+
+BENCHMARK(QuaternionProduct) ALGEBRA_SIZES;
+BENCHMARK(QuaternionProductScalar) ALGEBRA_SIZES;
+BENCHMARK(QuaternionRotate) ALGEBRA_SIZES;
+BENCHMARK(QuaternionToMatrix) ALGEBRA_SIZES;
+BENCHMARK(QuaternionLerp) ALGEBRA_SIZES;
+
+BENCHMARK(OrthoNormalInverse) ALGEBRA_SIZES;
+BENCHMARK(OrthoNormalInverseScalar) ALGEBRA_SIZES;
+BENCHMARK(TransformPosition) ALGEBRA_SIZES;
+BENCHMARK(AffineDeterminant) ALGEBRA_SIZES;
+BENCHMARK(AffineDeterminantScalar) ALGEBRA_SIZES;
+
+BENCHMARK_MAIN();
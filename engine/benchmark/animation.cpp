@@ -0,0 +1,174 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <gfx/scene/animation/animation.h>
+#include <gfx/scene/animation/clipSampling.h>
+#include <random>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Clip sampled at 30 keys per second, with a random rotation per key
+static Animation createAnimation(size_t numJoints, size_t numKeys)
+{
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> angle(-Pi, Pi);
+	Animation animation;
+	animation.m_rotationChannels.resize(numJoints);
+	for (auto& channel : animation.m_rotationChannels)
+	{
+		for (size_t i = 0; i < numKeys; ++i)
+		{
+			channel.t.push_back(float(i) / 30.f);
+			channel.values.push_back(Quatf({ 0.f, 0.f, 1.f }, angle(rng)));
+		}
+	}
+	return animation;
+}
+
+// Previous implementation of getChannelPose, scanning keys from the start of the channel
+static void linearSearchPose(const Animation& animation, size_t channelNdx, float t, Pose::JointPose& dst)
+{
+	auto& channel = animation.m_rotationChannels[channelNdx];
+	if (t <= channel.t[0])
+	{
+		dst.rotation = channel.values[0];
+		return;
+	}
+	if (t >= channel.t.back())
+	{
+		dst.rotation = channel.values.back();
+		return;
+	}
+	for (size_t i = 0; i < channel.t.size(); ++i)
+	{
+		if (channel.t[i + 1] > t)
+		{
+			auto f = (t - channel.t[i]) / (channel.t[i + 1] - channel.t[i]);
+			dst.rotation = Quatf::lerp(channel.values[i], channel.values[i + 1], f);
+			break;
+		}
+	}
+}
+
+// Plays the clip in a loop at 60 fps
+struct Playback
+{
+	Playback(const Animation& animation) : duration(animation.duration()) {}
+
+	float next()
+	{
+		t += 1.f / 60.f;
+		if (t > duration)
+			t -= duration;
+		return t;
+	}
+
+	float t = 0.f;
+	float duration;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+static void SampleLinearSearch(benchmark::State& state)
+{
+	const auto animation = createAnimation(state.range(0), state.range(1));
+	Pose pose;
+	pose.joints.resize(state.range(0));
+	Playback playback(animation);
+	for (auto _ : state)
+	{
+		const float t = playback.next();
+		for (size_t i = 0; i < pose.joints.size(); ++i)
+			linearSearchPose(animation, i, t, pose.joints[i]);
+		benchmark::DoNotOptimize(pose.joints.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void SampleBinarySearch(benchmark::State& state)
+{
+	const auto animation = createAnimation(state.range(0), state.range(1));
+	Pose pose;
+	Playback playback(animation);
+	for (auto _ : state)
+	{
+		animation.getPose(playback.next(), pose);
+		benchmark::DoNotOptimize(pose.joints.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void SampleCursor(benchmark::State& state)
+{
+	const auto animation = createAnimation(state.range(0), state.range(1));
+	Pose pose;
+	Animation::Cursor cursor;
+	Playback playback(animation);
+	for (auto _ : state)
+	{
+		animation.getPose(playback.next(), pose, cursor);
+		benchmark::DoNotOptimize(pose.joints.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Random seeks through the clip. The cursor can't help, so this is the worst case for it
+static void SampleCursorSeek(benchmark::State& state)
+{
+	const auto animation = createAnimation(state.range(0), state.range(1));
+	Pose pose;
+	Animation::Cursor cursor;
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> time(0.f, animation.duration());
+	for (auto _ : state)
+	{
+		animation.getPose(time(rng), pose, cursor);
+		benchmark::DoNotOptimize(pose.joints.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Whole clip at once, for each implementation and rotation interpolation
+template<void (*sampleClip)(const Animation&, float, Pose&, Animation::Cursor&, RotationInterpolation), RotationInterpolation interpolation>
+static void SampleClip(benchmark::State& state)
+{
+	const auto animation = createAnimation(state.range(0), state.range(1));
+	Pose pose;
+	Animation::Cursor cursor;
+	Playback playback(animation);
+	for (auto _ : state)
+	{
+		sampleClip(animation, playback.next(), pose, cursor, interpolation);
+		benchmark::DoNotOptimize(pose.joints.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+BENCHMARK(SampleLinearSearch)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK(SampleBinarySearch)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK(SampleCursor)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK(SampleCursorSeek)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK_TEMPLATE(SampleClip, scalar::sampleClip, RotationInterpolation::NLerp)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK_TEMPLATE(SampleClip, avx2::sampleClip, RotationInterpolation::NLerp)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK_TEMPLATE(SampleClip, scalar::sampleClip, RotationInterpolation::SLerp)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+BENCHMARK_TEMPLATE(SampleClip, avx2::sampleClip, RotationInterpolation::SLerp)->ArgNames({ "joints", "keys" })->ArgsProduct({ { 200 }, { 100, 1'000 } });
+
+BENCHMARK_MAIN();
@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <core/tasks/threadPool.h>
+#include <game/scene/component.h>
+#include <game/scene/ecs/entityWorld.h>
+#include <game/scene/sceneNode.h>
+#include <thread>
+#include <vector>
+
+using namespace rev::game;
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+
+// Per node state of the scene node baseline, updated through a virtual call per component
+class Mover : public Component
+{
+public:
+	void update(float dt) override
+	{
+		position.x += velocity.x * dt;
+		position.y += velocity.y * dt;
+		position.z += velocity.z * dt;
+	}
+
+	Position position = { 0.f, 0.f, 0.f };
+	Velocity velocity = { 1.f, 2.f, 3.f };
+};
+
+static void move(Position& position, const Velocity& velocity, float dt)
+{
+	position.x += velocity.x * dt;
+	position.y += velocity.y * dt;
+	position.z += velocity.z * dt;
+}
+
+// A flat list of children under a single root, with a Mover each
+static std::shared_ptr<SceneNode> createSceneNodes(size_t numNodes)
+{
+	auto root = std::make_shared<SceneNode>();
+	for (size_t i = 0; i < numNodes; ++i)
+		root->createChild("")->addComponent<Mover>();
+	return root;
+}
+
+static void createEntities(EntityWorld& world, size_t numEntities)
+{
+	for (size_t i = 0; i < numEntities; ++i)
+		world.create(Position{ 0.f, 0.f, 0.f }, Velocity{ 1.f, 2.f, 3.f });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+static void SceneNodeUpdate(benchmark::State& state)
+{
+	auto root = createSceneNodes(state.range(0));
+	for (auto _ : state)
+		root->update(0.01f);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void SceneNodeTraverseComponents(benchmark::State& state)
+{
+	auto root = createSceneNodes(state.range(0));
+	for (auto _ : state)
+	{
+		root->traverseComponents<Mover>([](SceneNode&, Mover& mover) {
+			move(mover.position, mover.velocity, 0.01f);
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void EntityForEach(benchmark::State& state)
+{
+	EntityWorld world;
+	createEntities(world, state.range(0));
+	for (auto _ : state)
+	{
+		world.forEach<Position, Velocity>([](Position& position, const Velocity& velocity) {
+			move(position, velocity, 0.01f);
+		});
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void EntityForEachChunk(benchmark::State& state)
+{
+	EntityWorld world;
+	createEntities(world, state.range(0));
+	for (auto _ : state)
+	{
+		world.forEachChunk<Position, Velocity>([](size_t count, Position* positions, const Velocity* velocities) {
+			for (size_t i = 0; i < count; ++i)
+				move(positions[i], velocities[i], 0.01f);
+		});
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void EntityParallelForEach(benchmark::State& state)
+{
+	EntityWorld world;
+	createEntities(world, state.range(0));
+	rev::core::ThreadPool pool(std::thread::hardware_concurrency() - 1);
+	for (auto _ : state)
+	{
+		world.parallelForEach<Position, Velocity>(pool, [](Position& position, const Velocity& velocity) {
+			move(position, velocity, 0.01f);
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+BENCHMARK(SceneNodeUpdate)->Arg(10'000)->Arg(100'000);
+BENCHMARK(SceneNodeTraverseComponents)->Arg(10'000)->Arg(100'000);
+BENCHMARK(EntityForEach)->Arg(10'000)->Arg(100'000);
+BENCHMARK(EntityForEachChunk)->Arg(10'000)->Arg(100'000);
+BENCHMARK(EntityParallelForEach)->Arg(10'000)->Arg(100'000);
+
+BENCHMARK_MAIN();
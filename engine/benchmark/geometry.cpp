@@ -0,0 +1,649 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <math/algebra/affineTransform.h>
+#include <math/algebra/matrix.h>
+#include <core/tasks/threadPool.h>
+#include <math/geometry/aabb.h>
+#include <math/geometry/bvh.h>
+#include <math/geometry/frustumCulling.h>
+#include <math/geometry/kdtree.h>
+#include <math/geometry/mesh.h>
+#include <math/geometry/types.h>
+#include <math/geometry/wideBVH.h>
+#include <math/noise.h>
+#include <bit>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace rev::math;
+
+// Benchmarks for the geometry and noise hot paths.
+// All inputs are procedurally generated from fixed seeds, so runs on different commits see exactly the same data
+// and items_per_second can be compared directly.
+
+//----------------------------------------------------------------------------------------------------------------------
+// Procedural inputs
+//----------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	constexpr uint32_t kSeed = 1234;
+
+	std::vector<AABB> randomBoxes(size_t count, float extent, uint32_t seed = kSeed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::uniform_real_distribution<float> halfSize(0.1f, 2.f);
+		std::vector<AABB> boxes;
+		boxes.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Vec3f center(position(rng), position(rng), position(rng));
+			Vec3f half(halfSize(rng), halfSize(rng), halfSize(rng));
+			boxes.emplace_back(center - half, center + half);
+		}
+		return boxes;
+	}
+
+	std::vector<Vec3f> randomPoints(size_t count, float extent, uint32_t seed = kSeed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::vector<Vec3f> points(count);
+		for (auto& p : points)
+			p = Vec3f(position(rng), position(rng), position(rng));
+		return points;
+	}
+
+	std::vector<Ray::Implicit> randomRays(size_t count, float extent, uint32_t seed = kSeed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::uniform_real_distribution<float> direction(-1.f, 1.f);
+		std::vector<Ray::Implicit> rays;
+		rays.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Vec3f dir(direction(rng), direction(rng), direction(rng));
+			Ray ray(Vec3f(position(rng), position(rng), position(rng)), normalize(dir));
+			rays.push_back(ray.implicit());
+		}
+		return rays;
+	}
+
+	std::vector<Mat44f> randomTransforms(size_t count, uint32_t seed = kSeed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> reals(-1.f, 1.f);
+		std::vector<Mat44f> transforms(count);
+		for (auto& m : transforms)
+		{
+			AffineTransform x = AffineTransform::identity();
+			Vec3f axis = normalize(Vec3f(reals(rng), reals(rng), reals(rng)));
+			x.setRotation(Quatf(axis, 3.f * reals(rng)));
+			x.position() = 10.f * Vec3f(reals(rng), reals(rng), reals(rng));
+			m = x.matrix();
+		}
+		return transforms;
+	}
+
+	// Regular grid of triangles displaced by a height field, with roughly numTriangles triangles
+	struct GridMesh
+	{
+		std::vector<Vec3f> positions;
+		std::vector<Vec2f> uvs;
+		std::vector<uint32_t> indices;
+	};
+
+	GridMesh gridMesh(size_t numTriangles)
+	{
+		const auto side = std::max<uint32_t>(1, uint32_t(std::sqrt(numTriangles / 2.0)));
+		const uint32_t rowSize = side + 1;
+		GridMesh mesh;
+		mesh.positions.reserve(rowSize * rowSize);
+		mesh.uvs.reserve(rowSize * rowSize);
+		for (uint32_t j = 0; j < rowSize; ++j)
+			for (uint32_t i = 0; i < rowSize; ++i)
+			{
+				float u = float(i) / side;
+				float v = float(j) / side;
+				mesh.positions.emplace_back(u, 0.1f * std::sin(20.f * u) * std::cos(13.f * v), v);
+				mesh.uvs.emplace_back(u, v);
+			}
+		mesh.indices.reserve(6 * side * side);
+		for (uint32_t j = 0; j < side; ++j)
+			for (uint32_t i = 0; i < side; ++i)
+			{
+				uint32_t v0 = j * rowSize + i;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + rowSize;
+				uint32_t v3 = v2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		return mesh;
+	}
+
+	// Rays cast down onto the unit square covered by gridMesh, from random points above it
+	std::vector<Ray> gridRays(size_t count, uint32_t seed = kSeed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		std::vector<Ray> rays;
+		rays.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Vec3f origin(unit(rng), 1.f, unit(rng));
+			Vec3f target(unit(rng), 0.f, unit(rng));
+			rays.emplace_back(origin, normalize(target - origin));
+		}
+		return rays;
+	}
+
+	// Primary rays of a side x side pinhole camera looking down at gridMesh.
+	// Rays are ordered in 4x2 pixel tiles, so every 8 consecutive rays make a coherent packet
+	std::vector<Ray> cameraRays(uint32_t side)
+	{
+		const Vec3f eye(0.5f, 1.f, 0.5f);
+		std::vector<Ray> rays;
+		rays.reserve(side * side);
+		for (uint32_t tileY = 0; tileY < side; tileY += 2)
+			for (uint32_t tileX = 0; tileX < side; tileX += 4)
+				for (uint32_t j = tileY; j < tileY + 2; ++j)
+					for (uint32_t i = tileX; i < tileX + 4; ++i)
+					{
+						Vec3f target((i + 0.5f) / side, 0.f, (j + 0.5f) / side);
+						rays.emplace_back(eye, normalize(target - eye));
+					}
+		return rays;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Bounding volumes
+//----------------------------------------------------------------------------------------------------------------------
+// One ray against state.range() boxes, the inner loop of any flat ray cast
+static void AABBRayIntersect(benchmark::State& state)
+{
+	const size_t numBoxes = state.range();
+	auto boxes = randomBoxes(numBoxes, 50.f);
+	auto rays = randomRays(64, 50.f);
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		for (auto& ray : rays)
+		{
+			for (auto& box : boxes)
+			{
+				float tEnter;
+				hits += box.intersect(ray, 1000.f, tEnter) ? 1 : 0;
+			}
+		}
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size() * numBoxes);
+	state.counters["hitRate"] = double(hits) / (state.iterations() * rays.size() * numBoxes);
+}
+
+// Frustum culling of state.range() boxes scattered around the camera
+static void FrustumAABBIntersect(benchmark::State& state)
+{
+	const size_t numBoxes = state.range();
+	auto boxes = randomBoxes(numBoxes, 100.f);
+	Frustum frustum(16.f / 9.f, 1.f, 0.1f, 100.f);
+
+	size_t visible = 0;
+	for (auto _ : state)
+	{
+		visible = 0;
+		for (auto& box : boxes)
+			visible += intersect(frustum, box) ? 1 : 0;
+		benchmark::DoNotOptimize(visible);
+	}
+	state.SetItemsProcessed(state.iterations() * numBoxes);
+	state.counters["visible"] = double(visible) / numBoxes;
+}
+
+// Scalar reference for the batch culling benchmarks below, with the same compacted output
+static void FrustumCullScalar(benchmark::State& state)
+{
+	const size_t numBoxes = state.range();
+	auto boxes = randomBoxes(numBoxes, 100.f);
+	Frustum frustum(16.f / 9.f, 1.f, 0.1f, 100.f);
+	std::vector<uint32_t> visible;
+	visible.reserve(numBoxes);
+
+	for (auto _ : state)
+	{
+		visible.clear();
+		for (uint32_t i = 0; i < numBoxes; ++i)
+			if (intersect(frustum, boxes[i]))
+				visible.push_back(i);
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numBoxes);
+}
+
+// cullAABBs over an array of AABBs. Arg 1 is the number of worker threads, 0 for no pool
+static void FrustumCullBatch(benchmark::State& state)
+{
+	const size_t numBoxes = state.range(0);
+	auto boxes = randomBoxes(numBoxes, 100.f);
+	Frustum frustum(16.f / 9.f, 1.f, 0.1f, 100.f);
+	std::vector<uint32_t> visible;
+	auto pool = state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+
+	for (auto _ : state)
+	{
+		cullAABBs(frustum, boxes, visible, pool.get());
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numBoxes);
+}
+
+// cullAABBs over boxes already stored in SoA layout
+static void FrustumCullBatchSoA(benchmark::State& state)
+{
+	const size_t numBoxes = state.range(0);
+	AABBSoA boxes(randomBoxes(numBoxes, 100.f));
+	Frustum frustum(16.f / 9.f, 1.f, 0.1f, 100.f);
+	std::vector<uint32_t> visible;
+	auto pool = state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+
+	for (auto _ : state)
+	{
+		cullAABBs(frustum, boxes, visible, pool.get());
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * numBoxes);
+}
+
+// World space bounds of state.range() instances
+static void TransformAABB(benchmark::State& state)
+{
+	const size_t count = state.range();
+	auto boxes = randomBoxes(count, 50.f);
+	auto transforms = randomTransforms(count);
+	std::vector<AABB> result(count);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; ++i)
+			result[i] = transforms[i] * boxes[i];
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Mesh processing. Arg is the approximate number of triangles
+//----------------------------------------------------------------------------------------------------------------------
+static void GenerateNormals(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+
+	for (auto _ : state)
+	{
+		auto normals = generateNormals(mesh.positions.size(), mesh.positions.data(), mesh.indices.size(), mesh.indices.data());
+		benchmark::DoNotOptimize(normals.data());
+	}
+	state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+}
+
+static void GenerateTangentSpace(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+	auto normals = generateNormals(mesh.positions.size(), mesh.positions.data(), mesh.indices.size(), mesh.indices.data());
+
+	for (auto _ : state)
+	{
+		auto tangents = generateTangentSpace(
+			mesh.positions.size(),
+			mesh.positions.data(),
+			mesh.uvs.data(),
+			normals.data(),
+			mesh.indices.size(),
+			mesh.indices.data());
+		benchmark::DoNotOptimize(tangents.data());
+	}
+	state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Ray tracing acceleration structures
+//----------------------------------------------------------------------------------------------------------------------
+// BVH build over state.range(0) scattered boxes. Arg 1 is the number of worker threads, 0 for no pool
+static void BVHBuildBoxes(benchmark::State& state)
+{
+	auto boxes = randomBoxes(state.range(0), 100.f);
+	auto pool = state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+	BVH::BuildOptions options;
+	options.pool = pool.get();
+
+	BVH bvh;
+	for (auto _ : state)
+	{
+		bvh.build(boxes, options);
+		benchmark::DoNotOptimize(bvh.nodes().data());
+	}
+	state.SetItemsProcessed(state.iterations() * boxes.size());
+	state.counters["nodes"] = double(bvh.nodes().size());
+	state.counters["depth"] = bvh.depth();
+}
+
+// BVH build over the triangles of a grid mesh. Same args as BVHBuildBoxes
+static void BVHBuildTriangles(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range(0));
+	auto pool = state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+	BVH::BuildOptions options;
+	options.pool = pool.get();
+
+	TriangleBVH bvh;
+	for (auto _ : state)
+	{
+		bvh.build(mesh.positions, mesh.indices, options);
+		benchmark::DoNotOptimize(bvh.bvh().nodes().data());
+	}
+	state.SetItemsProcessed(state.iterations() * bvh.numTriangles());
+}
+
+// Closest hit queries against a grid mesh of state.range() triangles. Items are rays
+static void BVHClosestHit(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+	TriangleBVH bvh;
+	bvh.build(mesh.positions, mesh.indices);
+	auto rays = gridRays(1024);
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		for (auto& ray : rays)
+		{
+			TriangleBVH::Hit hit;
+			hits += bvh.closestHit(ray, 10.f, hit) ? 1 : 0;
+		}
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+	state.counters["hitRate"] = double(hits) / (state.iterations() * rays.size());
+}
+
+// Occlusion queries against the same scene as BVHClosestHit
+static void BVHAnyHit(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+	TriangleBVH bvh;
+	bvh.build(mesh.positions, mesh.indices);
+	auto rays = gridRays(1024);
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		for (auto& ray : rays)
+			hits += bvh.anyHit(ray, 10.f) ? 1 : 0;
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+}
+
+// Single ray closest hits against an 8-wide BVH, same scene and rays as BVHClosestHit
+static void WideBVHClosestHit(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+	WideBVH bvh;
+	bvh.build(mesh.positions, mesh.indices);
+	auto rays = gridRays(1024);
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		for (auto& ray : rays)
+		{
+			WideBVH::Hit hit;
+			hits += bvh.closestHit(ray, 10.f, hit) ? 1 : 0;
+		}
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+	state.counters["hitRate"] = double(hits) / (state.iterations() * rays.size());
+}
+
+static void WideBVHAnyHit(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range());
+	WideBVH bvh;
+	bvh.build(mesh.positions, mesh.indices);
+	auto rays = gridRays(1024);
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		for (auto& ray : rays)
+			hits += bvh.anyHit(ray, 10.f) ? 1 : 0;
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+}
+
+// Coherent primary rays against an 8-wide BVH of state.range(0) triangles.
+// Arg 1 selects single ray (0) or 8-ray packet (1) traversal
+static void WideBVHPrimaryRays(benchmark::State& state)
+{
+	auto mesh = gridMesh(state.range(0));
+	WideBVH bvh;
+	bvh.build(mesh.positions, mesh.indices);
+	auto rays = cameraRays(512);
+	const bool packets = state.range(1) != 0;
+
+	size_t hits = 0;
+	for (auto _ : state)
+	{
+		WideBVH::Hit hit[WideBVH::kWidth];
+		if (packets)
+		{
+			for (size_t i = 0; i < rays.size(); i += WideBVH::kWidth)
+				hits += std::popcount(bvh.closestHit(std::span(rays).subspan(i, WideBVH::kWidth), 10.f, hit));
+		}
+		else
+		{
+			for (auto& ray : rays)
+				hits += bvh.closestHit(ray, 10.f, hit[0]) ? 1 : 0;
+		}
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+	state.counters["hitRate"] = double(hits) / (state.iterations() * rays.size());
+}
+
+// Kd-tree build over state.range(0) points. Arg 1 is the number of worker threads, 0 for no pool
+static void KdtreeBuild(benchmark::State& state)
+{
+	auto points = randomPoints(state.range(0), 100.f);
+	auto pool = state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+
+	Kdtree<3, false> tree;
+	for (auto _ : state)
+	{
+		tree.build(points, pool.get());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * points.size());
+}
+
+// k nearest neighbour queries among state.range(0) points, with k = state.range(1). Items are queries
+static void KdtreeNearest(benchmark::State& state)
+{
+	Kdtree<3, false> tree(randomPoints(state.range(0), 100.f));
+	auto queries = randomPoints(1024, 100.f, kSeed + 1);
+	const size_t k = state.range(1);
+	std::vector<Kdtree<3, false>::Neighbor> neighbors;
+
+	for (auto _ : state)
+	{
+		for (auto& q : queries)
+		{
+			tree.nearest(q, k, neighbors);
+			benchmark::DoNotOptimize(neighbors.data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+// Radius queries that find about 8 points each, like welding vertices of a dense mesh
+static void KdtreeRadiusSearch(benchmark::State& state)
+{
+	const size_t numPoints = state.range();
+	Kdtree<3, false> tree(randomPoints(numPoints, 100.f));
+	auto queries = randomPoints(1024, 100.f, kSeed + 1);
+	const float radius = 200.f * std::cbrt(8.f / (4.19f * numPoints)); // A sphere holding 8 / numPoints of the volume
+	std::vector<Kdtree<3, false>::Neighbor> neighbors;
+
+	size_t found = 0;
+	for (auto _ : state)
+	{
+		for (auto& q : queries)
+		{
+			tree.radiusSearch(q, radius, neighbors);
+			found += neighbors.size();
+		}
+		benchmark::DoNotOptimize(found);
+	}
+	state.SetItemsProcessed(state.iterations() * queries.size());
+	state.counters["found"] = double(found) / (state.iterations() * queries.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Noise. Arg is the side of the sampled grid
+//----------------------------------------------------------------------------------------------------------------------
+static void PerlinNoise2D(benchmark::State& state)
+{
+	const auto side = size_t(state.range());
+	const float scale = 8.f / side;
+	std::vector<float> grid(side * side);
+
+	for (auto _ : state)
+	{
+		for (size_t j = 0; j < side; ++j)
+			for (size_t i = 0; i < side; ++i)
+				grid[j * side + i] = perlinNoise(i * scale, j * scale);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * grid.size());
+}
+
+static void PerlinNoise3D(benchmark::State& state)
+{
+	const auto side = size_t(state.range());
+	const float scale = 8.f / side;
+	std::vector<float> grid(side * side * side);
+
+	for (auto _ : state)
+	{
+		for (size_t k = 0; k < side; ++k)
+			for (size_t j = 0; j < side; ++j)
+				for (size_t i = 0; i < side; ++i)
+					grid[(k * side + j) * side + i] = perlinNoise(i * scale, j * scale, k * scale);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * grid.size());
+}
+
+// Simplex noise only comes in 2D. PerlinNoise3D covers 3D noise
+static void SimplexNoise2D(benchmark::State& state)
+{
+	const auto side = size_t(state.range());
+	const float scale = 8.f / side;
+	std::vector<float> grid(side * side);
+
+	for (auto _ : state)
+	{
+		for (size_t j = 0; j < side; ++j)
+			for (size_t i = 0; i < side; ++i)
+				grid[j * side + i] = simplexNoise(i * scale, j * scale);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * grid.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+BENCHMARK(AABBRayIntersect)->Arg(1 << 8)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK(FrustumAABBIntersect)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+BENCHMARK(FrustumCullScalar)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(FrustumCullBatch)
+->ArgNames({ "boxes", "threads" })
+->ArgsProduct({ { 1'000, 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime();
+BENCHMARK(FrustumCullBatchSoA)
+->ArgNames({ "boxes", "threads" })
+->ArgsProduct({ { 1'000, 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime();
+BENCHMARK(TransformAABB)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+BENCHMARK(GenerateNormals)
+->Arg(10'000)
+->Arg(100'000)
+->Arg(1'000'000)
+->Arg(10'000'000)
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK(GenerateTangentSpace)
+->Arg(10'000)
+->Arg(100'000)
+->Arg(1'000'000)
+->Arg(10'000'000)
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BVHBuildBoxes)
+->ArgNames({ "boxes", "threads" })
+->ArgsProduct({ { 10'000, 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+BENCHMARK(BVHBuildTriangles)
+->ArgNames({ "triangles", "threads" })
+->ArgsProduct({ { 10'000, 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+BENCHMARK(BVHClosestHit)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BVHAnyHit)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(WideBVHClosestHit)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(WideBVHAnyHit)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(WideBVHPrimaryRays)
+->ArgNames({ "triangles", "packets" })
+->ArgsProduct({ { 10'000, 100'000, 1'000'000 }, { 0, 1 } })
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK(KdtreeBuild)
+->ArgNames({ "points", "threads" })
+->ArgsProduct({ { 10'000, 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+BENCHMARK(KdtreeNearest)
+->ArgNames({ "points", "k" })
+->ArgsProduct({ { 10'000, 1'000'000 }, { 1, 8 } });
+BENCHMARK(KdtreeRadiusSearch)->Arg(10'000)->Arg(1'000'000);
+
+BENCHMARK(PerlinNoise2D)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(PerlinNoise3D)->Arg(16)->Arg(64);
+BENCHMARK(SimplexNoise2D)->Arg(64)->Arg(256)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -19,6 +19,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <benchmark/benchmark.h>
 #include <math/algebra/matrix.h>
+#include <math/algebra/matrixBatch.h>
+#include <math/cpuFeatures.h>
+#include <math/geometry/aabb.h>
+#include <algorithm>
+#include <numeric>
 #include <vector>
 #include <random>
 
@@ -115,6 +120,155 @@ static void ScatteredMatrices(benchmark::State& state)
 	}
 }
 
+// Same random hierarchy as ContiguousMatrixTree, but nodes are sorted by depth so each level can be
+// propagated with a single batched call. World and local matrices are kept in separate arrays.
+template<bool useAVX2>
+static void BatchedMatrixTree(benchmark::State& state)
+{
+	if (useAVX2 && !cpuFeatures().hasAVX2FMA())
+	{
+		state.SkipWithError("AVX2 not supported");
+		return;
+	}
+
+	// -- Set up ----
+	const size_t numMatrices = state.range();
+	std::vector<uint32_t> parentIndices(numMatrices);
+	std::vector<uint32_t> depth(numMatrices);
+	parentIndices[0] = 0;
+	depth[0] = 0;
+	std::uniform_int_distribution<size_t> ints(0, numMatrices);
+	for (size_t i = 1; i < numMatrices; ++i)
+	{
+		parentIndices[i] = uint32_t(ints(rng) % i);
+		depth[i] = depth[parentIndices[i]] + 1;
+	}
+
+	// Sort by depth, and remap parent indices to the new order
+	std::vector<uint32_t> order(numMatrices);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+	std::vector<uint32_t> newIndex(numMatrices);
+	for (size_t i = 0; i < numMatrices; ++i)
+		newIndex[order[i]] = uint32_t(i);
+
+	std::vector<Mat44f> local(numMatrices);
+	std::vector<Mat44f> world(numMatrices);
+	std::vector<uint32_t> sortedParents(numMatrices);
+	std::vector<size_t> levelStart = { 0 };
+	for (size_t i = 0; i < numMatrices; ++i)
+	{
+		for (size_t j = 0; j < 16; ++j)
+			local[i].data()[j] = reals(rng);
+		sortedParents[i] = newIndex[parentIndices[order[i]]];
+		if (i > 0 && depth[order[i]] != depth[order[i - 1]])
+			levelStart.push_back(i);
+	}
+	levelStart.push_back(numMatrices);
+
+	// --- Run the actual benchmark ---
+	while (state.KeepRunning())
+	{
+		world[0] = local[0];
+		for (size_t level = 1; level + 1 < levelStart.size(); ++level)
+		{
+			auto begin = levelStart[level];
+			auto count = levelStart[level + 1] - begin;
+			if (useAVX2)
+				avx2::batchMultiply(count, world.data(), &sortedParents[begin], &local[begin], &world[begin]);
+			else
+				sse::batchMultiply(count, world.data(), &sortedParents[begin], &local[begin], &world[begin]);
+		}
+		benchmark::ClobberMemory();
+	}
+}
+
+// Independent products, as in instance updates
+template<bool useAVX2>
+static void BatchMatrixProduct(benchmark::State& state)
+{
+	if (useAVX2 && !cpuFeatures().hasAVX2FMA())
+	{
+		state.SkipWithError("AVX2 not supported");
+		return;
+	}
+
+	const size_t numMatrices = state.range();
+	std::vector<Mat44f> a(numMatrices), b(numMatrices), result(numMatrices);
+	for (size_t i = 0; i < numMatrices; ++i)
+		for (size_t j = 0; j < 16; ++j)
+		{
+			a[i].data()[j] = reals(rng);
+			b[i].data()[j] = reals(rng);
+		}
+
+	while (state.KeepRunning())
+	{
+		if (useAVX2)
+			avx2::batchMultiply(numMatrices, a.data(), b.data(), result.data());
+		else
+			sse::batchMultiply(numMatrices, a.data(), b.data(), result.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * numMatrices);
+}
+
+template<bool useAVX2>
+static void BatchTransformPoints(benchmark::State& state)
+{
+	if (useAVX2 && !cpuFeatures().hasAVX2FMA())
+	{
+		state.SkipWithError("AVX2 not supported");
+		return;
+	}
+
+	const size_t numPoints = state.range();
+	Mat44f m;
+	for (size_t j = 0; j < 16; ++j)
+		m.data()[j] = reals(rng);
+	std::vector<Vec3f> points(numPoints), result(numPoints);
+	for (auto& p : points)
+		p = Vec3f(reals(rng), reals(rng), reals(rng));
+
+	while (state.KeepRunning())
+	{
+		if (useAVX2)
+			avx2::batchTransformPoints(numPoints, m, points.data(), result.data());
+		else
+			sse::batchTransformPoints(numPoints, m, points.data(), result.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * numPoints);
+}
+
+template<bool useAVX2>
+static void BatchTransformAABBs(benchmark::State& state)
+{
+	if (useAVX2 && !cpuFeatures().hasAVX2FMA())
+	{
+		state.SkipWithError("AVX2 not supported");
+		return;
+	}
+
+	const size_t numBoxes = state.range();
+	Mat44f m;
+	for (size_t j = 0; j < 16; ++j)
+		m.data()[j] = reals(rng);
+	std::vector<AABB> boxes(numBoxes), result(numBoxes);
+	for (auto& box : boxes)
+		box = AABB(Vec3f(reals(rng), reals(rng), reals(rng)), reals(rng));
+
+	while (state.KeepRunning())
+	{
+		if (useAVX2)
+			avx2::batchTransformAABBs(numBoxes, m, boxes.data(), result.data());
+		else
+			sse::batchTransformAABBs(numBoxes, m, boxes.data(), result.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * numBoxes);
+}
+
 BENCHMARK(ContiguousMatrixTree)
 // Initial two are to avoid outlayers
 ->Arg(2 << 4) // Totally fits in L1 cache
@@ -149,4 +303,28 @@ BENCHMARK(ScatteredMatrices)
 //->Arg(2 << 18) // Exact L3 size
 //->Arg(2 << 24); // Main memory
 
+// Batched kernels, to compare against the trees above
+BENCHMARK_TEMPLATE(BatchedMatrixTree, false)
+->Arg(2 << 6) // Totally fits in L1 cache
+->Arg(2 << 8) // Totally fits in L1 cache
+->Arg(2 << 9) // Exact size of L1 cache
+->Arg(2 << 10) // Twice the size of L1 cache
+->Arg(2 << 12) // Totally fits in L2 size
+->Arg(2 << 14); // Exact L2 size
+
+BENCHMARK_TEMPLATE(BatchedMatrixTree, true)
+->Arg(2 << 6) // Totally fits in L1 cache
+->Arg(2 << 8) // Totally fits in L1 cache
+->Arg(2 << 9) // Exact size of L1 cache
+->Arg(2 << 10) // Twice the size of L1 cache
+->Arg(2 << 12) // Totally fits in L2 size
+->Arg(2 << 14); // Exact L2 size
+
+BENCHMARK_TEMPLATE(BatchMatrixProduct, false)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+BENCHMARK_TEMPLATE(BatchMatrixProduct, true)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+BENCHMARK_TEMPLATE(BatchTransformPoints, false)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+BENCHMARK_TEMPLATE(BatchTransformPoints, true)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+BENCHMARK_TEMPLATE(BatchTransformAABBs, false)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+BENCHMARK_TEMPLATE(BatchTransformAABBs, true)->Arg(2 << 8)->Arg(2 << 12)->Arg(2 << 16);
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,143 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <core/tasks/parallelFor.h>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace rev::core;
+
+std::default_random_engine rng;
+std::uniform_real_distribution reals(0.f, 100.f);
+
+// The benchmark argument is the number of threads taking part in the work, including the calling one
+static std::unique_ptr<ThreadPool> createPool(const benchmark::State& state)
+{
+	return std::make_unique<ThreadPool>(size_t(state.range() - 1));
+}
+
+static std::vector<float> randomData(size_t n)
+{
+	std::vector<float> data(n);
+	for (auto& x : data)
+		x = reals(rng);
+	return data;
+}
+
+// Cheap per element work. Mostly bound by memory bandwidth
+static void ParallelForLight(benchmark::State& state)
+{
+	auto pool = createPool(state);
+	const size_t n = 1 << 22;
+	auto src = randomData(n);
+	std::vector<float> dst(n);
+
+	for (auto _ : state)
+	{
+		parallelFor(*pool, 0, n, 4096, [&](size_t i) {
+			dst[i] = 2.f * src[i] + 1.f;
+		});
+		benchmark::DoNotOptimize(dst.data());
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Expensive per element work. Should scale linearly with the number of cores
+static void ParallelForHeavy(benchmark::State& state)
+{
+	auto pool = createPool(state);
+	const size_t n = 1 << 16;
+	auto src = randomData(n);
+	std::vector<float> dst(n);
+
+	for (auto _ : state)
+	{
+		parallelFor(*pool, 0, n, 256, [&](size_t i) {
+			float x = src[i];
+			for (int k = 0; k < 32; ++k)
+				x = std::sin(x) * 3.f + std::sqrt(x * x + 1.f);
+			dst[i] = x;
+		});
+		benchmark::DoNotOptimize(dst.data());
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Irregular per element cost, to stress load balancing
+static void ParallelForUnbalanced(benchmark::State& state)
+{
+	auto pool = createPool(state);
+	const size_t n = 1 << 18;
+	auto src = randomData(n);
+	std::vector<float> dst(n);
+
+	for (auto _ : state)
+	{
+		parallelFor(*pool, 0, n, 64, [&](size_t i) {
+			float x = src[i];
+			const int iterations = (i % 1024 < 64) ? 256 : 4; // A few hot spots
+			for (int k = 0; k < iterations; ++k)
+				x = std::sin(x) * 3.f + std::sqrt(x * x + 1.f);
+			dst[i] = x;
+		});
+		benchmark::DoNotOptimize(dst.data());
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void ParallelReduceSum(benchmark::State& state)
+{
+	auto pool = createPool(state);
+	const size_t n = 1 << 22;
+	auto src = randomData(n);
+
+	for (auto _ : state)
+	{
+		double sum = parallelReduce(*pool, 0, n, 4096, 0.0,
+			[&](size_t begin, size_t end, double partial) {
+				for (size_t i = begin; i < end; ++i)
+					partial += src[i];
+				return partial;
+			},
+			[](double a, double b) { return a + b; });
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Scale from one thread up to every hardware thread in the machine
+static void ThreadScaling(benchmark::internal::Benchmark* b)
+{
+	const int maxThreads = std::max(1, int(std::thread::hardware_concurrency()));
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+		b->Arg(threads);
+	b->Arg(maxThreads);
+	b->ArgName("threads");
+	b->UseRealTime(); // Wall time is what matters for parallel work
+}
+
+BENCHMARK(ParallelForLight)->Apply(ThreadScaling);
+BENCHMARK(ParallelForHeavy)->Apply(ThreadScaling);
+BENCHMARK(ParallelForUnbalanced)->Apply(ThreadScaling);
+BENCHMARK(ParallelReduceSum)->Apply(ThreadScaling);
+
+BENCHMARK_MAIN();
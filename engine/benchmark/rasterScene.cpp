@@ -0,0 +1,125 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <core/tasks/threadPool.h>
+#include <gfx/renderer/RasterScene.h>
+#include <math/geometry/types.h>
+#include <random>
+#include <vector>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Scene with state.range(0) instances of a few small meshes scattered around the origin.
+// Only CPU side data is filled in, so no render context is needed.
+static std::unique_ptr<RasterScene> createScene(const benchmark::State& state)
+{
+	constexpr uint32_t numMeshes = 64;
+	constexpr uint32_t primitivesPerMesh = 2;
+	const Vec3f positions[3] = { Vec3f(0.f, 0.f, 0.f), Vec3f(1.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f) };
+	const Vec3f normals[3] = { Vec3f(0.f, 0.f, 1.f), Vec3f(0.f, 0.f, 1.f), Vec3f(0.f, 0.f, 1.f) };
+	const Vec4f tangents[3] = { Vec4f(1.f, 0.f, 0.f, 1.f), Vec4f(1.f, 0.f, 0.f, 1.f), Vec4f(1.f, 0.f, 0.f, 1.f) };
+	const Vec2f uvs[3] = { Vec2f(0.f, 0.f), Vec2f(1.f, 0.f), Vec2f(0.f, 1.f) };
+	const uint32_t indices[3] = { 0, 1, 2 };
+
+	auto scene = std::make_unique<RasterScene>();
+	auto& heap = scene->m_geometry;
+	uint32_t material = heap.addMaterial(PBRMaterial());
+	for (uint32_t i = 0; i < numMeshes; ++i)
+	{
+		RasterHeap::Mesh mesh;
+		mesh.firstPrimitive = (uint32_t)heap.addPrimitiveData(3, positions, normals, tangents, uvs, 3, indices, material);
+		for (uint32_t p = 1; p < primitivesPerMesh; ++p)
+			heap.addPrimitiveData(3, positions, normals, tangents, uvs, 3, indices, material);
+		mesh.endPrimitive = mesh.firstPrimitive + primitivesPerMesh;
+		heap.addMesh(mesh);
+	}
+
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> coord(-500.f, 500.f);
+	std::uniform_int_distribution<uint32_t> meshNdx(0, numMeshes - 1);
+	for (int64_t i = 0; i < state.range(0); ++i)
+	{
+		Mat44f worldMtx = Mat44f::identity();
+		worldMtx(0, 3) = coord(rng);
+		worldMtx(1, 3) = coord(rng);
+		worldMtx(2, 3) = coord(rng);
+		scene->addInstance(worldMtx, meshNdx(rng));
+	}
+	return scene;
+}
+
+static std::unique_ptr<rev::core::ThreadPool> createPool(const benchmark::State& state)
+{
+	return state.range(1) ? std::make_unique<rev::core::ThreadPool>(state.range(1)) : nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Cull instances against a camera at the origin and build draws for the visible ones.
+// Arg 1 is the number of worker threads, 0 for no pool
+static void SceneVisibleDraws(benchmark::State& state)
+{
+	auto scene = createScene(state);
+	auto pool = createPool(state);
+	scene->setCullingPool(pool.get());
+	scene->instanceWorldBounds(); // Bounds only change with the instances
+	const Frustum frustum(16.f / 9.f, 1.f, 0.1f, 1000.f);
+	std::vector<RasterQueue::Draw> draws;
+
+	for (auto _ : state)
+	{
+		scene->visibleDraws(frustum, draws);
+		benchmark::DoNotOptimize(draws.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	size_t drawnInstances = 0;
+	for (auto& draw : draws)
+		drawnInstances += draw.numInstances;
+	state.counters["draws"] = double(draws.size());
+	state.counters["drawnInstances"] = double(drawnInstances);
+}
+
+// Recompute the world space bounds of every instance, as needed after instances change
+static void SceneWorldBounds(benchmark::State& state)
+{
+	auto scene = createScene(state);
+	auto pool = createPool(state);
+	scene->setCullingPool(pool.get());
+	scene->instanceWorldMatrices(); // Sort once, outside of the loop
+
+	for (auto _ : state)
+	{
+		scene->addInstance(Mat44f::identity(), 63); // Keeps instances sorted, but invalidates bounds
+		benchmark::DoNotOptimize(scene->instanceWorldBounds().minX());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+BENCHMARK(SceneVisibleDraws)
+->ArgNames({ "instances", "threads" })
+->ArgsProduct({ { 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime();
+BENCHMARK(SceneWorldBounds)
+->ArgNames({ "instances", "threads" })
+->ArgsProduct({ { 100'000, 1'000'000 }, { 0, 3 } })
+->UseRealTime();
+
+BENCHMARK_MAIN();
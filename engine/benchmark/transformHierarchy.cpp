@@ -0,0 +1,123 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Revolution Engine
+//----------------------------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <benchmark/benchmark.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+#include <game/scene/transform/transformHierarchy.h>
+#include <random>
+#include <vector>
+
+using namespace rev::game;
+using namespace rev::math;
+
+// Same random hierarchy as the ContiguousMatrixTree benchmark: a single root, and each node parented to a random
+// node added before it.
+static std::vector<uint32_t> randomParents(size_t numNodes)
+{
+	std::default_random_engine rng;
+	std::vector<uint32_t> parents(numNodes, TransformHierarchy::kNoParent);
+	for (size_t i = 1; i < numNodes; ++i)
+		parents[i] = uint32_t(rng() % i);
+	return parents;
+}
+
+static Mat44f randomTransform(std::default_random_engine& rng)
+{
+	std::uniform_real_distribution<float> coord(-1.f, 1.f);
+	Mat44f m = Mat44f::identity();
+	for (int i = 0; i < 3; ++i)
+		m(i, 3) = coord(rng);
+	return m;
+}
+
+static TransformHierarchy createHierarchy(size_t numNodes)
+{
+	std::default_random_engine rng;
+	TransformHierarchy hierarchy;
+	for (auto parent : randomParents(numNodes))
+		hierarchy.addNode(randomTransform(rng), parent);
+	hierarchy.update(); // Sort nodes outside of the benchmark loop
+	return hierarchy;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Moving the root, so every world matrix is recomputed
+static void HierarchyFullUpdate(benchmark::State& state)
+{
+	auto hierarchy = createHierarchy(state.range(0));
+	std::default_random_engine rng;
+	for (auto _ : state)
+	{
+		hierarchy.setLocal(0, randomTransform(rng));
+		benchmark::DoNotOptimize(hierarchy.update());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Moving state.range(1) random nodes per update. Only their subtrees are recomputed
+static void HierarchyPartialUpdate(benchmark::State& state)
+{
+	auto hierarchy = createHierarchy(state.range(0));
+	std::default_random_engine rng;
+	size_t numUpdated = 0;
+	for (auto _ : state)
+	{
+		for (int64_t i = 0; i < state.range(1); ++i)
+			hierarchy.setLocal(uint32_t(1 + rng() % (state.range(0) - 1)), randomTransform(rng));
+		numUpdated += hierarchy.update();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["updatedNodes"] = double(numUpdated) / double(state.iterations());
+}
+
+// Nothing moved
+static void HierarchyStaticUpdate(benchmark::State& state)
+{
+	auto hierarchy = createHierarchy(state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(hierarchy.update());
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Baseline: the same hierarchy as scene nodes with Transform components, updated recursively
+static void SceneNodeUpdate(benchmark::State& state)
+{
+	std::default_random_engine rng;
+	std::vector<std::shared_ptr<SceneNode>> nodes;
+	for (auto parent : randomParents(state.range(0)))
+	{
+		auto node = (parent == TransformHierarchy::kNoParent) ? std::make_shared<SceneNode>() : nodes[parent]->createChild("");
+		node->addComponent<Transform>()->matrix() = randomTransform(rng);
+		nodes.push_back(node);
+	}
+	for (auto _ : state)
+		nodes[0]->update(0.f);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+BENCHMARK(HierarchyFullUpdate)->Arg(10'000)->Arg(100'000);
+BENCHMARK(HierarchyPartialUpdate)
+->ArgNames({ "nodes", "moved" })
+->ArgsProduct({ { 10'000, 100'000 }, { 1, 100, 1'000 } });
+BENCHMARK(HierarchyStaticUpdate)->Arg(10'000)->Arg(100'000);
+BENCHMARK(SceneNodeUpdate)->Arg(10'000)->Arg(100'000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <thread>
+
+#include "threadPool.h"
+
+namespace rev::core {
+
+	// Pool used by the parallel algorithms when none is specified.
+	// Leaves one core free for the calling thread, which always helps running the work.
+	inline ThreadPool& defaultThreadPool()
+	{
+		static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	namespace detail
+	{
+		// Lazy binary splitting (Tzannes et al. 2010).
+		// A range is only split when the thread running it has nothing left in its queue for others to steal.
+		// Otherwise it keeps consuming grainSize chunks, so splitting adapts to the actual load of the pool
+		// instead of creating a job per chunk up front.
+		template<class T, class Body, class Combine>
+		struct LazySplitter
+		{
+			LazySplitter(ThreadPool& pool, size_t grainSize, const T& identity, const Body& body, const Combine& combine)
+				: pool(pool)
+				, grainSize(grainSize)
+				, identity(identity)
+				, body(body)
+				, combine(combine)
+			{}
+
+			ThreadPool& pool;
+			size_t grainSize;
+			const T& identity;
+			const Body& body;
+			const Combine& combine;
+
+			T result = identity;
+			std::mutex resultMutex;
+			std::atomic<size_t> pendingRanges = 0;
+
+			void process(size_t begin, size_t end)
+			{
+				T partial = identity;
+				while (end - begin > grainSize)
+				{
+					if (pool.ownQueueEmpty())
+					{
+						// Nobody can steal work from us. Give away the upper half
+						size_t mid = begin + (end - begin) / 2;
+						pendingRanges.fetch_add(1, std::memory_order_relaxed);
+						pool.submit([this, mid, end]() {
+							process(mid, end);
+							pendingRanges.fetch_sub(1, std::memory_order_release);
+						});
+						end = mid;
+					}
+					else
+					{
+						partial = body(begin, begin + grainSize, partial);
+						begin += grainSize;
+					}
+				}
+				if (begin < end)
+					partial = body(begin, end, partial);
+
+				// One merge per range, not per chunk
+				std::lock_guard lock(resultMutex);
+				result = combine(result, partial);
+			}
+
+			T run(size_t begin, size_t end)
+			{
+				process(begin, end);
+				pool.waitUntil([this]() { return pendingRanges.load(std::memory_order_acquire) == 0; });
+				return result;
+			}
+		};
+	}
+
+	// Parallel reduction over [begin, end).
+	// body(chunkBegin, chunkEnd, partial) must return partial accumulated with the results of the chunk.
+	// combine(a, b) merges two partial results. Partial results are combined in no particular order,
+	// so combine must be associative and commutative.
+	// Chunks are never smaller than grainSize iterations, except for the tail of a range.
+	// The calling thread takes part in the work and returns when the whole range is processed.
+	template<class T, class Body, class Combine>
+	T parallelReduce(ThreadPool& pool, size_t begin, size_t end, size_t grainSize, const T& identity, const Body& body, const Combine& combine)
+	{
+		if (end <= begin)
+			return identity;
+
+		detail::LazySplitter<T, Body, Combine> splitter(pool, std::max<size_t>(grainSize, 1), identity, body, combine);
+		return splitter.run(begin, end);
+	}
+
+	template<class T, class Body, class Combine>
+	T parallelReduce(size_t begin, size_t end, size_t grainSize, const T& identity, const Body& body, const Combine& combine)
+	{
+		return parallelReduce(defaultThreadPool(), begin, end, grainSize, identity, body, combine);
+	}
+
+	// Call op(i) for every i in [begin, end), splitting the range across the pool's workers.
+	template<class Op>
+	void parallelFor(ThreadPool& pool, size_t begin, size_t end, size_t grainSize, const Op& op)
+	{
+		struct NoResult {};
+		parallelReduce(pool, begin, end, grainSize, NoResult{},
+			[&op](size_t chunkBegin, size_t chunkEnd, NoResult) {
+				for (size_t i = chunkBegin; i < chunkEnd; ++i)
+					op(i);
+				return NoResult{};
+			},
+			[](NoResult, NoResult) { return NoResult{}; });
+	}
+
+	template<class Op>
+	void parallelFor(size_t begin, size_t end, size_t grainSize, const Op& op)
+	{
+		parallelFor(defaultThreadPool(), begin, end, grainSize, op);
+	}
+}
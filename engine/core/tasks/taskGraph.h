@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2019 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "threadPool.h"
+
+namespace rev::core {
+
+	// Graph of tasks with explicit dependencies between them.
+	// Nodes are released to the thread pool as soon as all their predecessors are finished.
+	// Build the graph once, compile it, and then run it as many times as needed (i.e. once per frame).
+	// Running a compiled graph doesn't allocate memory.
+	class TaskGraph
+	{
+	public:
+		using NodeId = uint32_t;
+
+		TaskGraph() = default;
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+
+		// Graph construction. Modifying the graph invalidates any previous compilation.
+		NodeId addNode(std::function<void()> task)
+		{
+			mCompiled = false;
+			mTasks.push_back(std::move(task));
+			return NodeId(mTasks.size() - 1);
+		}
+
+		// successor won't start until predecessor is finished
+		void addEdge(NodeId predecessor, NodeId successor)
+		{
+			assert(predecessor < mTasks.size());
+			assert(successor < mTasks.size());
+			mCompiled = false;
+			mEdges.push_back({ predecessor, successor });
+		}
+
+		void clear()
+		{
+			mCompiled = false;
+			mTasks.clear();
+			mEdges.clear();
+		}
+
+		size_t numNodes() const { return mTasks.size(); }
+
+		// Prepare the graph for execution.
+		// Returns false if the graph contains cycles, in which case it can't be run.
+		bool compile()
+		{
+			const size_t numNodes = mTasks.size();
+
+			// Flatten successor lists
+			mInDegree.assign(numNodes, 0);
+			mSuccessorOffsets.assign(numNodes + 1, 0);
+			for (auto& [from, to] : mEdges)
+			{
+				++mSuccessorOffsets[from + 1];
+				++mInDegree[to];
+			}
+			for (size_t i = 0; i < numNodes; ++i)
+				mSuccessorOffsets[i + 1] += mSuccessorOffsets[i];
+
+			mSuccessors.resize(mEdges.size());
+			std::vector<uint32_t> cursor(mSuccessorOffsets.begin(), mSuccessorOffsets.end() - 1);
+			for (auto& [from, to] : mEdges)
+				mSuccessors[cursor[from]++] = to;
+
+			// Look for cycles and root nodes (Kahn's topological sort)
+			mRoots.clear();
+			std::vector<NodeId> sorted;
+			sorted.reserve(numNodes);
+			std::vector<uint32_t> inDegree = mInDegree;
+			for (NodeId i = 0; i < numNodes; ++i)
+			{
+				if (inDegree[i] == 0)
+				{
+					mRoots.push_back(i);
+					sorted.push_back(i);
+				}
+			}
+			for (size_t i = 0; i < sorted.size(); ++i)
+			{
+				auto node = sorted[i];
+				for (auto s = mSuccessorOffsets[node]; s < mSuccessorOffsets[node + 1]; ++s)
+				{
+					auto successor = mSuccessors[s];
+					if (--inDegree[successor] == 0)
+						sorted.push_back(successor);
+				}
+			}
+			if (sorted.size() != numNodes)
+			{
+				mCompiled = false;
+				return false; // Some nodes are never released. There must be a cycle
+			}
+
+			// Allocate execution state
+			mPendingInputs = std::make_unique<std::atomic<uint32_t>[]>(numNodes);
+			mJobs = std::make_unique<ThreadPool::Job[]>(numNodes);
+			for (NodeId i = 0; i < numNodes; ++i)
+			{
+				mJobs[i].work = [this, i]() { runNode(i); };
+			}
+			mMetrics.runTimes.assign(numNodes, 0.0);
+
+			mCompiled = true;
+			return true;
+		}
+
+		bool isCompiled() const { return mCompiled; }
+
+		// Run all the tasks in the graph and wait for them to finish.
+		// The calling thread helps running tasks while it waits.
+		void run(ThreadPool& pool)
+		{
+			assert(mCompiled);
+			mPool = &pool;
+
+			const size_t numNodes = mTasks.size();
+			for (size_t i = 0; i < numNodes; ++i)
+			{
+				mPendingInputs[i].store(mInDegree[i], std::memory_order_relaxed);
+				// Nodes that haven't been released yet must not look finished to the wait below
+				mJobs[i].finished.store(false, std::memory_order_relaxed);
+			}
+
+			for (auto root : mRoots)
+				pool.submit(mJobs[root]);
+
+			for (size_t i = 0; i < numNodes; ++i)
+				pool.wait(mJobs[i]);
+
+			mPool = nullptr;
+		}
+
+		// Run time of each node, in seconds, during the last execution of the graph. Indexed by NodeId.
+		const ThreadPool::ThreadMetrics& metrics() const { return mMetrics; }
+
+	private:
+		void runNode(NodeId node)
+		{
+			auto taskStart = std::chrono::high_resolution_clock::now();
+			mTasks[node]();
+			std::chrono::duration<double> taskDuration = std::chrono::high_resolution_clock::now() - taskStart;
+			mMetrics.runTimes[node] = taskDuration.count();
+
+			// Release successors
+			for (auto s = mSuccessorOffsets[node]; s < mSuccessorOffsets[node + 1]; ++s)
+			{
+				auto successor = mSuccessors[s];
+				if (mPendingInputs[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+					mPool->submit(mJobs[successor]);
+			}
+		}
+
+		// Graph description
+		std::vector<std::function<void()>> mTasks;
+		std::vector<std::pair<NodeId, NodeId>> mEdges;
+
+		// Compiled graph
+		bool mCompiled = false;
+		std::vector<uint32_t> mInDegree;
+		std::vector<uint32_t> mSuccessorOffsets;
+		std::vector<NodeId> mSuccessors;
+		std::vector<NodeId> mRoots;
+
+		// Execution state
+		ThreadPool* mPool = nullptr;
+		std::unique_ptr<std::atomic<uint32_t>[]> mPendingInputs;
+		std::unique_ptr<ThreadPool::Job[]> mJobs;
+		ThreadPool::ThreadMetrics mMetrics;
+	};
+
+}
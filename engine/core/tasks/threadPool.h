@@ -20,21 +20,134 @@
 #pragma once
 
 #include <atomic>
+#include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "workStealingQueue.h"
+
 namespace rev::core {
 
+	// Pool of persistent worker threads.
+	// Each worker owns a work stealing deque. Jobs submitted from inside a worker go to that worker's deque,
+	// jobs submitted from any other thread go to a shared queue. Idle workers steal from each other and
+	// park on a condition variable when there's no work left anywhere.
 	class ThreadPool
 	{
 	public:
+		struct Job
+		{
+			std::function<void()> work;
+			std::atomic<bool> finished = false;
+
+			bool done() const { return finished.load(std::memory_order_acquire); }
+
+		private:
+			friend class ThreadPool;
+			std::shared_ptr<Job> self; // Keeps the job alive while it is queued
+		};
+
+		using JobHandle = std::shared_ptr<Job>;
+
 		ThreadPool(size_t nWorkers)
-			: mWorkers(nWorkers)
-			, mMetrics(nWorkers)
-		{}
+			: mMetrics(nWorkers)
+			, mQueues(nWorkers)
+		{
+			for (auto& queue : mQueues)
+				queue = std::make_unique<WorkStealingQueue<Job*>>();
+
+			mWorkers.reserve(nWorkers);
+			for (size_t i = 0; i < nWorkers; ++i)
+				mWorkers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard lock(mParkMutex);
+				mStop = true;
+			}
+			mParkCondition.notify_all();
+			for (auto& worker : mWorkers)
+				worker.join();
+
+			// Release jobs that never got the chance to run
+			Job* job;
+			while (popExternal(job))
+				job->self.reset();
+			for (auto& queue : mQueues)
+				while (queue->steal(job))
+					job->self.reset();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t numWorkers() const { return mWorkers.size(); }
+
+		// Queue a job for execution on any of the workers.
+		// The returned handle can be waited on from any thread, including the pool's own workers.
+		template<class Op>
+		JobHandle submit(Op&& operation)
+		{
+			auto job = std::make_shared<Job>();
+			job->work = std::forward<Op>(operation);
+			job->self = job;
+			push(*job);
+			return job;
+		}
+
+		// Queue a job owned by the caller. Useful to reuse jobs across frames without allocating.
+		// The job must stay alive until it's finished.
+		void submit(Job& job)
+		{
+			assert(job.work);
+			job.finished.store(false, std::memory_order_relaxed);
+			push(job);
+		}
+
+		// Block until the job is finished.
+		// The calling thread doesn't go idle while it waits, but helps running queued jobs instead,
+		// so it is safe to wait from inside a job.
+		void wait(const Job& job)
+		{
+			waitUntil([&job]() { return job.done(); });
+		}
+
+		// Help running jobs until the condition is met.
+		// The condition must only change as jobs of this pool run. When there's nothing to help with,
+		// the caller sleeps until another job finishes or is submitted.
+		template<class Condition>
+		void waitUntil(const Condition& condition)
+		{
+			for (;;)
+			{
+				const uint32_t epoch = mJobEvents.load(std::memory_order_acquire);
+				if (condition())
+					return;
+				if (!runPendingJob())
+					mJobEvents.wait(epoch, std::memory_order_acquire);
+			}
+		}
+
+		void wait(const std::vector<JobHandle>& jobs)
+		{
+			for (auto& job : jobs)
+				wait(*job);
+		}
+
+		void wait(const JobHandle& job)
+		{
+			wait(*job);
+		}
 
 		template<class TaskData, class Op>
 		bool run(const std::vector<TaskData>& taskData, const Op& operation, std::ostream& log)
@@ -48,24 +161,17 @@ namespace rev::core {
 			log << "Running " << mWorkers.size() << " worker threads for " << taskData.size() << " tasks\n";
 			auto start = std::chrono::high_resolution_clock::now();
 
-			// Run jobs
-			for (int i = 0; i < mWorkers.size(); ++i)
+			// Run jobs. One per worker, each one pulling tasks from the shared counter.
+			std::vector<JobHandle> jobs;
+			jobs.reserve(mMetrics.size());
+			for (size_t i = 0; i < mMetrics.size(); ++i)
 			{
-				mWorkers[i] = std::thread(
-					workerRoutine<TaskData, Op>,
-					std::ref(mMetrics[i]),
-					std::cref(taskData),
-					&mTaskCounter,
-					std::ref(operation));
-
-				if (!mWorkers[i].joinable())
-				{
-					return false;
-				}
+				jobs.push_back(submit([&, i]() {
+					workerRoutine<TaskData, Op>(mMetrics[i], taskData, &mTaskCounter, operation);
+				}));
 			}
 			// Finish jobs
-			for (auto& worker : mWorkers)
-				worker.join();
+			wait(jobs);
 
 			// Close global profiling
 			std::chrono::duration<double> runningTime = std::chrono::high_resolution_clock::now() - start;
@@ -75,9 +181,6 @@ namespace rev::core {
 			return true;
 		}
 
-	private:
-		using AtomicCounter = std::atomic<size_t>;
-
 		struct ThreadMetrics
 		{
 			std::vector<double> runTimes;
@@ -89,6 +192,23 @@ namespace rev::core {
 			}
 		};
 
+		// True if there are no jobs waiting in the queue the calling thread submits to.
+		// Thieves can't take work from an empty queue, so this is a hint that new jobs should be spawned.
+		bool ownQueueEmpty()
+		{
+			if (tCurrentWorker.pool == this)
+				return mQueues[tCurrentWorker.index]->empty();
+
+			std::lock_guard lock(mExternalMutex);
+			return mExternalJobs.empty();
+		}
+
+		// Per worker metrics of the last call to run
+		const std::vector<ThreadMetrics>& metrics() const { return mMetrics; }
+
+	private:
+		using AtomicCounter = std::atomic<size_t>;
+
 		template<class TaskData, class Op>
 		static void workerRoutine(ThreadMetrics& metrics, const std::vector<TaskData>& taskData, AtomicCounter* globalCounter, const Op& operation)
 		{
@@ -111,9 +231,134 @@ namespace rev::core {
 			}
 		}
 
+		void push(Job& job)
+		{
+			{
+				// Counted before the job is published, so workers grabbing it never take the counter below zero.
+				// Taking the lock guarantees parking workers either see the new job or get the notification
+				std::lock_guard lock(mParkMutex);
+				mPendingJobs.fetch_add(1, std::memory_order_release);
+			}
+
+			if (tCurrentWorker.pool == this)
+			{
+				mQueues[tCurrentWorker.index]->push(&job);
+			}
+			else
+			{
+				std::lock_guard lock(mExternalMutex);
+				mExternalJobs.push_back(&job);
+			}
+
+			mParkCondition.notify_one();
+			signalJobEvent();
+		}
+
+		// Wakes threads sleeping in waitUntil
+		void signalJobEvent()
+		{
+			mJobEvents.fetch_add(1, std::memory_order_release);
+			mJobEvents.notify_all();
+		}
+
+		struct WorkerContext // Zero initialized for non worker threads
+		{
+			ThreadPool* pool;
+			size_t index;
+		};
+
+		void workerLoop(size_t workerIndex)
+		{
+			tCurrentWorker = { this, workerIndex };
+
+			for (;;)
+			{
+				if (runPendingJob())
+					continue;
+
+				// Nothing to do. Park until new jobs are submitted
+				std::unique_lock lock(mParkMutex);
+				mParkCondition.wait(lock, [this]() {
+					return mStop || mPendingJobs.load(std::memory_order_acquire) > 0;
+				});
+				if (mStop)
+					break;
+			}
+
+			tCurrentWorker = {};
+		}
+
+		// Try to grab a job from anywhere in the pool and run it.
+		// Returns false if there was no job available.
+		bool runPendingJob()
+		{
+			Job* job = nullptr;
+			if (!grabJob(job))
+				return false;
+
+			mPendingJobs.fetch_sub(1, std::memory_order_relaxed);
+			job->work();
+
+			// The job may be destroyed as soon as it is marked as finished and the self reference is released.
+			// Caller owned jobs have no self reference.
+			auto keepAlive = std::move(job->self);
+			job->finished.store(true, std::memory_order_release);
+			signalJobEvent();
+			return true;
+		}
+
+		bool grabJob(Job*& job)
+		{
+			const bool isOwnWorker = tCurrentWorker.pool == this;
+			const size_t selfNdx = isOwnWorker ? tCurrentWorker.index : 0;
+
+			// Own work first, for locality
+			if (isOwnWorker && mQueues[selfNdx]->pop(job))
+				return true;
+
+			if (popExternal(job))
+				return true;
+
+			// Steal from other workers
+			for (size_t i = 1; i <= mQueues.size(); ++i)
+			{
+				size_t victim = (selfNdx + i) % mQueues.size();
+				if (isOwnWorker && victim == selfNdx)
+					continue;
+				if (mQueues[victim]->steal(job))
+					return true;
+			}
+
+			return false;
+		}
+
+		bool popExternal(Job*& job)
+		{
+			std::lock_guard lock(mExternalMutex);
+			if (mExternalJobs.empty())
+				return false;
+			job = mExternalJobs.front();
+			mExternalJobs.pop_front();
+			return true;
+		}
+
+		inline static thread_local WorkerContext tCurrentWorker;
+
 		AtomicCounter	mTaskCounter;
 		std::vector<std::thread> mWorkers;
 		std::vector<ThreadMetrics> mMetrics;
+
+		// Job queues
+		std::vector<std::unique_ptr<WorkStealingQueue<Job*>>> mQueues;
+		std::mutex mExternalMutex;
+		std::deque<Job*> mExternalJobs;
+
+		// Parking
+		std::mutex mParkMutex;
+		std::condition_variable mParkCondition;
+		std::atomic<size_t> mPendingJobs = 0;
+		bool mStop = false;
+		std::atomic<uint32_t> mJobEvents = 0; // Bumped whenever a job is submitted or finishes
 	};
 
 }
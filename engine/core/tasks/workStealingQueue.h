@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rev::core {
+
+	// Chase-Lev work stealing deque.
+	// Only the owner thread can push and pop from the bottom end. Any other thread can steal from the top.
+	// Follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Nardelli 2013).
+	// T must be trivially copyable and lock free when wrapped in std::atomic (i.e. a pointer).
+	template<class T>
+	class WorkStealingQueue
+	{
+	public:
+		WorkStealingQueue(size_t initialCapacity = 256)
+		{
+			assert(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0); // Must be a power of two
+			mArrays.push_back(std::make_unique<CircularArray>(initialCapacity));
+			mArray = mArrays.back().get();
+		}
+
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+		// Owner only
+		void push(T x)
+		{
+			int64_t b = mBottom.load(std::memory_order_relaxed);
+			int64_t t = mTop.load(std::memory_order_acquire);
+			CircularArray* a = mArray.load(std::memory_order_relaxed);
+			if (b - t > int64_t(a->capacity()) - 1) // Full queue
+			{
+				a = grow(a, b, t);
+			}
+			a->put(b, x);
+			mBottom.store(b + 1, std::memory_order_release); // Publish the new element to thieves
+		}
+
+		// Owner only
+		bool pop(T& x)
+		{
+			int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+			CircularArray* a = mArray.load(std::memory_order_relaxed);
+			mBottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = mTop.load(std::memory_order_relaxed);
+			if (t > b) // Empty queue
+			{
+				mBottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			x = a->get(b);
+			if (t == b) // Last element. Race against thieves for it
+			{
+				bool won = mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				mBottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// Any thread
+		bool steal(T& x)
+		{
+			int64_t t = mTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = mBottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return false; // Empty queue
+
+			CircularArray* a = mArray.load(std::memory_order_acquire);
+			x = a->get(t);
+			return mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		// Approximate size. Only reliable when called from the owner thread with no concurrent thieves.
+		size_t size() const
+		{
+			int64_t b = mBottom.load(std::memory_order_relaxed);
+			int64_t t = mTop.load(std::memory_order_relaxed);
+			return b > t ? size_t(b - t) : 0;
+		}
+
+		bool empty() const { return size() == 0; }
+
+	private:
+		class CircularArray
+		{
+		public:
+			CircularArray(size_t capacity)
+				: mMask(capacity - 1)
+				, mData(capacity)
+			{}
+
+			size_t capacity() const { return mMask + 1; }
+			T get(int64_t i) const { return mData[size_t(i) & mMask].load(std::memory_order_relaxed); }
+			void put(int64_t i, T x) { mData[size_t(i) & mMask].store(x, std::memory_order_relaxed); }
+
+		private:
+			size_t mMask;
+			std::vector<std::atomic<T>> mData;
+		};
+
+		CircularArray* grow(CircularArray* a, int64_t b, int64_t t)
+		{
+			auto newArray = std::make_unique<CircularArray>(2 * a->capacity());
+			for (int64_t i = t; i < b; ++i)
+				newArray->put(i, a->get(i));
+			// Thieves may still be reading from the old array, so we keep it alive until the queue is destroyed.
+			mArrays.push_back(std::move(newArray));
+			CircularArray* result = mArrays.back().get();
+			mArray.store(result, std::memory_order_release);
+			return result;
+		}
+
+		alignas(64) std::atomic<int64_t> mTop = 0;
+		alignas(64) std::atomic<int64_t> mBottom = 0;
+		std::atomic<CircularArray*> mArray;
+		std::vector<std::unique_ptr<CircularArray>> mArrays; // Owner only
+	};
+
+}
@@ -19,23 +19,147 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "profiler.h"
 
-#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace rev::core
 {
-	using namespace std::chrono;
+	namespace
+	{
+		void writeJsonString(std::ostream& out, std::string_view s)
+		{
+			out << '"';
+			for (char c : s)
+			{
+				if (c == '"' || c == '\\')
+					out << '\\' << c;
+				else if (uint8_t(c) < 0x20)
+					out << ' ';
+				else
+					out << c;
+			}
+			out << '"';
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Buffers are never released, so exports can still see the events of threads that already finished.
+	struct Profiler::Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	//------------------------------------------------------------------------------------------------------------------
+	Profiler::Registry& Profiler::registry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Profiler::ThreadBuffer* Profiler::registerThread()
+	{
+		auto& reg = registry();
+		std::lock_guard lock(reg.mutex);
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->m_threadId = uint32_t(reg.buffers.size());
+		buffer->m_name = "Thread " + std::to_string(buffer->m_threadId);
+		reg.buffers.push_back(std::move(buffer));
+		return reg.buffers.back().get();
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void Profiler::setThreadName(std::string_view name)
+	{
+		if (!enabled())
+			return;
+		auto& buffer = threadBuffer();
+		std::lock_guard lock(registry().mutex);
+		buffer.m_name = name;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void Profiler::writeChromeTrace(std::ostream& out)
+	{
+		auto& reg = registry();
+		std::lock_guard lock(reg.mutex);
+
+		// Timestamps are in microseconds. Keep full precision for long captures
+		const auto oldFlags = out.flags();
+		const auto oldPrecision = out.precision(3);
+		out << std::fixed;
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		auto separator = [&]() {
+			if (!first)
+				out << ",\n";
+			first = false;
+		};
+
+		for (auto& buffer : reg.buffers)
+		{
+			const auto tid = buffer->m_threadId;
 
-	ScopedStopWatch::ScopedStopWatch(std::string_view tag)
-		: m_tag(tag)
-		, m_t0(clock::now())
-	{}
+			// Thread name metadata
+			separator();
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"args\":{\"name\":";
+			writeJsonString(out, buffer->m_name);
+			out << "}}";
+
+			// Only the last kEventsPerThread events survive in the ring
+			const uint64_t head = buffer->m_head.load(std::memory_order_acquire);
+			const uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+			for (uint64_t i = begin; i < head; ++i)
+			{
+				const Event& e = buffer->m_events[i & (kEventsPerThread - 1)];
+				separator();
+				out << "{\"name\":";
+				writeJsonString(out, e.name ? e.name : "");
+				out << ",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << double(e.timeNs) * 1e-3;
+				switch (e.type)
+				{
+				case EventType::ZoneBegin:
+					out << ",\"ph\":\"B\"}";
+					break;
+				case EventType::ZoneEnd:
+					out << ",\"ph\":\"E\"}";
+					break;
+				case EventType::Frame:
+					out << ",\"ph\":\"i\",\"s\":\"g\"}";
+					break;
+				case EventType::Counter:
+					out << ",\"ph\":\"C\",\"args\":{\"value\":" << e.value << "}}";
+					break;
+				}
+			}
+		}
+
+		out << "\n]}\n";
+		out.flags(oldFlags);
+		out.precision(oldPrecision);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool Profiler::saveChromeTrace(const std::string& fileName)
+	{
+		std::ofstream out(fileName);
+		if (!out.is_open())
+			return false;
+		writeChromeTrace(out);
+		return out.good();
+	}
 
-	ScopedStopWatch::~ScopedStopWatch()
+	//------------------------------------------------------------------------------------------------------------------
+	void Profiler::clear()
 	{
-		auto dt = clock::now() - m_t0;
-		if(duration_cast<milliseconds>(dt).count() < 50)
-			std::cout << m_tag << " duration: " << duration_cast<microseconds>(dt) << "\n";
-		else
-			std::cout << m_tag << " duration: " << duration_cast<milliseconds>(dt) << "\n";
+		auto& reg = registry();
+		std::lock_guard lock(reg.mutex);
+		for (auto& buffer : reg.buffers)
+			buffer->m_head.store(0, std::memory_order_relaxed);
 	}
-}
\ No newline at end of file
+}
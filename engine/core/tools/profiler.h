@@ -19,23 +19,135 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <string_view>
-#include <chrono>
 
 namespace rev::core
 {
-	// Captures the execution duration of a scope and outputs a message
-	// to cout on destruction.
-	class ScopedStopWatch
+	// Low overhead instrumentation profiler.
+	// Every thread records events into its own lock free ring buffer. When a buffer is full, the oldest
+	// events get overwritten, so the profiler always holds the most recent history of each thread.
+	// Captures can be exported to Chrome's trace_event json format, to be opened in Perfetto or chrome://tracing.
+	// All names must be static strings (i.e. literals). Only the pointer is stored.
+	// Recording is off by default, and threads only allocate their buffers once they record while enabled.
+	class Profiler
+	{
+	public:
+		enum class EventType : uint8_t
+		{
+			ZoneBegin,
+			ZoneEnd,
+			Frame,
+			Counter
+		};
+
+		struct Event
+		{
+			uint64_t timeNs; // Since profiler start up
+			const char* name;
+			double value; // Only meaningful for counters
+			EventType type;
+		};
+
+		static constexpr size_t kEventsPerThread = 1 << 16; // Must be a power of two
+
+		static void setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+		static bool enabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+		// Instrumentation
+		static void beginZone(const char* name) { record(EventType::ZoneBegin, name); }
+		static void endZone(const char* name) { record(EventType::ZoneEnd, name); }
+		static void frameMark(const char* name = "Frame") { record(EventType::Frame, name); }
+		static void counter(const char* name, double value) { record(EventType::Counter, name, value); }
+
+		// Name shown for the calling thread in exported traces. Ignored while the profiler is disabled.
+		static void setThreadName(std::string_view name);
+
+		// Export. Results are only consistent if no other thread is recording events at the same time.
+		static void writeChromeTrace(std::ostream& out);
+		static bool saveChromeTrace(const std::string& fileName);
+		// Drop all recorded events
+		static void clear();
+
+	private:
+		static void record(EventType type, const char* name, double value = 0.0)
+		{
+			if (!enabled())
+				return;
+			auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - sStartTime).count();
+			threadBuffer().push({ uint64_t(t), name, value, type });
+		}
+
+		using clock = std::chrono::steady_clock;
+
+		struct ThreadBuffer
+		{
+			// Single producer ring buffer. Only the owner thread writes to it.
+			void push(const Event& e)
+			{
+				auto head = m_head.load(std::memory_order_relaxed);
+				m_events[head & (kEventsPerThread - 1)] = e;
+				m_head.store(head + 1, std::memory_order_release);
+			}
+
+			std::atomic<uint64_t> m_head = 0;
+			uint32_t m_threadId = 0;
+			std::string m_name;
+			Event m_events[kEventsPerThread];
+		};
+
+		static ThreadBuffer& threadBuffer()
+		{
+			static thread_local ThreadBuffer* buffer = registerThread();
+			return *buffer;
+		}
+
+		static ThreadBuffer* registerThread();
+
+		struct Registry; // Keeps track of all thread buffers
+		static Registry& registry();
+
+		static inline std::atomic<bool> sEnabled = false;
+		static inline const clock::time_point sStartTime = clock::now();
+	};
+
+	// Records a nested zone for the duration of a scope
+	class ProfileZone
 	{
 	public:
-		ScopedStopWatch(std::string_view tag);
-		~ScopedStopWatch();
+		ProfileZone(const char* name)
+			: m_name(name)
+		{
+			Profiler::beginZone(name);
+		}
+
+		~ProfileZone()
+		{
+			Profiler::endZone(m_name);
+		}
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
 
 	private:
-		using clock = std::chrono::high_resolution_clock;
-		std::string m_tag;
-		clock::time_point m_t0;
+		const char* m_name;
+	};
+
+#define REV_PROFILE_CONCAT_IMPL(a, b) a##b
+#define REV_PROFILE_CONCAT(a, b) REV_PROFILE_CONCAT_IMPL(a, b)
+#define REV_PROFILE_ZONE(name) ::rev::core::ProfileZone REV_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+
+	// Captures the execution duration of a scope as a profiler zone.
+	// Kept for compatibility with older code. Prefer ProfileZone or REV_PROFILE_ZONE.
+	class ScopedStopWatch : public ProfileZone
+	{
+	public:
+		ScopedStopWatch(const char* tag)
+			: ProfileZone(tag)
+		{}
 	};
 }
@@ -19,10 +19,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 #include <vector>
+#include <game/animation/skeleton.h>
 #include <game/scene/component.h>
 #include <game/scene/sceneNode.h>
 #include <game/scene/transform/transform.h>
 #include <gfx/scene/animation/animation.h>
+#include <gfx/scene/animation/clipSampling.h>
 #include <memory>
 
 namespace rev::game {
@@ -39,8 +41,22 @@ namespace rev::game {
 			m_anim = anim;
 			m_time = 0;
 			m_loop = loop;
+			m_cursor = {};
+			resetPose();
 		}
 
+		// With a skeleton, every channel of the animation drives the joint given by Skeleton::channelJoints.
+		// Otherwise, only channel 0 is played, on this node's transform.
+		void setSkeleton(std::shared_ptr<Skeleton> skeleton)
+		{
+			m_skeleton = std::move(skeleton);
+			resetPose();
+		}
+
+		const auto& animation() const { return m_anim; }
+		bool isLooping() const { return m_loop; }
+		float time() const { return m_time; }
+
 		void init() override
 		{
 			m_time = 0;
@@ -58,14 +74,39 @@ namespace rev::game {
 					m_time -= duration;
 			}
 
-			m_anim->getChannelPose(0, m_time, m_tempPose);
+			if(m_skeleton)
+			{
+				gfx::sampleClip(*m_anim, m_time, m_pose, m_cursor);
+				m_skeleton->setPose(m_pose, m_channelJoints);
+				return;
+			}
+
+			m_anim->getChannelPose(0, m_time, m_tempPose, m_cursor);
 
 			m_target->xForm.position() = m_tempPose.translation;
 			m_target->xForm.setRotation(m_tempPose.rotation);
 		}
 
 	private:
+		// Starts every channel from the reference pose of its joint, so channels without keys keep it
+		void resetPose()
+		{
+			if(!m_skeleton || !m_anim)
+				return;
+			m_channelJoints = m_skeleton->channelJoints(*m_anim);
+			m_pose.joints.resize(m_channelJoints.size());
+			for(size_t i = 0; i < m_channelJoints.size(); ++i)
+			{
+				if(m_channelJoints[i] != Skeleton::kNoJoint)
+					m_pose.joints[i] = m_skeleton->referencePose(m_channelJoints[i]);
+			}
+		}
+
 		gfx::Pose::JointPose m_tempPose;
+		gfx::Animation::Cursor m_cursor;
+		gfx::Pose m_pose; // In channel order
+		std::vector<uint32_t> m_channelJoints;
+		std::shared_ptr<Skeleton> m_skeleton;
 		Transform* m_target = nullptr;
 		float m_time;
 		bool m_loop = false;
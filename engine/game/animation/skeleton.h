@@ -18,6 +18,9 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 #include <gfx/scene/animation/animation.h>
 #include <game/scene/transform/transform.h>
@@ -29,9 +32,15 @@ namespace rev::game {
 	class Skeleton
 	{
 	public:
-		Skeleton(const std::vector<std::shared_ptr<SceneNode>>& nodes)
+		static constexpr uint32_t kNoJoint = uint32_t(-1);
+
+		// nodeIds optionally holds the index of each joint's node in the scene it was loaded from,
+		// in the same space as gfx::Animation::m_channelNodes (i.e. glTF node indices).
+		Skeleton(const std::vector<std::shared_ptr<SceneNode>>& nodes, std::vector<uint32_t> nodeIds = {})
+			: m_jointNodes(nodes)
+			, m_jointNodeIds(std::move(nodeIds))
 		{
-			m_jointNodes = nodes;
+			assert(m_jointNodeIds.empty() || m_jointNodeIds.size() == m_jointNodes.size());
 			for(auto n : nodes)
 			{
 				gfx::Pose::JointPose nodePose;
@@ -39,26 +48,73 @@ namespace rev::game {
 				auto transform = n->component<Transform>();
 				nodePose.rotation = transform->xForm.rotation();
 				nodePose.translation = transform->xForm.position();
+				m_referencePose.joints.push_back(nodePose);
+			}
+		}
+
+		size_t numJoints() const { return m_jointNodes.size(); }
+
+		// Joint driven by each channel of animation, or kNoJoint for channels that target other nodes.
+		// Matches channels to joints by node when both sides know them. Otherwise channel i drives joint i.
+		std::vector<uint32_t> channelJoints(const gfx::Animation& animation) const
+		{
+			const size_t numChannels = animation.m_rotationChannels.size();
+			std::vector<uint32_t> joints(numChannels, kNoJoint);
+			if(!m_jointNodeIds.empty() && animation.m_channelNodes.size() == numChannels)
+			{
+				for(size_t i = 0; i < numChannels; ++i)
+				{
+					auto joint = std::find(m_jointNodeIds.begin(), m_jointNodeIds.end(), animation.m_channelNodes[i]);
+					if(joint != m_jointNodeIds.end())
+						joints[i] = uint32_t(joint - m_jointNodeIds.begin());
+				}
+			}
+			else
+			{
+				for(size_t i = 0; i < std::min(numChannels, m_jointNodes.size()); ++i)
+					joints[i] = uint32_t(i);
 			}
+			return joints;
 		}
 
+		// Pose in joint order
 		void setPose(const gfx::Pose& pose)
 		{
-			int n = 0;
-			for(auto& joint : pose.joints)
+			assert(pose.joints.size() <= m_jointNodes.size());
+			const size_t n = std::min(pose.joints.size(), m_jointNodes.size());
+			for(size_t i = 0; i < n; ++i)
+				setJointPose(i, pose.joints[i]);
+		}
+
+		// Pose in channel order, like the ones sampled from a clip, with channelJoints(clip) as the map
+		void setPose(const gfx::Pose& pose, const std::vector<uint32_t>& channelJoints)
+		{
+			assert(channelJoints.size() == pose.joints.size());
+			const size_t n = std::min(pose.joints.size(), channelJoints.size());
+			for(size_t i = 0; i < n; ++i)
 			{
-				auto& node = m_jointNodes[n++];
-				auto transform = node->component<Transform>();
-				transform->xForm.position() = joint.translation;
-				transform->xForm.setRotation(joint.rotation);
+				const auto joint = channelJoints[i];
+				if(joint == kNoJoint)
+					continue;
+				assert(joint < m_jointNodes.size());
+				setJointPose(joint, pose.joints[i]);
 			}
 		}
+
 		void getReferencePose(gfx::Pose& dst) const { dst = m_referencePose; }
+		const gfx::Pose::JointPose& referencePose(size_t joint) const { return m_referencePose.joints[joint]; }
 
 	private:
+		void setJointPose(size_t joint, const gfx::Pose::JointPose& pose)
+		{
+			auto transform = m_jointNodes[joint]->component<Transform>();
+			transform->xForm.position() = pose.translation;
+			transform->xForm.setRotation(pose.rotation);
+		}
+
 		gfx::Pose m_referencePose;
 
 		std::vector<std::shared_ptr<SceneNode>> m_jointNodes;
+		std::vector<uint32_t> m_jointNodeIds;
 	};
-
 }
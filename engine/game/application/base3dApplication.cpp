@@ -25,6 +25,7 @@
 #include <core/platform/cmdLineParser.h>
 #include <core/platform/fileSystem/fileSystem.h>
 #include <core/platform/osHandler.h>
+#include <core/tools/profiler.h>
 
 #include <gfx/backend/Context.h>
 #include <gfx/backend/Vulkan/renderContextVulkan.h>
@@ -44,6 +45,8 @@ namespace rev::game {
 		args.addOption("h", &windowSize.y());
 		args.addFlag("fullscreen", fullScreen);
 		args.addFlag("dx12", useDX12);
+		args.addOption("profile", &profileTrace);
+		args.addOption("frameStats", &frameStatsFile);
 	}
 
 	//------------------------------------------------------------------------------------------------
@@ -61,6 +64,7 @@ namespace rev::game {
 		m_options.registerOptions(arguments);
 		getCommandLineOptions(arguments);
 		arguments.parse(argc, argv);
+		core::Profiler::setEnabled(!m_options.profileTrace.empty());
 		// Init engine
 		initEngineCore();
 		if (!initGraphics(m_options.useDX12))
@@ -82,26 +86,58 @@ namespace rev::game {
 		const TimeDelta fixedDt = TimeDelta(1.f / 60);
 		const TimeDelta maxCarryOverTime = TimeDelta(0.5f);
 		std::chrono::duration<float> accumTime = fixedDt; // Start with a regular frame
+		core::Profiler::setThreadName("Main thread");
 		for (;;)
 		{
+			core::Profiler::frameMark();
 			if (!core::OSHandler::get()->update())
 				break;
 			
+			FrameStatistics::Frame frameStats;
 			// Fixed time simulation loop and render
-			for(int i = 0; i < kMaxIter &&  accumTime >= fixedDt; ++i)
+			auto updateStart = m_appTime.now();
+			bool quit = false;
+			for(int i = 0; i < kMaxIter &&  accumTime >= fixedDt && !quit; ++i)
 			{
+				REV_PROFILE_ZONE("updateLogic");
 				accumTime -= fixedDt;
+				++frameStats.logicSteps;
 				//	updateLogic
-				if (!updateLogic(fixedDt))
-					return;
+				quit = !updateLogic(fixedDt);
 			}
+			if (quit)
+			{
+				// Account for the last frame's logic, then leave through the regular shutdown,
+				// so traces and frame statistics get saved and graphics released
+				using Ms = std::chrono::duration<float, std::milli>;
+				auto t = m_appTime.now();
+				frameStats.updateMs = Ms(t - updateStart).count();
+				frameStats.totalMs = Ms(t - lastTime).count();
+				m_frameStats.addFrame(frameStats);
+				break;
+			}
+			frameStats.hitIterationCap = accumTime >= fixedDt;
 			//	render
-			render(fixedDt);
+			auto renderStart = m_appTime.now();
+			{
+				REV_PROFILE_ZONE("render");
+				render(fixedDt);
+			}
 
 			// Prepare next frame's time
 			auto t = m_appTime.now();
 			accumTime += t - lastTime; // Accumulate this frame's duration plus left over time from this frame
-			accumTime = std::min(maxCarryOverTime, accumTime); // Clamp max carry over
+			if (accumTime > maxCarryOverTime)
+			{
+				frameStats.droppedSteps = uint32_t((accumTime - maxCarryOverTime) / fixedDt);
+				accumTime = maxCarryOverTime; // Clamp max carry over
+			}
+
+			using Ms = std::chrono::duration<float, std::milli>;
+			frameStats.updateMs = Ms(renderStart - updateStart).count();
+			frameStats.renderMs = Ms(t - renderStart).count();
+			frameStats.totalMs = Ms(t - lastTime).count();
+			m_frameStats.addFrame(frameStats);
 			lastTime = t;
 		}
 
@@ -111,6 +147,19 @@ namespace rev::game {
 		// Shutdown systems
 		endGraphics();
 		core::FileSystem::end();
+
+		if (!m_options.profileTrace.empty())
+		{
+			if (!core::Profiler::saveChromeTrace(m_options.profileTrace))
+				std::cout << "Unable to save profiler trace to " << m_options.profileTrace << "\n";
+		}
+
+		if (!m_options.frameStatsFile.empty())
+		{
+			m_frameStats.print(std::cout);
+			if (!m_frameStats.saveCSV(m_options.frameStatsFile))
+				std::cout << "Unable to save frame statistics to " << m_options.frameStatsFile << "\n";
+		}
 	}
 
 	const math::Vec2u& Base3dApplication::windowSize() const {
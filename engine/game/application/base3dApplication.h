@@ -21,8 +21,10 @@
 
 #include <math/algebra/vector.h>
 #include <gfx/backend/Context.h>
+#include "frameStatistics.h"
 #include <chrono>
 #include <memory>
+#include <string>
 
 namespace rev::core {
 	class CmdLineParser;
@@ -46,6 +48,8 @@ namespace rev::game {
 			math::Vec2u windowSize { 640, 480 };
 			bool fullScreen{ false };
 			bool useDX12 = false;
+			std::string profileTrace; // When not empty, save a profiler capture to this file on exit
+			std::string frameStatsFile; // When not empty, save the frame statistics history as csv on exit
 
 			void registerOptions(core::CmdLineParser&);
 		};
@@ -60,6 +64,7 @@ namespace rev::game {
 
 	protected:
 		const math::Vec2u& windowSize() const;
+		const FrameStatistics& frameStatistics() const { return m_frameStats; }
 
 	private: // Extension interface
 		// Life cycle
@@ -84,6 +89,7 @@ namespace rev::game {
 	private:
 		std::chrono::high_resolution_clock m_appTime;
 		CommandLineOptions m_options;
+		FrameStatistics m_frameStats;
 		gfx::Context::ResizeDelegate m_resizeDelegate;
 	};
 
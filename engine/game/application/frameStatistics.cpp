@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "frameStatistics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+namespace rev::game {
+
+	//------------------------------------------------------------------------------------------------------------------
+	FrameStatistics::FrameStatistics(size_t historySize)
+		: m_capacity(historySize)
+	{
+		assert(historySize > 0);
+		m_history.reserve(historySize);
+		m_scratch.reserve(historySize);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void FrameStatistics::addFrame(const Frame& frame)
+	{
+		if (m_history.size() < m_capacity)
+			m_history.push_back(frame);
+		else
+			m_history[m_next] = frame;
+		m_next = (m_next + 1) % m_capacity;
+
+		++m_numFrames;
+		m_logicSteps += frame.logicSteps;
+		m_droppedSteps += frame.droppedSteps;
+		if (frame.hitIterationCap)
+			++m_capHits;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void FrameStatistics::clear()
+	{
+		m_history.clear();
+		m_next = 0;
+		m_numFrames = 0;
+		m_logicSteps = 0;
+		m_droppedSteps = 0;
+		m_capHits = 0;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	auto FrameStatistics::summarize(float Frame::* field) const -> Summary
+	{
+		Summary result;
+		if (m_history.empty())
+			return result;
+
+		m_scratch.clear();
+		double sum = 0.0;
+		for (auto& frame : m_history)
+		{
+			m_scratch.push_back(frame.*field);
+			sum += frame.*field;
+		}
+		std::sort(m_scratch.begin(), m_scratch.end());
+
+		// Nearest rank percentiles
+		auto percentile = [this](float p) {
+			auto rank = size_t(std::ceil(p * m_scratch.size()));
+			return m_scratch[std::clamp<size_t>(rank, 1, m_scratch.size()) - 1];
+		};
+
+		result.min = m_scratch.front();
+		result.max = m_scratch.back();
+		result.avg = float(sum / m_scratch.size());
+		result.p95 = percentile(0.95f);
+		result.p99 = percentile(0.99f);
+		return result;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void FrameStatistics::writeCSV(std::ostream& out) const
+	{
+		out << "frame,update_ms,render_ms,total_ms,logic_steps,dropped_steps,hit_cap\n";
+		const uint64_t firstFrame = m_numFrames - m_history.size();
+		for (size_t i = 0; i < m_history.size(); ++i)
+		{
+			auto& frame = history(i);
+			out << firstFrame + i << ","
+				<< frame.updateMs << ","
+				<< frame.renderMs << ","
+				<< frame.totalMs << ","
+				<< frame.logicSteps << ","
+				<< frame.droppedSteps << ","
+				<< (frame.hitIterationCap ? 1 : 0) << "\n";
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool FrameStatistics::saveCSV(const std::string& fileName) const
+	{
+		std::ofstream out(fileName);
+		if (!out.is_open())
+			return false;
+		writeCSV(out);
+		return out.good();
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void FrameStatistics::print(std::ostream& out) const
+	{
+		auto printSummary = [&out](const char* label, const Summary& s) {
+			out << label << " min " << s.min << " avg " << s.avg << " p95 " << s.p95 << " p99 " << s.p99 << " max " << s.max << " ms\n";
+		};
+		out << "Frames: " << m_numFrames << " (last " << m_history.size() << " in window)\n";
+		printSummary("Update:", update());
+		printSummary("Render:", render());
+		printSummary("Total: ", total());
+		out << "Logic steps: " << m_logicSteps << ", dropped: " << m_droppedSteps << ", iteration cap hits: " << m_capHits << "\n";
+	}
+}
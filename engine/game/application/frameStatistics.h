@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rev::game {
+
+	// Rolling statistics of the application's main loop.
+	// Keeps a fixed size ring with the history of the most recent frames. Summaries are computed over that window,
+	// while step counters accumulate over the whole run.
+	class FrameStatistics
+	{
+	public:
+		struct Frame
+		{
+			float updateMs = 0.f; // Total time spent in logic steps during this frame
+			float renderMs = 0.f;
+			float totalMs = 0.f; // Wall time since the start of the previous frame
+			uint32_t logicSteps = 0; // Fixed steps run this frame
+			uint32_t droppedSteps = 0; // Fixed steps discarded this frame because the loop fell too far behind
+			bool hitIterationCap = false; // The catch-up loop stopped with steps still pending
+		};
+
+		struct Summary
+		{
+			float min = 0.f;
+			float avg = 0.f;
+			float p95 = 0.f;
+			float p99 = 0.f;
+			float max = 0.f;
+		};
+
+		FrameStatistics(size_t historySize = 1024);
+
+		void addFrame(const Frame&);
+		void clear();
+
+		// Summaries over the frames currently in the history ring
+		Summary update() const { return summarize(&Frame::updateMs); }
+		Summary render() const { return summarize(&Frame::renderMs); }
+		Summary total() const { return summarize(&Frame::totalMs); }
+
+		// Whole run counters
+		uint64_t numFrames() const { return m_numFrames; }
+		uint64_t logicSteps() const { return m_logicSteps; }
+		uint64_t droppedSteps() const { return m_droppedSteps; }
+		uint64_t iterationCapHits() const { return m_capHits; }
+
+		// History access. Index 0 is the oldest frame in the ring.
+		size_t historySize() const { return m_history.size(); }
+		size_t historyCapacity() const { return m_capacity; }
+		const Frame& history(size_t i) const { return m_history[(m_next + m_capacity - m_history.size() + i) % m_capacity]; }
+
+		// Dump the history ring, oldest frame first
+		void writeCSV(std::ostream& out) const;
+		bool saveCSV(const std::string& fileName) const;
+		// Human readable summary of the current window
+		void print(std::ostream& out) const;
+
+	private:
+		Summary summarize(float Frame::* field) const;
+
+		size_t m_capacity;
+		size_t m_next = 0;
+		std::vector<Frame> m_history;
+		mutable std::vector<float> m_scratch; // Avoids allocating every time a summary is requested
+
+		uint64_t m_numFrames = 0;
+		uint64_t m_logicSteps = 0;
+		uint64_t m_droppedSteps = 0;
+		uint64_t m_capHits = 0;
+	};
+
+}
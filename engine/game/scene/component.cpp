@@ -6,8 +6,36 @@
 #include "component.h"
 #include "sceneNode.h"
 
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+
 namespace rev { namespace game {
 
+	//----------------------------------------------------------------------------------------------------------------------
+	ComponentTypeId componentTypeId(const std::type_info& type)
+	{
+		static std::mutex registryMutex;
+		static std::unordered_map<std::type_index, ComponentTypeId> registry;
+
+		std::lock_guard lock(registryMutex);
+		auto found = registry.find(type);
+		if (found != registry.end())
+			return found->second;
+
+		// Ids are bit positions in 64 bit masks. Checked in every build, since larger ids would corrupt the masks
+		if (registry.size() >= kMaxComponentTypes)
+		{
+			std::cout << "Can't register component type " << type.name() << ". Only " << kMaxComponentTypes << " component types are supported\n";
+			std::abort();
+		}
+		const auto id = (ComponentTypeId)registry.size();
+		registry.emplace(type, id);
+		return id;
+	}
+
 	//----------------------------------------------------------------------------------------------------------------------
 	Component::~Component() {
 		dettach();
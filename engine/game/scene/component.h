@@ -5,12 +5,37 @@
 // Base component in the component system
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <typeinfo>
 
 namespace rev { namespace game {
 
 	class SceneNode;
 
+	// Dense ids for component types, assigned the first time each type is seen.
+	// Nodes use them to find their components with an array lookup instead of a scan.
+	using ComponentTypeId = uint32_t;
+	using ComponentMask = uint64_t; // One bit per component type id
+	static constexpr ComponentTypeId kMaxComponentTypes = 64;
+
+	// Id of exactly this type. Derived types get their own ids.
+	// Registering more than kMaxComponentTypes types aborts, in all build configurations.
+	ComponentTypeId componentTypeId(const std::type_info& type);
+
+	template<class T>
+	ComponentTypeId componentTypeId()
+	{
+		static const ComponentTypeId id = componentTypeId(typeid(T)); // Only the first call goes to the registry
+		return id;
+	}
+
+	template<class ... T>
+	ComponentMask componentMask()
+	{
+		return ((ComponentMask(1) << componentTypeId<T>()) | ... | ComponentMask(0));
+	}
+
 	class Component
 	{
 	public:
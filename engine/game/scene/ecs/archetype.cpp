@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "archetype.h"
+
+namespace rev::game {
+
+	namespace
+	{
+		size_t alignUp(size_t offset, size_t alignment)
+		{
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Archetype::Archetype(ComponentMask mask, std::vector<const ComponentInfo*> components)
+		: m_mask(mask)
+		, m_components(std::move(components))
+	{
+		assert(std::is_sorted(m_components.begin(), m_components.end(), [](auto a, auto b) { return a->id < b->id; }));
+		m_columnNdx.fill(uint8_t(-1));
+		size_t rowSize = sizeof(Entity);
+		for (size_t i = 0; i < m_components.size(); ++i)
+		{
+			assert(m_components[i]->alignment <= kChunkAlignment);
+			assert(hasComponent(m_components[i]->id));
+			m_columnNdx[m_components[i]->id] = uint8_t(i);
+			rowSize += m_components[i]->size;
+		}
+
+		// As many rows as fit in a chunk, once columns are padded for alignment
+		m_columnOffset.resize(m_components.size());
+		for (m_chunkCapacity = kChunkSize / rowSize; m_chunkCapacity > 0; --m_chunkCapacity)
+		{
+			size_t offset = m_chunkCapacity * sizeof(Entity);
+			for (size_t i = 0; i < m_components.size(); ++i)
+			{
+				offset = alignUp(offset, m_components[i]->alignment);
+				m_columnOffset[i] = offset;
+				offset += m_chunkCapacity * m_components[i]->size;
+			}
+			if (offset <= kChunkSize)
+				break;
+		}
+		assert(m_chunkCapacity > 0); // Components too large for a chunk
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Archetype::~Archetype()
+	{
+		while (m_size)
+			destroyRow(uint32_t(m_size - 1));
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t Archetype::allocate(Entity entity)
+	{
+		if (m_size == m_chunks.size() * m_chunkCapacity)
+			m_chunks.push_back(std::make_unique<Chunk>());
+		const auto row = (uint32_t)m_size++;
+		this->entity(row) = entity;
+		return row;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Entity Archetype::removeRow(uint32_t row)
+	{
+		assert(row < m_size);
+		const auto last = uint32_t(m_size - 1);
+		Entity moved;
+		if (row != last)
+		{
+			for (auto info : m_components)
+				info->relocate(component(row, info->id), component(last, info->id));
+			moved = entity(last);
+			entity(row) = moved;
+		}
+
+		--m_size;
+		if (m_size == (m_chunks.size() - 1) * m_chunkCapacity)
+			m_chunks.pop_back(); // Last chunk is empty
+		return moved;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Entity Archetype::destroyRow(uint32_t row)
+	{
+		for (auto info : m_components)
+			info->destroy(component(row, info->id));
+		return removeRow(row);
+	}
+
+}
@@ -0,0 +1,141 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <game/scene/component.h>
+
+namespace rev::game {
+
+	// Handle to an entity of an EntityWorld.
+	// The generation tells apart entities that reuse the slot of a destroyed one.
+	struct Entity
+	{
+		static constexpr uint32_t kInvalidIndex = uint32_t(-1);
+
+		uint32_t index = kInvalidIndex;
+		uint32_t generation = 0;
+
+		bool operator==(const Entity&) const = default;
+	};
+
+	// Type erased operations on an ECS component type.
+	// Components are plain values, moved around as entities change archetype.
+	struct ComponentInfo
+	{
+		ComponentTypeId id;
+		size_t size;
+		size_t alignment;
+		void (*relocate)(void* dst, void* src); // Move constructs dst from src, then destroys src
+		void (*destroy)(void* component);
+
+		template<class T>
+		static const ComponentInfo& get()
+		{
+			static const ComponentInfo info = {
+				componentTypeId<T>(),
+				sizeof(T),
+				alignof(T),
+				[](void* dst, void* src) {
+					new (dst) T(std::move(*static_cast<T*>(src)));
+					static_cast<T*>(src)->~T();
+				},
+				[](void* component) { static_cast<T*>(component)->~T(); }
+			};
+			return info;
+		}
+	};
+
+	// Storage for all the entities with exactly the same set of component types.
+	// Entities are packed in 16KB chunks. Each chunk is structure of arrays: the entity handles, then one array per
+	// component type, so iterating a component touches contiguous memory.
+	// Rows are dense. Every chunk but the last one is full, and removing a row moves the last one into its place.
+	class Archetype
+	{
+	public:
+		static constexpr size_t kChunkSize = 16 * 1024;
+		static constexpr size_t kChunkAlignment = 64;
+
+		// components must be sorted by id
+		Archetype(ComponentMask mask, std::vector<const ComponentInfo*> components);
+		~Archetype();
+
+		Archetype(const Archetype&) = delete;
+		Archetype& operator=(const Archetype&) = delete;
+
+		ComponentMask mask() const { return m_mask; }
+		const auto& components() const { return m_components; }
+		bool hasComponent(ComponentTypeId id) const { return m_mask & (ComponentMask(1) << id); }
+
+		size_t size() const { return m_size; }
+		size_t chunkCapacity() const { return m_chunkCapacity; }
+		size_t numChunks() const { return m_chunks.size(); }
+		size_t chunkSize(size_t chunk) const { return std::min(m_chunkCapacity, m_size - chunk * m_chunkCapacity); }
+
+		Entity* entities(size_t chunk) { return reinterpret_cast<Entity*>(m_chunks[chunk]->data); }
+		void* column(size_t chunk, ComponentTypeId id)
+		{
+			assert(hasComponent(id));
+			return m_chunks[chunk]->data + m_columnOffset[m_columnNdx[id]];
+		}
+		template<class T>
+		T* column(size_t chunk) { return static_cast<T*>(column(chunk, componentTypeId<T>())); }
+
+		Entity& entity(uint32_t row) { return entities(row / m_chunkCapacity)[row % m_chunkCapacity]; }
+		void* component(uint32_t row, ComponentTypeId id)
+		{
+			auto column = static_cast<std::byte*>(this->column(row / m_chunkCapacity, id));
+			return column + (row % m_chunkCapacity) * m_components[m_columnNdx[id]]->size;
+		}
+
+		// Appends a row for entity, and returns it. Components are left unconstructed.
+		uint32_t allocate(Entity entity);
+		// Removes the row, moving the last one into its place.
+		// Components must have been destroyed or relocated already.
+		// Returns the entity that was moved to the row, if any.
+		Entity removeRow(uint32_t row);
+		// Destroys the components of the row, then removes it
+		Entity destroyRow(uint32_t row);
+
+	private:
+		struct alignas(kChunkAlignment) Chunk
+		{
+			std::byte data[kChunkSize];
+		};
+
+		ComponentMask m_mask;
+		std::vector<const ComponentInfo*> m_components;
+		std::array<uint8_t, kMaxComponentTypes> m_columnNdx; // Column of each component type in the mask
+		std::vector<size_t> m_columnOffset; // Byte offset of each column in a chunk
+		size_t m_chunkCapacity = 0;
+		size_t m_size = 0;
+		std::vector<std::unique_ptr<Chunk>> m_chunks;
+	};
+
+}
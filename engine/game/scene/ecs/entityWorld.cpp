@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "entityWorld.h"
+
+namespace rev::game {
+
+	//------------------------------------------------------------------------------------------------------------------
+	void EntityWorld::destroy(Entity entity)
+	{
+		assert(isAlive(entity));
+		auto& record = m_entities[entity.index];
+		updateMovedEntity(record.archetype->destroyRow(record.row), record.row);
+		record.archetype = nullptr;
+		++record.generation; // Invalidates existing handles
+		m_freeEntities.push_back(entity.index);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Entity EntityWorld::allocateEntity()
+	{
+		Entity entity;
+		if (m_freeEntities.empty())
+		{
+			entity.index = (uint32_t)m_entities.size();
+			m_entities.emplace_back();
+		}
+		else
+		{
+			entity.index = m_freeEntities.back();
+			m_freeEntities.pop_back();
+		}
+		entity.generation = m_entities[entity.index].generation;
+		return entity;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Archetype& EntityWorld::findArchetype(std::vector<const ComponentInfo*> components)
+	{
+		ComponentMask mask = 0;
+		for (auto info : components)
+		{
+			assert(!(mask & (ComponentMask(1) << info->id))); // Repeated component type
+			mask |= ComponentMask(1) << info->id;
+		}
+
+		auto& archetype = m_archetypeByMask[mask];
+		if (!archetype)
+		{
+			std::sort(components.begin(), components.end(), [](auto a, auto b) { return a->id < b->id; });
+			archetype = m_archetypes.emplace_back(std::make_unique<Archetype>(mask, std::move(components))).get();
+		}
+		return *archetype;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void EntityWorld::moveEntity(Entity entity, Archetype& dst)
+	{
+		auto& record = m_entities[entity.index];
+		auto& src = *record.archetype;
+		const auto srcRow = record.row;
+		const auto dstRow = dst.allocate(entity);
+
+		// Keep the components both archetypes share, and drop the rest
+		for (auto info : src.components())
+		{
+			if (dst.hasComponent(info->id))
+				info->relocate(dst.component(dstRow, info->id), src.component(srcRow, info->id));
+			else
+				info->destroy(src.component(srcRow, info->id));
+		}
+		updateMovedEntity(src.removeRow(srcRow), srcRow);
+
+		record.archetype = &dst;
+		record.row = dstRow;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void EntityWorld::updateMovedEntity(Entity moved, uint32_t row)
+	{
+		if (moved.index != Entity::kInvalidIndex)
+			m_entities[moved.index].row = row;
+	}
+
+}
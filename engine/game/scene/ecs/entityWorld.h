@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <core/tasks/parallelFor.h>
+#include "archetype.h"
+
+namespace rev::game {
+
+	// Archetype based entity component storage.
+	// Entities with the same set of component types share an Archetype, so queries walk contiguous arrays of components
+	// chunk by chunk instead of chasing pointers through a node tree.
+	// Adding or removing components moves the entity to another archetype, which invalidates pointers to its components.
+	// Structural changes (creating or destroying entities, adding or removing components) are not allowed while iterating.
+	class EntityWorld
+	{
+	public:
+		EntityWorld() = default;
+		EntityWorld(const EntityWorld&) = delete;
+		EntityWorld& operator=(const EntityWorld&) = delete;
+
+		template<class ... T>
+		Entity create(T&& ... components)
+		{
+			static_assert(sizeof...(T) < kMaxComponentTypes);
+			const ComponentInfo* infos[] = { &ComponentInfo::get<std::decay_t<T>>()..., nullptr };
+			auto& archetype = findArchetype(std::vector<const ComponentInfo*>(infos, infos + sizeof...(T)));
+			const auto entity = allocateEntity();
+			auto& record = m_entities[entity.index];
+			record.archetype = &archetype;
+			record.row = archetype.allocate(entity);
+			(new (archetype.component(record.row, componentTypeId<std::decay_t<T>>())) std::decay_t<T>(std::forward<T>(components)), ...);
+			return entity;
+		}
+
+		void destroy(Entity entity);
+		bool isAlive(Entity entity) const
+		{
+			return entity.index < m_entities.size() && m_entities[entity.index].generation == entity.generation && m_entities[entity.index].archetype;
+		}
+		size_t size() const { return m_entities.size() - m_freeEntities.size(); }
+
+		// Component of the entity, or null if it doesn't have one
+		template<class T>
+		T* get(Entity entity)
+		{
+			assert(isAlive(entity));
+			auto& record = m_entities[entity.index];
+			const auto typeId = componentTypeId<T>();
+			if (!record.archetype->hasComponent(typeId))
+				return nullptr;
+			return static_cast<T*>(record.archetype->component(record.row, typeId));
+		}
+
+		// Replaces the component if the entity already has one
+		template<class T>
+		T& add(Entity entity, T&& component)
+		{
+			using C = std::decay_t<T>;
+			if (auto existing = get<C>(entity))
+				return *existing = std::forward<T>(component);
+
+			auto components = m_entities[entity.index].archetype->components();
+			components.push_back(&ComponentInfo::get<C>());
+			moveEntity(entity, findArchetype(std::move(components)));
+			auto& record = m_entities[entity.index];
+			return *new (record.archetype->component(record.row, componentTypeId<C>())) C(std::forward<T>(component));
+		}
+
+		template<class T>
+		void remove(Entity entity)
+		{
+			assert(isAlive(entity));
+			const auto typeId = componentTypeId<T>();
+			auto components = m_entities[entity.index].archetype->components();
+			auto i = std::find_if(components.begin(), components.end(), [=](auto info) { return info->id == typeId; });
+			if (i == components.end())
+				return;
+			components.erase(i);
+			moveEntity(entity, findArchetype(std::move(components)));
+		}
+
+		// op(count, T*...) for each chunk with all the component types in T. Arrays hold count components.
+		template<class ... T, class Op>
+		void forEachChunk(const Op& op)
+		{
+			const auto mask = componentMask<T...>();
+			for (auto& archetype : m_archetypes)
+			{
+				if ((archetype->mask() & mask) != mask)
+					continue;
+				for (size_t chunk = 0; chunk < archetype->numChunks(); ++chunk)
+					op(archetype->chunkSize(chunk), archetype->column<T>(chunk)...);
+			}
+		}
+
+		// op(T&...), or op(Entity, T&...), for each entity with all the component types in T
+		template<class ... T, class Op>
+		void forEach(const Op& op)
+		{
+			const auto mask = componentMask<T...>();
+			for (auto& archetype : m_archetypes)
+			{
+				if ((archetype->mask() & mask) == mask)
+				{
+					for (size_t chunk = 0; chunk < archetype->numChunks(); ++chunk)
+						forEachInChunk<T...>(*archetype, chunk, op);
+				}
+			}
+		}
+
+		// Like forEach, with chunks spread across the pool's workers.
+		// op runs concurrently for different entities, so it must only write to the components it is given.
+		template<class ... T, class Op>
+		void parallelForEach(core::ThreadPool& pool, const Op& op)
+		{
+			const auto mask = componentMask<T...>();
+			std::vector<std::pair<Archetype*, size_t>> chunks;
+			for (auto& archetype : m_archetypes)
+			{
+				if ((archetype->mask() & mask) != mask)
+					continue;
+				for (size_t chunk = 0; chunk < archetype->numChunks(); ++chunk)
+					chunks.emplace_back(archetype.get(), chunk);
+			}
+			core::parallelFor(pool, 0, chunks.size(), 1, [&](size_t i) {
+				forEachInChunk<T...>(*chunks[i].first, chunks[i].second, op);
+			});
+		}
+
+		size_t numArchetypes() const { return m_archetypes.size(); }
+
+	private:
+		struct EntityRecord
+		{
+			Archetype* archetype = nullptr; // Null for free records
+			uint32_t row = 0;
+			uint32_t generation = 0;
+		};
+
+		template<class ... T, class Op>
+		static void forEachInChunk(Archetype& archetype, size_t chunk, const Op& op)
+		{
+			const auto count = archetype.chunkSize(chunk);
+			auto columns = std::make_tuple(archetype.column<T>(chunk)...);
+			auto entities = archetype.entities(chunk);
+			for (size_t i = 0; i < count; ++i)
+			{
+				if constexpr (std::is_invocable_v<const Op&, Entity, T&...>)
+					std::apply([&](auto ... column) { op(entities[i], column[i]...); }, columns);
+				else
+					std::apply([&](auto ... column) { op(column[i]...); }, columns);
+			}
+		}
+
+		Entity allocateEntity();
+		// Archetype for exactly these component types, in any order
+		Archetype& findArchetype(std::vector<const ComponentInfo*> components);
+		void moveEntity(Entity entity, Archetype& dst);
+		// Points the record of the entity that was moved to row by a removal to its new row
+		void updateMovedEntity(Entity moved, uint32_t row);
+
+		std::vector<EntityRecord> m_entities;
+		std::vector<uint32_t> m_freeEntities;
+		std::vector<std::unique_ptr<Archetype>> m_archetypes;
+		std::unordered_map<ComponentMask, Archetype*> m_archetypeByMask;
+	};
+
+}
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "sceneNodeAdapter.h"
+
+#include <cmath>
+#include <core/tasks/parallelFor.h>
+#include <game/animation/animator.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+#include <math/algebra/affineTransform.h>
+
+namespace rev::game {
+
+	namespace
+	{
+		Entity importSubtree(SceneNode& node, TransformHierarchy::NodeId parentTransform, EntityWorld& world, TransformHierarchy& transforms)
+		{
+			const auto entity = world.create(SceneNodeRef{ &node });
+
+			auto transform = node.component<Transform>();
+			if (transform)
+			{
+				parentTransform = transforms.addNode(transform->matrix(), parentTransform);
+				world.add(entity, TransformRef{ parentTransform });
+			}
+
+			auto animator = node.component<Animator>();
+			if (animator && animator->animation())
+			{
+				AnimationPlayback playback;
+				playback.animation = animator->animation();
+				playback.time = animator->time();
+				playback.loop = animator->isLooping();
+				playback.rotation = transform ? transform->xForm.rotation() : math::Quatf::identity();
+				world.add(entity, std::move(playback));
+			}
+
+			for (auto& child : node.children())
+				importSubtree(*child, parentTransform, world, transforms);
+			return entity;
+		}
+
+		void sampleAnimation(AnimationPlayback& playback, float dt)
+		{
+			auto& animation = *playback.animation;
+			playback.time += dt;
+			const auto duration = animation.duration();
+			if (playback.loop && duration > 0.f && playback.time > duration)
+				playback.time = std::fmod(playback.time, duration);
+
+			gfx::Pose::JointPose pose;
+			pose.rotation = playback.rotation;
+			animation.getChannelPose(0, playback.time, pose, playback.cursor);
+			playback.rotation = pose.rotation;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	Entity importSceneNodes(SceneNode& root, EntityWorld& world, TransformHierarchy& transforms)
+	{
+		return importSubtree(root, TransformHierarchy::kNoParent, world, transforms);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void updateAnimations(EntityWorld& world, TransformHierarchy& transforms, float dt, core::ThreadPool* pool)
+	{
+		auto sample = [dt](AnimationPlayback& playback) { sampleAnimation(playback, dt); };
+		if (pool)
+			world.parallelForEach<AnimationPlayback>(*pool, sample);
+		else
+			world.forEach<AnimationPlayback>(sample);
+
+		// The hierarchy tracks changes per node, so writes go through a single thread
+		world.forEach<AnimationPlayback, TransformRef>([&](AnimationPlayback& playback, TransformRef& transform) {
+			math::AffineTransform local;
+			local.matrix() = transforms.local(transform.node);
+			local.setRotation(playback.rotation);
+			transforms.setLocal(transform.node, local.matrix());
+		});
+	}
+
+}
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <memory>
+
+#include <game/scene/transform/transformHierarchy.h>
+#include <gfx/scene/animation/animation.h>
+#include "entityWorld.h"
+
+namespace rev::core
+{
+	class ThreadPool;
+}
+
+namespace rev::game {
+
+	class SceneNode;
+
+	// ECS components for scene nodes imported into an EntityWorld
+	struct SceneNodeRef
+	{
+		SceneNode* node;
+	};
+
+	// World transforms are kept in a TransformHierarchy, which updates them in depth order
+	struct TransformRef
+	{
+		TransformHierarchy::NodeId node;
+	};
+
+	// State of an Animator. Animates the rotation of the entity's transform, like Animator does
+	struct AnimationPlayback
+	{
+		std::shared_ptr<gfx::Animation> animation;
+		float time = 0.f;
+		bool loop = false;
+		math::Quatf rotation = math::Quatf::identity(); // Last sampled rotation
+		gfx::Animation::Cursor cursor;
+	};
+
+	// Creates an entity for each node in the subtree of root, like the ones loaded from glTF files, and returns the one of root.
+	// Every entity gets a SceneNodeRef. Nodes with a Transform get a TransformRef to a node of transforms, parented to the
+	// closest ancestor with a Transform. Nodes with a playing Animator get its AnimationPlayback.
+	// The scene nodes are left untouched.
+	Entity importSceneNodes(SceneNode& root, EntityWorld& world, TransformHierarchy& transforms);
+
+	// Advances animations and writes the sampled rotations to the local transforms of their entities.
+	// Sampling is spread over chunks when there is a pool. Call transforms.update() afterwards to get world matrices.
+	void updateAnimations(EntityWorld& world, TransformHierarchy& transforms, float dt, core::ThreadPool* pool = nullptr);
+
+}
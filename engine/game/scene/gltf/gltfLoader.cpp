@@ -24,6 +24,8 @@
 
 #include <core/platform/fileSystem/fileSystem.h>
 #include <core/platform/fileSystem/file.h>
+#include <game/animation/animator.h>
+#include <game/animation/skeleton.h>
 #include <game/scene/meshRenderer.h>
 #include <game/scene/transform/transform.h>
 #include <gfx/backend/Vulkan/gpuBuffer.h>
@@ -112,6 +114,13 @@ namespace rev::game {
 			static constexpr gltf::Accessor::Type type = gltf::Accessor::Type::Vec2;
 		};
 
+		template<>
+		struct AccessorTraits<float>
+		{
+			static constexpr gltf::Accessor::ComponentType componentType = gltf::Accessor::ComponentType::Float;
+			static constexpr gltf::Accessor::Type type = gltf::Accessor::Type::Scalar;
+		};
+
 		template<>
 		struct AccessorTraits<uint8_t>
 		{
@@ -200,6 +209,94 @@ namespace rev::game {
 			return result;
 		}
 
+		// Rotation and translation channels of an animation, one per animated node, with the glTF node each one targets.
+		// Nodes with rotation keys go first, because the clip takes its duration from channel 0.
+		// Returns null for animations without rotation keys.
+		std::shared_ptr<gfx::Animation> loadAnimation(const gltf::Document& document, const gltf::Animation& animDesc)
+		{
+			auto animation = std::make_shared<gfx::Animation>();
+			auto& channelNodes = animation->m_channelNodes;
+			auto addTargetNodes = [&](const char* path) {
+				for (auto& channelDesc : animDesc.channels)
+				{
+					const auto node = uint32_t(channelDesc.target.node);
+					if (channelDesc.target.node >= 0 && channelDesc.target.path == path
+						&& std::find(channelNodes.begin(), channelNodes.end(), node) == channelNodes.end())
+						channelNodes.push_back(node);
+				}
+			};
+			addTargetNodes("rotation");
+			if (channelNodes.empty())
+				return nullptr;
+			addTargetNodes("translation");
+
+			animation->m_rotationChannels.resize(channelNodes.size());
+			animation->m_translationChannels.resize(channelNodes.size());
+			for (auto& channelDesc : animDesc.channels)
+			{
+				const bool rotation = channelDesc.target.path == "rotation";
+				if (!rotation && channelDesc.target.path != "translation")
+					continue; // Scale and morph weights are not animated
+				const auto channelNdx = std::find(channelNodes.begin(), channelNodes.end(), uint32_t(channelDesc.target.node)) - channelNodes.begin();
+
+				// Cubic spline samplers store an in and out tangent around each value. Only the values are kept,
+				// since clips are always interpolated linearly.
+				const auto& sampler = animDesc.samplers[channelDesc.sampler];
+				const bool cubic = sampler.interpolation == gltf::Animation::Sampler::Type::CubicSpline;
+				const size_t stride = cubic ? 3 : 1;
+				const size_t offset = cubic ? 1 : 0;
+				auto times = extractBufferData<float>(document, sampler.input, gltf::BufferView::TargetType::None);
+				if (rotation)
+				{
+					auto& channel = animation->m_rotationChannels[channelNdx];
+					const auto values = extractBufferData<Vec4f>(document, sampler.output, gltf::BufferView::TargetType::None);
+					for (size_t i = 0; i < times.size(); ++i)
+					{
+						const auto& q = values[stride * i + offset];
+						channel.values.emplace_back(q.x(), q.y(), q.z(), q.w());
+					}
+					channel.t = std::move(times);
+				}
+				else
+				{
+					auto& channel = animation->m_translationChannels[channelNdx];
+					const auto values = extractBufferData<Vec3f>(document, sampler.output, gltf::BufferView::TargetType::None);
+					for (size_t i = 0; i < times.size(); ++i)
+						channel.values.push_back(values[stride * i + offset]);
+					channel.t = std::move(times);
+				}
+			}
+
+			return animation;
+		}
+
+		// Plays the first animation of the document in a loop on root, driving a skeleton made of the nodes it animates.
+		// Joints keep their glTF node indices, so every channel reaches its node through Skeleton::channelJoints.
+		void loadAnimator(const gltf::Document& document, const vector<shared_ptr<SceneNode>>& sceneNodes, SceneNode& root)
+		{
+			if (document.animations.empty())
+				return;
+			auto animation = loadAnimation(document, document.animations.front());
+			if (!animation)
+			{
+				std::cout << "Animation " << document.animations.front().name << " has no rotation keys and will not be played\n";
+				return;
+			}
+
+			vector<shared_ptr<SceneNode>> joints;
+			joints.reserve(animation->m_channelNodes.size());
+			for (auto nodeNdx : animation->m_channelNodes)
+			{
+				auto& joint = joints.emplace_back(sceneNodes[nodeNdx]);
+				if (!joint->component<Transform>()) // Nodes without a transform in the file are at their parent's origin
+					joint->addComponent<Transform>();
+			}
+
+			auto animator = root.addComponent<Animator>();
+			animator->playAnimation(animation, true);
+			animator->setSkeleton(make_shared<Skeleton>(joints, animation->m_channelNodes));
+		}
+
 		void loadMaterials(const gltf::Document& document, gfx::RasterScene& scene)
 		{
 			for (auto& gltfMaterial : document.materials)
@@ -429,16 +526,18 @@ namespace rev::game {
 		}
 
 		auto& scene = _document.scenes[_document.scene];
+		shared_ptr<SceneNode> rootNode;
 		if (scene.nodes.size() == 1)
-			return sceneNodes[scene.nodes.front()];
+			rootNode = sceneNodes[scene.nodes.front()];
 		else
 		{
-			auto rootNode = make_shared<SceneNode>("Gltf root");
+			rootNode = make_shared<SceneNode>("Gltf root");
 			for (auto id : scene.nodes)
 				rootNode->addChild(sceneNodes[id]);
-
-			return rootNode;
 		}
+
+		loadAnimator(_document, sceneNodes, *rootNode);
+		return rootNode;
 	}
 
 	/*
@@ -601,6 +700,7 @@ namespace rev::game {
 			// Resize animation to fit all the channels
 			animation->m_translationChannels.resize(usedNodes.size());
 			animation->m_rotationChannels.resize(usedNodes.size());
+			animation->m_channelNodes.assign(usedNodes.begin(), usedNodes.end());
 			// Load channel contents
 			for(auto& channelDesc : animDesc.channels)
 			{
@@ -18,6 +18,7 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <cassert>
+#include <limits>
 #include "sceneNode.h"
 #include "component.h"
 #include <core/tools/log.h>
@@ -48,6 +49,16 @@ namespace rev { namespace game {
 		assert(!_c->node());
 		assert(_c->node() != this);
 		_c->attachTo(this);
+
+		auto& component = *_c;
+		const auto typeId = componentTypeId(typeid(component));
+		const auto typeBit = ComponentMask(1) << typeId;
+		if(!(mComponentMask & typeBit)) // Lookups return the first component of each type
+		{
+			assert(mComponents.size() <= std::numeric_limits<uint8_t>::max());
+			mComponentIndex[typeId] = (uint8_t)mComponents.size();
+			mComponentMask |= typeBit;
+		}
 		mComponents.emplace_back(std::move(_c));
 	}
 
@@ -18,6 +18,7 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
+#include <array>
 #include <vector>
 #include "component.h"
 #include <iostream>
@@ -50,16 +51,18 @@ namespace rev { namespace game {
 		void	addComponent	(std::unique_ptr<Component> _c);
 		auto&	components		() const { return mComponents; }
 
+		// First component of exactly type T_, or null
 		template<class T_>	
 		T_*					component		() const {
-			for (auto& c : mComponents) {
-				auto rawPtr = c.get();
-				if(typeid(*rawPtr) == typeid(T_))
-					return static_cast<T_*>(rawPtr);
-			}
-			return nullptr;
+			const auto typeId = componentTypeId<T_>();
+			if(!(mComponentMask & (ComponentMask(1) << typeId)))
+				return nullptr;
+			return static_cast<T_*>(mComponents[mComponentIndex[typeId]].get());
 		}
 
+		ComponentMask componentMask() const { return mComponentMask; }
+		bool hasComponents(ComponentMask mask) const { return (mComponentMask & mask) == mask; }
+
 		// This traverse includes the node itself
 		template<class Op>
 		void traverseSubtree(const Op& op)
@@ -71,6 +74,27 @@ namespace rev { namespace game {
 			}
 		}
 
+		// Like traverseSubtree, but only visits the nodes that have all the component types in mask
+		template<class Op>
+		void traverseSubtree(ComponentMask mask, const Op& op)
+		{
+			if(hasComponents(mask))
+				op(*this);
+			for(auto& c : mChildren)
+			{
+				c->traverseSubtree(mask, op);
+			}
+		}
+
+		// Visits the nodes that have all the component types in T_..., as op(node, T_&...)
+		template<class ... T_, class Op>
+		void traverseComponents(const Op& op)
+		{
+			traverseSubtree(game::componentMask<T_...>(), [&](SceneNode& node) {
+				op(node, *node.component<T_>()...);
+			});
+		}
+
 		template<class T, class ... Args>
 		T* addComponent(Args ... args)
 		{
@@ -84,5 +108,7 @@ namespace rev { namespace game {
 		SceneNode* mParent = nullptr;
 		std::vector<std::shared_ptr<SceneNode>> mChildren;
 		std::vector<std::unique_ptr<Component>>	mComponents;
+		ComponentMask mComponentMask = 0;
+		std::array<uint8_t, kMaxComponentTypes> mComponentIndex; // Position in mComponents of each type in the mask
 	};
 }}
@@ -0,0 +1,205 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "transformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <math/algebra/matrixBatch.h>
+
+using namespace rev::math;
+
+namespace rev { namespace game {
+
+	//------------------------------------------------------------------------------------------------------------------
+	TransformHierarchy::NodeId TransformHierarchy::addNode(const Mat44f& local, NodeId parent)
+	{
+		assert(parent == kNoParent || parent < size());
+		const auto id = (NodeId)size();
+		const auto slot = (uint32_t)m_local.size();
+		const uint32_t depth = (parent == kNoParent) ? 0 : m_depth[parent] + 1;
+
+		m_parentId.push_back(parent);
+		m_depth.push_back(depth);
+		m_slot.push_back(slot);
+		m_local.push_back(local);
+		m_world.push_back(local);
+		m_parentSlot.push_back(parent == kNoParent ? slot : m_slot[parent]);
+		m_slotNode.push_back(id);
+		m_dirty.push_back(1);
+		m_anyDirty = true;
+
+		// Nodes added in depth order, like when loading a scene breadth first, keep the arrays sorted
+		if (!m_sorted)
+			return id;
+		const auto numLevels = (uint32_t)m_levelStart.size() - 1;
+		if (depth + 1 == numLevels)
+			m_levelStart.back() = slot + 1;
+		else if (depth == numLevels)
+			m_levelStart.push_back(slot + 1);
+		else
+			m_sorted = false;
+		return id;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void TransformHierarchy::clear()
+	{
+		m_parentId.clear();
+		m_depth.clear();
+		m_slot.clear();
+		m_local.clear();
+		m_world.clear();
+		m_parentSlot.clear();
+		m_slotNode.clear();
+		m_dirty.clear();
+		m_levelStart.assign(1, 0);
+		m_sorted = true;
+		m_anyDirty = false;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void TransformHierarchy::setLocal(NodeId node, const Mat44f& local)
+	{
+		const auto slot = m_slot[node];
+		m_local[slot] = local;
+		m_dirty[slot] = 1;
+		m_anyDirty = true;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void TransformHierarchy::setParent(NodeId node, NodeId parent)
+	{
+		assert(node < size());
+		assert(parent == kNoParent || parent < size());
+#ifndef NDEBUG
+		for (auto ancestor = parent; ancestor != kNoParent; ancestor = m_parentId[ancestor])
+			assert(ancestor != node); // Would create a cycle
+#endif
+		m_parentId[node] = parent;
+		m_sorted = false; // Depths in the subtree change
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	size_t TransformHierarchy::update()
+	{
+		sortNodes();
+		if (!m_anyDirty)
+			return 0;
+
+		size_t numUpdated = 0;
+		for (uint32_t slot = m_levelStart[0]; slot < m_levelStart[1]; ++slot)
+		{
+			if (m_dirty[slot])
+			{
+				m_world[slot] = m_local[slot];
+				++numUpdated;
+			}
+		}
+
+		for (size_t level = 1; level + 1 < m_levelStart.size(); ++level)
+		{
+			const uint32_t begin = m_levelStart[level];
+			const uint32_t end = m_levelStart[level + 1];
+
+			// Changes propagate down from the previous level
+			for (uint32_t slot = begin; slot < end; ++slot)
+				m_dirty[slot] |= m_dirty[m_parentSlot[slot]];
+
+			// Parents are all in previous levels, so each run can be written in a single batch
+			for (uint32_t runBegin = begin; runBegin < end;)
+			{
+				if (!m_dirty[runBegin])
+				{
+					++runBegin;
+					continue;
+				}
+				uint32_t runEnd = runBegin + 1;
+				while (runEnd < end && m_dirty[runEnd])
+					++runEnd;
+				batchMultiply(runEnd - runBegin, m_world.data(), &m_parentSlot[runBegin], &m_local[runBegin], &m_world[runBegin]);
+				numUpdated += runEnd - runBegin;
+				runBegin = runEnd;
+			}
+		}
+
+		std::fill(m_dirty.begin(), m_dirty.end(), uint8_t(0));
+		m_anyDirty = false;
+		return numUpdated;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Counting sort of nodes by depth. Stable, so nodes of the same depth keep the order they were added in.
+	// Every world matrix is recomputed after sorting.
+	void TransformHierarchy::sortNodes()
+	{
+		if (m_sorted)
+			return;
+
+		// Parents may come after their children once nodes are moved, so depths are resolved walking up the tree
+		const auto numNodes = (uint32_t)size();
+		constexpr uint32_t kUnknown = uint32_t(-1);
+		m_depth.assign(numNodes, kUnknown);
+		std::vector<NodeId> path;
+		for (NodeId node = 0; node < numNodes; ++node)
+		{
+			auto ancestor = node;
+			while (ancestor != kNoParent && m_depth[ancestor] == kUnknown)
+			{
+				path.push_back(ancestor);
+				ancestor = m_parentId[ancestor];
+			}
+			uint32_t depth = (ancestor == kNoParent) ? 0 : m_depth[ancestor] + 1;
+			for (auto i = path.rbegin(); i != path.rend(); ++i)
+				m_depth[*i] = depth++;
+			path.clear();
+		}
+
+		const auto numLevels = numNodes ? *std::max_element(m_depth.begin(), m_depth.end()) + 1 : 0;
+		m_levelStart.assign(numLevels + 1, 0);
+		for (auto depth : m_depth)
+			++m_levelStart[depth + 1];
+		for (uint32_t i = 0; i < numLevels; ++i)
+			m_levelStart[i + 1] += m_levelStart[i];
+
+		// Visit nodes in their current order, so that nodes of a level keep their relative order
+		std::vector<uint32_t> levelEnd(m_levelStart.begin(), m_levelStart.end() - 1);
+		std::vector<Mat44f> sortedLocal(numNodes);
+		for (uint32_t slot = 0; slot < numNodes; ++slot)
+		{
+			const auto node = m_slotNode[slot];
+			const auto dst = levelEnd[m_depth[node]]++;
+			sortedLocal[dst] = m_local[slot];
+			m_slot[node] = dst;
+		}
+		m_local = std::move(sortedLocal);
+		for (NodeId node = 0; node < numNodes; ++node)
+		{
+			const auto slot = m_slot[node];
+			m_slotNode[slot] = node;
+			const auto parent = m_parentId[node];
+			m_parentSlot[slot] = (parent == kNoParent) ? slot : m_slot[parent];
+		}
+
+		m_dirty.assign(numNodes, 1);
+		m_anyDirty = numNodes > 0;
+		m_sorted = true;
+	}
+
+} }	// namespace rev::game
@@ -0,0 +1,77 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <math/algebra/matrix.h>
+
+namespace rev { namespace game {
+
+	// Flat transform hierarchy.
+	// Local and world matrices live in contiguous arrays, sorted by depth, with one parent index per node.
+	// Nodes keep their ids when the arrays are sorted. Each update walks the levels in order, so parents are always
+	// final before their children, and only recomputes the subtrees under nodes that changed since the last update.
+	// Each run of changed nodes in a level is propagated with a single batched matrix product.
+	class TransformHierarchy
+	{
+	public:
+		using NodeId = uint32_t;
+		static constexpr NodeId kNoParent = NodeId(-1);
+
+		// Parents must be added before their children
+		NodeId addNode(const math::Mat44f& local, NodeId parent = kNoParent);
+		void clear();
+
+		void setLocal(NodeId node, const math::Mat44f& local);
+		// Moves the node and its subtree under a new parent. Invalidates the order of nodes.
+		void setParent(NodeId node, NodeId parent);
+
+		const math::Mat44f& local(NodeId node) const { return m_local[m_slot[node]]; }
+		// As of the last update
+		const math::Mat44f& world(NodeId node) const { return m_world[m_slot[node]]; }
+		NodeId parent(NodeId node) const { return m_parentId[node]; }
+		size_t size() const { return m_parentId.size(); }
+
+		// Recomputes the world matrices of changed nodes and their descendants.
+		// Returns the number of world matrices written.
+		size_t update();
+
+	private:
+		void sortNodes();
+
+		// Indexed by id
+		std::vector<NodeId> m_parentId;
+		std::vector<uint32_t> m_depth;
+		std::vector<uint32_t> m_slot; // Position of each node in the sorted arrays
+
+		// Indexed by slot, sorted by depth
+		std::vector<math::Mat44f> m_local;
+		std::vector<math::Mat44f> m_world;
+		std::vector<uint32_t> m_parentSlot; // Own slot for roots
+		std::vector<NodeId> m_slotNode;
+		std::vector<uint8_t> m_dirty; // Local matrix changed since the last update
+		std::vector<uint32_t> m_levelStart = { 0 }; // First slot of each depth, and the end of the arrays
+
+		bool m_sorted = true;
+		bool m_anyDirty = false;
+	};
+
+} }	// namespace rev::game
@@ -17,7 +17,7 @@
 // NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-#include "ComputePipeline.h"
+#include "computePipeline.h"
 
 #include <fstream>
 #include <iostream>
@@ -52,14 +52,16 @@ namespace rev::gfx
 			if (reload())
 				m_invalidated = false;
 		}
-		cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkPipeline);
+		cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_vkPipeline);
 	}
 
 	void ComputePipeline::bindDescriptorSets(
 		const vk::CommandBuffer& cmdBuf,
 		const vk::ArrayProxy<const vk::DescriptorSet>& descSets,
 		uint32_t firstSet)
-	{}
+	{
+		cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_layout, firstSet, descSets, {});
+	}
 
 	bool ComputePipeline::reload()
 	{
@@ -102,6 +102,11 @@ namespace rev::gfx
 			std::string name;
 			size_t dediactedVideoMemory = 0;
 			bool vSyncOffSupport = false;
+			bool drawIndirectCount = false; // Multiple indirect draws, with the draw count read from a GPU buffer
+			bool scalarBlockLayout = false; // Tightly packed buffer layouts in shaders (GL_EXT_scalar_block_layout)
+
+			// GPU culling needs both indirect count draws and the scalar layouts of its shader buffers
+			bool gpuCulling() const { return drawIndirectCount && scalarBlockLayout; }
 		};
 
 		const DeviceInfo& deviceInfo() const { return m_deviceInfo; }
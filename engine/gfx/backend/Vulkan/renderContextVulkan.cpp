@@ -329,8 +329,29 @@ namespace rev::gfx {
 		auto transferQueues = vk::DeviceQueueCreateInfo({}, m_queueFamilies.transfer.value(), 1, &LowPriority);
 		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfo = { graphicsQueues, asyncQueues, transferQueues };
 
+		// Optional features, enabled when available
+		auto supportedFeatures = m_physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		const auto& supported10 = supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features;
+		const auto& supported12 = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>();
+		vk::PhysicalDeviceVulkan12Features enabled12;
+		vk::PhysicalDeviceFeatures2 enabledFeatures;
+		enabledFeatures.pNext = &enabled12;
+		if (supported10.multiDrawIndirect && supported10.drawIndirectFirstInstance && supported12.drawIndirectCount)
+		{
+			enabledFeatures.features.multiDrawIndirect = true;
+			enabledFeatures.features.drawIndirectFirstInstance = true;
+			enabled12.drawIndirectCount = true;
+			m_deviceInfo.drawIndirectCount = true;
+		}
+		if (supported12.scalarBlockLayout)
+		{
+			enabled12.scalarBlockLayout = true;
+			m_deviceInfo.scalarBlockLayout = true;
+		}
+
 		// Specify required extensions
 		vk::DeviceCreateInfo deviceInfo({}, queueCreateInfo, m_layers, m_requiredDeviceExtensions);
+		deviceInfo.pNext = &enabledFeatures;
 		m_vkDevice = m_physicalDevice.createDevice(deviceInfo);
 		assert(m_vkDevice);
 
@@ -351,6 +372,8 @@ namespace rev::gfx {
 		delete m_computeQueue;
 		delete m_transferQueue;
 
+		m_threadCmdPools.clear();
+		m_numRecordingThreads = 0;
 		m_frameData.clear(); // Free vulkan objects used per frame
 
 		if(m_swapchain.m_imageBuffers.size() > 0)
@@ -503,6 +526,17 @@ namespace rev::gfx {
 		m_frameData[m_frameDataNdx].reset();
 	}
 
+	//--------------------------------------------------------------------------------------------------
+	void RenderContextVulkan::waitForFrameInFlight()
+	{
+		auto& frame = m_frameData[m_frameDataNdx];
+		if (frame.numUsedBuffers())
+			return; // Already waited for when the frame got its first cmd buffer. The fence is reset now
+
+		const auto res = m_vkDevice.waitForFences(frame.renderFence, true, uint64_t(-1));
+		assert(res == vk::Result::eSuccess);
+	}
+
 	//--------------------------------------------------------------------------------------------------
 	math::Vec2u RenderContextVulkan::resizeSwapChain(const math::Vec2u& imageSize)
 	{
@@ -527,7 +561,42 @@ namespace rev::gfx {
 	//--------------------------------------------------------------------------------------------------
 	vk::CommandBuffer RenderContextVulkan::getNewRenderCmdBuffer()
 	{
-		return m_frameData[m_frameDataNdx].getRenderCmdBuffer();
+		auto& frame = m_frameData[m_frameDataNdx];
+		const bool firstInFrame = !frame.numUsedBuffers();
+		auto cmd = frame.getRenderCmdBuffer(); // Waits for the GPU to be done with the frame's buffers
+
+		// Secondary buffers from this frame are free to reuse too
+		if (firstInFrame)
+		{
+			for (size_t i = 0; i < m_numRecordingThreads; ++i)
+				m_threadCmdPools[m_frameDataNdx * m_numRecordingThreads + i]->reset();
+		}
+
+		return cmd;
+	}
+
+	//--------------------------------------------------------------------------------------------------
+	void RenderContextVulkan::initRecordingThreads(size_t numThreads)
+	{
+		if (numThreads == m_numRecordingThreads)
+			return;
+
+		assert(!m_frameData.empty()); // Must be called after creating the swapchain
+		m_vkDevice.waitIdle();
+
+		m_threadCmdPools.clear();
+		m_threadCmdPools.reserve(m_frameData.size() * numThreads);
+		for (size_t i = 0; i < m_frameData.size() * numThreads; ++i)
+			m_threadCmdPools.push_back(std::make_unique<VulkanThreadCommandPool>(m_vkDevice, m_queueFamilies.present.value()));
+		m_numRecordingThreads = numThreads;
+	}
+
+	//--------------------------------------------------------------------------------------------------
+	vk::CommandBuffer RenderContextVulkan::getSecondaryCmdBuffer(size_t threadNdx)
+	{
+		assert(threadNdx < m_numRecordingThreads);
+		assert(m_frameData[m_frameDataNdx].numUsedBuffers()); // The frame's pools are only reset with its first render cmd buffer
+		return m_threadCmdPools[m_frameDataNdx * m_numRecordingThreads + threadNdx]->getSecondaryCommandBuffer();
 	}
 
 	//--------------------------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <gfx/backend/Vulkan/Vulkan.h>
+#include <memory>
 #include <vector>
 #include <optional>
 
@@ -32,6 +33,7 @@
 namespace rev::gfx
 {
 	class VulkanCommandQueue;
+	class VulkanThreadCommandPool;
 
 	class RenderContextVulkan : public Context
 	{
@@ -54,6 +56,11 @@ namespace rev::gfx
 		const ImageBuffer& swapchainAquireNextImage(vk::Semaphore signal, vk::CommandBuffer cmd);
 		const vk::Semaphore& readyToPresentSemaphore() const { return m_renderFinishedSemaphore; }
 		auto currentFrameIndex() const { return m_swapchain.frameIndex; }
+		// Frames in flight. The CPU records a frame while the GPU may still be working on the previous ones.
+		// Per frame resources indexed by frameInFlightIndex can be reused after waitForFrameInFlight.
+		size_t numFramesInFlight() const { return m_frameData.size(); }
+		size_t frameInFlightIndex() const { return m_frameDataNdx; }
+		void waitForFrameInFlight();
 		void swapchainPresent();
 		vk::Format swapchainFormat() const { return m_swapchain.m_imageFormat; }
 
@@ -66,6 +73,13 @@ namespace rev::gfx
 		vk::CommandBuffer getNewRenderCmdBuffer();
 		ScopedCommandBuffer getScopedCmdBuffer(vk::Queue submitQueue, vk::Semaphore waitForSemaphore = vk::Semaphore());
 
+		// Secondary command buffers, for recording from several threads.
+		// Each recording thread gets its own command pool per frame in flight. Different threads can get buffers
+		// concurrently, as long as they use different thread indices, and only after the frame's first render cmd buffer.
+		void initRecordingThreads(size_t numThreads);
+		size_t numRecordingThreads() const { return m_numRecordingThreads; }
+		vk::CommandBuffer getSecondaryCmdBuffer(size_t threadNdx);
+
 		// Render passes and frame buffers
 		vk::RenderPass createRenderPass(const std::vector<vk::Format>& attachmentFormats);
 		void transitionImageLayout(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, bool isDepth);
@@ -167,6 +181,7 @@ namespace rev::gfx
 
 			vk::CommandBuffer getRenderCmdBuffer();
 			void reset();
+			size_t numUsedBuffers() const { return usedBuffers; }
 
 			vk::Fence renderFence;
 		private:
@@ -179,6 +194,9 @@ namespace rev::gfx
 		std::vector<FrameInfo> m_frameData;
 		size_t m_frameDataNdx{};
 
+		std::vector<std::unique_ptr<VulkanThreadCommandPool>> m_threadCmdPools; // m_numRecordingThreads per frame
+		size_t m_numRecordingThreads{};
+
 		// Debug
 		vk::DebugUtilsMessengerEXT m_debugMessenger;
 
@@ -21,6 +21,41 @@
 
 namespace rev::gfx
 {
+    //-----------------------------------------------------------------------------------------------
+    VulkanThreadCommandPool::VulkanThreadCommandPool(vk::Device device, uint32_t familyIndex)
+        : m_device(device)
+    {
+        m_pool = m_device.createCommandPool(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, familyIndex));
+    }
+
+    //-----------------------------------------------------------------------------------------------
+    VulkanThreadCommandPool::~VulkanThreadCommandPool()
+    {
+        if (!m_secondaryCmdBuffers.empty())
+            m_device.freeCommandBuffers(m_pool, m_secondaryCmdBuffers);
+        m_device.destroyCommandPool(m_pool);
+    }
+
+    //-----------------------------------------------------------------------------------------------
+    vk::CommandBuffer VulkanThreadCommandPool::getSecondaryCommandBuffer()
+    {
+        if (m_usedSecondaryCmdBuffers == m_secondaryCmdBuffers.size()) // Exhausted, allocate a new one
+        {
+            vk::CommandBufferAllocateInfo cmdBufferInfo(m_pool, vk::CommandBufferLevel::eSecondary, 1);
+            m_secondaryCmdBuffers.push_back(m_device.allocateCommandBuffers(cmdBufferInfo).front());
+        }
+
+        return m_secondaryCmdBuffers[m_usedSecondaryCmdBuffers++];
+    }
+
+    //-----------------------------------------------------------------------------------------------
+    void VulkanThreadCommandPool::reset()
+    {
+        // Resetting the whole pool is cheaper than resetting buffers one by one
+        m_device.resetCommandPool(m_pool, {});
+        m_usedSecondaryCmdBuffers = 0;
+    }
+
     //-----------------------------------------------------------------------------------------------
     VulkanCommandQueue::VulkanCommandQueue(
         vk::Device device,
@@ -39,6 +39,27 @@ namespace rev::gfx
         uint64_t m_submissionFenceId = 0; // 0 means not submitted
     };
 
+    // Command pool owned by a single recording thread.
+    // Hands out secondary command buffers that are recycled all at once by reset, when the GPU is done with them.
+    class VulkanThreadCommandPool
+    {
+    public:
+        VulkanThreadCommandPool(vk::Device device, uint32_t familyIndex);
+        ~VulkanThreadCommandPool();
+
+        VulkanThreadCommandPool(const VulkanThreadCommandPool&) = delete;
+        VulkanThreadCommandPool& operator=(const VulkanThreadCommandPool&) = delete;
+
+        vk::CommandBuffer getSecondaryCommandBuffer();
+        void reset();
+
+    private:
+        vk::Device m_device;
+        vk::CommandPool m_pool;
+        std::vector<vk::CommandBuffer> m_secondaryCmdBuffers;
+        size_t m_usedSecondaryCmdBuffers = 0;
+    };
+
     class VulkanCommandQueue : public CommandQueue
     {
     public:
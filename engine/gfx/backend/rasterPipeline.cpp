@@ -55,13 +55,24 @@ namespace rev::gfx
 		clearPipeline();
 	}
 
-	void RasterPipeline::bind(const vk::CommandBuffer& cmdBuf)
+	void RasterPipeline::refresh()
 	{
 		if (m_invalidated)
 		{
-			if (reload())
-				m_invalidated = false;
+			// Cleared even if reloading fails, so broken shaders aren't recompiled on every bind
+			m_invalidated = false;
+			reload();
 		}
+	}
+
+	void RasterPipeline::bind(const vk::CommandBuffer& cmdBuf)
+	{
+		refresh();
+		bindRefreshed(cmdBuf);
+	}
+
+	void RasterPipeline::bindRefreshed(const vk::CommandBuffer& cmdBuf) const
+	{
 		cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkPipeline);
 	}
 
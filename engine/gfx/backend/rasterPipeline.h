@@ -61,7 +61,13 @@ namespace rev::gfx
 
 		~RasterPipeline();
 
+		// Reloads the pipeline if it was invalidated. Bind does it too, but it isn't safe to do while other threads
+		// record commands with the pipeline, so call this before recording from several threads.
+		// A failed reload keeps the previous pipeline until the next invalidation.
+		void refresh();
 		void bind(const vk::CommandBuffer& cmdBuf);
+		// Binds without refreshing, so several threads can record with the pipeline at once
+		void bindRefreshed(const vk::CommandBuffer& cmdBuf) const;
 		void bindDescriptorSets(
 			const vk::CommandBuffer& cmdBuf,
 			const vk::ArrayProxy<const vk::DescriptorSet>& descSets,
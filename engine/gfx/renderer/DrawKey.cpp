@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gfx/renderer/DrawKey.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace rev::gfx
+{
+	//----------------------------------------------------------------------------------------------
+	uint32_t DrawKey::depthToBucket(float depth, float nearDepth, float farDepth)
+	{
+		if (!(depth > nearDepth)) // Also catches NaNs
+			return 0;
+		if (depth >= farDepth)
+			return mask(kDepthBits);
+		const float t = std::log(depth / nearDepth) / std::log(farDepth / nearDepth);
+		return std::min(uint32_t(t * mask(kDepthBits)), mask(kDepthBits));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void radixSort(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch)
+	{
+		constexpr uint32_t kRadixBits = 8;
+		constexpr uint32_t kNumPasses = 64 / kRadixBits;
+		constexpr uint32_t kNumBuckets = 1 << kRadixBits;
+
+		const size_t n = draws.size();
+		if (n < 2)
+			return;
+		scratch.resize(n);
+
+		// Histograms for all passes in a single read of the keys
+		uint32_t histograms[kNumPasses][kNumBuckets] = {};
+		for (const auto& draw : draws)
+		{
+			for (uint32_t pass = 0; pass < kNumPasses; ++pass)
+				++histograms[pass][(draw.key >> (pass * kRadixBits)) & (kNumBuckets - 1)];
+		}
+
+		auto* src = &draws;
+		auto* dst = &scratch;
+		for (uint32_t pass = 0; pass < kNumPasses; ++pass)
+		{
+			auto& histogram = histograms[pass];
+			const uint32_t shift = pass * kRadixBits;
+
+			// Skip digits shared by all keys
+			const uint32_t firstDigit = ((*src)[0].key >> shift) & (kNumBuckets - 1);
+			if (histogram[firstDigit] == n)
+				continue;
+
+			// Exclusive prefix sum gives the first destination of each bucket
+			uint32_t offset = 0;
+			for (auto& count : histogram)
+			{
+				const uint32_t bucketSize = count;
+				count = offset;
+				offset += bucketSize;
+			}
+
+			for (const auto& draw : *src)
+				(*dst)[histogram[(draw.key >> shift) & (kNumBuckets - 1)]++] = draw;
+			std::swap(src, dst);
+		}
+
+		if (src != &draws)
+			draws.swap(scratch);
+	}
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace rev::gfx
+{
+	// 64 bit sort key for draws. Sorting by it puts together the draws that share the most expensive state.
+	// Fields, from most to least significant:
+	// | pipeline: 6 | descriptor set: 12 | vertex and index buffers: 12 | material: 18 | depth bucket: 16 |
+	// Within a material, draws go front to back to help early depth rejection.
+	struct DrawKey
+	{
+		static constexpr uint32_t kDepthBits = 16;
+		static constexpr uint32_t kMaterialBits = 18;
+		static constexpr uint32_t kGeometryBits = 12;
+		static constexpr uint32_t kDescriptorSetBits = 12;
+		static constexpr uint32_t kPipelineBits = 6;
+		static_assert(kDepthBits + kMaterialBits + kGeometryBits + kDescriptorSetBits + kPipelineBits == 64);
+
+		static constexpr uint32_t kMaterialShift = kDepthBits;
+		static constexpr uint32_t kGeometryShift = kMaterialShift + kMaterialBits;
+		static constexpr uint32_t kDescriptorSetShift = kGeometryShift + kGeometryBits;
+		static constexpr uint32_t kPipelineShift = kDescriptorSetShift + kDescriptorSetBits;
+
+		// Fields out of range are truncated
+		static uint64_t encode(uint32_t pipeline, uint32_t descriptorSet, uint32_t geometry, uint32_t material, uint32_t depthBucket)
+		{
+			return (uint64_t(pipeline & mask(kPipelineBits)) << kPipelineShift)
+				| (uint64_t(descriptorSet & mask(kDescriptorSetBits)) << kDescriptorSetShift)
+				| (uint64_t(geometry & mask(kGeometryBits)) << kGeometryShift)
+				| (uint64_t(material & mask(kMaterialBits)) << kMaterialShift)
+				| uint64_t(depthBucket & mask(kDepthBits));
+		}
+
+		static uint32_t pipeline(uint64_t key) { return uint32_t(key >> kPipelineShift) & mask(kPipelineBits); }
+		static uint32_t descriptorSet(uint64_t key) { return uint32_t(key >> kDescriptorSetShift) & mask(kDescriptorSetBits); }
+		static uint32_t geometry(uint64_t key) { return uint32_t(key >> kGeometryShift) & mask(kGeometryBits); }
+		static uint32_t material(uint64_t key) { return uint32_t(key >> kMaterialShift) & mask(kMaterialBits); }
+		static uint32_t depthBucket(uint64_t key) { return uint32_t(key) & mask(kDepthBits); }
+
+		// Quantizes a view depth in [nearDepth, farDepth] to a depth bucket.
+		// Logarithmic, so near geometry, where overdraw is more likely to matter, gets finer buckets.
+		static uint32_t depthToBucket(float depth, float nearDepth, float farDepth);
+
+		static constexpr uint32_t mask(uint32_t bits) { return uint32_t((1ull << bits) - 1); }
+	};
+
+	struct SortedDraw
+	{
+		uint64_t key;
+		uint32_t drawNdx;
+	};
+
+	// Stable LSD radix sort on the keys, 8 bits per pass.
+	// Passes where all keys share the same digit are skipped, so unused key fields cost nothing.
+	// scratch is resized as needed and can be reused across calls to avoid allocations.
+	void radixSort(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch);
+}
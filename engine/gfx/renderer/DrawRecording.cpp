@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <gfx/renderer/DrawRecording.h>
+
+namespace rev::gfx
+{
+	//------------------------------------------------------------------------------------------------------------------
+	BindStats& BindStats::operator+=(const BindStats& other)
+	{
+		draws += other.draws;
+		indirectDraws += other.indirectDraws;
+		binds += other.binds;
+		skippedBinds += other.skippedBinds;
+		recordingJobs += other.recordingJobs;
+		return *this;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	BatchBinder::Binds BatchBinder::bind(const RasterQueue::Batch& batch)
+	{
+		Binds binds;
+		if (&batch == m_bound)
+			return binds;
+
+		binds.descriptorSet = !m_bound || m_bound->descriptorSet != batch.descriptorSet;
+		binds.indexBuffer = !m_bound || !sameIndexBuffer(*m_bound, batch);
+		binds.vertexBuffers = !m_bound || !sameVertexBuffers(*m_bound, batch);
+		for (bool bound : { binds.descriptorSet, binds.indexBuffer, binds.vertexBuffers })
+			++(bound ? m_stats.binds : m_stats.skippedBinds);
+
+		m_bound = &batch;
+		return binds;
+	}
+}
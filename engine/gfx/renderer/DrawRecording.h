@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <gfx/renderer/RasterQueue.h>
+
+namespace rev::gfx
+{
+	// Geometry pass stats for a frame, or for the part of it recorded by one job
+	struct BindStats
+	{
+		uint32_t draws = 0;
+		uint32_t indirectDraws = 0; // Draw calls with their draw commands written by GPU culling
+		uint32_t binds = 0; // Descriptor set, index and vertex buffer binds recorded
+		uint32_t skippedBinds = 0; // Binds not recorded because the state was already bound
+		uint32_t recordingJobs = 0; // Secondary command buffers the pass was recorded into. Zero when recorded inline
+
+		BindStats& operator+=(const BindStats& other);
+	};
+
+	inline bool sameIndexBuffer(const RasterQueue::Batch& a, const RasterQueue::Batch& b)
+	{
+		return a.indexBuffer == b.indexBuffer && a.indexType == b.indexType;
+	}
+
+	inline bool sameVertexBuffers(const RasterQueue::Batch& a, const RasterQueue::Batch& b)
+	{
+		return a.positionBinding == b.positionBinding
+			&& a.normalsBinding == b.normalsBinding
+			&& a.tangentsBinding == b.tangentsBinding
+			&& a.texCoordBinding == b.texCoordBinding;
+	}
+
+	// Tracks the batch state bound in a command buffer, so that binds matching it can be skipped.
+	// Each command buffer starts with nothing bound, so it needs its own binder.
+	class BatchBinder
+	{
+	public:
+		struct Binds
+		{
+			bool descriptorSet = false;
+			bool indexBuffer = false;
+			bool vertexBuffers = false;
+		};
+
+		explicit BatchBinder(BindStats& stats) : m_stats(stats) {}
+
+		// Makes batch the bound one, and returns the state that has to be bound for it.
+		// State is only compared when the batch changes.
+		Binds bind(const RasterQueue::Batch& batch);
+
+	private:
+		const RasterQueue::Batch* m_bound = nullptr;
+		BindStats& m_stats;
+	};
+
+	// Number of jobs to split the recording of numDraws draws in, so that each gets at least minDrawsPerJob.
+	// Zero or one mean recording inline.
+	inline size_t numRecordingJobs(size_t numDraws, size_t maxJobs, size_t minDrawsPerJob)
+	{
+		return std::min(maxJobs, numDraws / minDrawsPerJob);
+	}
+
+	// Range of sorted draws recorded by a job. Contiguous ranges keep state changes low within each job
+	inline std::pair<size_t, size_t> recordingJobRange(size_t numDraws, size_t numJobs, size_t job)
+	{
+		return { job * numDraws / numJobs, (job + 1) * numDraws / numJobs };
+	}
+}
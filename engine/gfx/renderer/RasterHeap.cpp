@@ -23,6 +23,7 @@
 #include <gfx/backend/Vulkan/renderContextVulkan.h>
 #include <gfx/backend/Vulkan/vulkanAllocator.h>
 #include <math/geometry/mesh.h>
+#include <math/geometry/meshlet.h>
 
 using namespace rev::math;
 
@@ -86,7 +87,24 @@ namespace rev::gfx {
 		primitive.numIndices = numIndices;
 		primitive.materialNdx = materialNdx;
 
-		return m_primitives.size() - 1;
+		auto& bounds = m_primitiveBounds.emplace_back();
+		for (uint32_t i = 0; i < numVertices; ++i)
+			bounds.add(vtxPos[i]);
+
+		// Cluster triangles for culling. This reorders the copied indices, but they still draw the same triangles
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshletBounds> meshletBounds;
+		buildMeshlets(
+			std::span<const Vec3f>(vtxPos, numVertices),
+			std::span<uint32_t>(m_indices.data() + numIndicesBefore, numIndices),
+			meshlets, meshletBounds);
+		const auto primitiveId = (uint32_t)(m_primitives.size() - 1);
+		m_primitiveMeshlets.push_back({ (uint32_t)m_meshlets.size(), (uint32_t)(m_meshlets.size() + meshlets.size()) });
+		m_meshlets.insert(m_meshlets.end(), meshlets.begin(), meshlets.end());
+		m_meshletBounds.insert(m_meshletBounds.end(), meshletBounds.begin(), meshletBounds.end());
+		m_meshletPrimitive.resize(m_meshlets.size(), primitiveId);
+
+		return primitiveId;
 	}
 
 	size_t RasterHeap::closeAndSubmit(
@@ -21,6 +21,8 @@
 
 #include <cstdint>
 #include <math/algebra/vector.h>
+#include <math/geometry/aabb.h>
+#include <math/geometry/meshlet.h>
 #include <gfx/renderer/RasterQueue.h>
 #include <gfx/scene/Material.h>
 #include <gfx/Texture.h>
@@ -49,6 +51,12 @@ namespace rev::gfx
 			uint32_t endPrimitive;
 		};
 
+		struct MeshletRange
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+
 		using VtxBinding = RasterQueue::VtxBinding;
 
 	public:
@@ -71,14 +79,41 @@ namespace rev::gfx
 			uint32_t material
 		);
 		__forceinline const Primitive& getPrimitiveById(size_t primitiveId) const { return m_primitives[primitiveId]; }
+		size_t numPrimitives() const { return m_primitives.size(); }
 
 		__forceinline size_t addMesh(const Mesh& mesh)
 		{
+			math::AABB bounds;
+			for (uint32_t i = mesh.firstPrimitive; i != mesh.endPrimitive; ++i)
+				bounds.add(m_primitiveBounds[i]);
 			m_meshes.push_back(mesh);
+			m_meshBounds.push_back(bounds);
 			return m_meshes.size() - 1;
 		}
 
 		__forceinline const auto& mesh(size_t i) const { return m_meshes[i]; }
+		size_t numMeshes() const { return m_meshes.size(); }
+
+		// Bounding boxes in the local space of the mesh
+		const math::AABB& primitiveBounds(size_t primitiveId) const { return m_primitiveBounds[primitiveId]; }
+		const math::AABB& meshBounds(size_t i) const { return m_meshBounds[i]; }
+
+		// Primitives are split in meshlets that can be culled on their own.
+		// Meshlet triangles index a contiguous range of the primitive's indices, relative to its indexOffset.
+		// Meshlets of a primitive are contiguous, and so are the ones of a mesh.
+		const MeshletRange& primitiveMeshlets(size_t primitiveId) const { return m_primitiveMeshlets[primitiveId]; }
+		MeshletRange meshMeshlets(size_t i) const
+		{
+			const auto& mesh = m_meshes[i];
+			if (mesh.firstPrimitive == mesh.endPrimitive)
+				return { 0, 0 };
+			return { m_primitiveMeshlets[mesh.firstPrimitive].begin, m_primitiveMeshlets[mesh.endPrimitive - 1].end };
+		}
+		const math::Meshlet& meshlet(size_t i) const { return m_meshlets[i]; }
+		// Bounds in the local space of the mesh
+		const math::MeshletBounds& meshletBounds(size_t i) const { return m_meshletBounds[i]; }
+		uint32_t meshletPrimitive(size_t i) const { return m_meshletPrimitive[i]; }
+		size_t numMeshlets() const { return m_meshlets.size(); }
 
 		uint32_t addMaterial(const PBRMaterial material)
 		{
@@ -121,6 +156,12 @@ namespace rev::gfx
 		// CPU permanent data
 		std::vector<Mesh> m_meshes;
 		std::vector<Primitive> m_primitives;
+		std::vector<math::AABB> m_primitiveBounds;
+		std::vector<math::AABB> m_meshBounds;
+		std::vector<math::Meshlet> m_meshlets;
+		std::vector<math::MeshletBounds> m_meshletBounds;
+		std::vector<uint32_t> m_meshletPrimitive;
+		std::vector<MeshletRange> m_primitiveMeshlets;
 
 		// GPU data
 		std::shared_ptr<GPUBuffer> m_vtxBuffer;
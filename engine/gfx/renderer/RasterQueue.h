@@ -27,6 +27,11 @@
 #include <gfx/backend/Vulkan/Vulkan.h>
 #include <gfx/Texture.h>
 
+namespace rev::math
+{
+	struct Frustum;
+}
+
 namespace rev::gfx
 {
 	class GPUBuffer;
@@ -43,6 +48,7 @@ namespace rev::gfx
 			uint32_t numInstances;
 			uint32_t instanceOffset;
 			uint32_t materialIndex;
+			float depth; // Distance to the camera along the view direction. Only used for sorting, 0 when unknown
 		};
 
 		using VtxBinding = std::pair<GPUBuffer*, uint32_t>;
@@ -64,6 +70,22 @@ namespace rev::gfx
 			vk::DescriptorSet descriptorSet;
 		};
 
-		virtual void getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches) = 0;
+		// When worldFrustum is not null, queues can skip the geometry that falls outside of it.
+		virtual void getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches, const math::Frustum* worldFrustum) = 0;
+
+		// GPU driven draws. A compute shader culls the instances and writes the draw commands and their count,
+		// which are then drawn with drawIndexedIndirectCount using the bindings in batch.
+		struct IndirectDraws
+		{
+			Batch batch; // firstDraw and endDraw are unused
+			vk::DescriptorSet cullingDescriptorSet;
+			GPUBuffer* drawCommands;
+			GPUBuffer* drawCount;
+			uint32_t numInstances;
+			uint32_t maxDraws;
+		};
+
+		// Queues that support GPU driven draws fill in indirectDraws and return true
+		virtual bool getIndirectDraws(IndirectDraws&) { return false; }
 	};
 }
\ No newline at end of file
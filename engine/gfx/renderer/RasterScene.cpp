@@ -1,44 +1,122 @@
 
 #include <gfx/renderer/RasterScene.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <core/tasks/parallelFor.h>
 #include <gfx/backend/Vulkan/gpuBuffer.h>
 #include <gfx/backend/Vulkan/renderContextVulkan.h>
 #include <gfx/backend/Vulkan/vulkanAllocator.h>
 
 namespace rev::gfx
 {
-	void RasterScene::getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches)
+	namespace
 	{
-		assert(draws.empty());
-		// Count on having at least one primitive per mesh
-		draws.reserve(m_instanceMeshNdx.size());
+		// Layout of the instances read by the culling shader
+		struct CullingInstance
+		{
+			math::Mat44f worldMtx;
+			float boundsMin[3];
+			uint32_t meshNdx; // Or'ed with kCullBackFaces when the draw bounds of the instance can be culled by facing
+			float boundsMax[3];
+			float maxScale; // Scales the radius of draw bounds
+		};
+		constexpr uint32_t kCullBackFaces = 1u << 31;
 
-		for (uint32_t i = 0; i < m_instanceMeshNdx.size(); ++i)
+		// Layout of the draw bounds read by the culling shader
+		struct CullingBounds
 		{
-			const auto& mesh = m_geometry.mesh(i);
+			float center[3];
+			float radius;
+			float coneApex[3];
+			float coneAxis[3];
+			float coneCutoff;
+		};
+
+		// Must match the scalar block layout of Instance and DrawBounds in cullInstances.comp
+		static_assert(sizeof(CullingInstance) == 96);
+		static_assert(offsetof(CullingInstance, boundsMin) == 64);
+		static_assert(offsetof(CullingInstance, meshNdx) == 76);
+		static_assert(offsetof(CullingInstance, boundsMax) == 80);
+		static_assert(offsetof(CullingInstance, maxScale) == 92);
+		static_assert(sizeof(CullingBounds) == 44);
+		static_assert(offsetof(CullingBounds, radius) == 12);
+		static_assert(offsetof(CullingBounds, coneApex) == 16);
+		static_assert(offsetof(CullingBounds, coneAxis) == 28);
+		static_assert(offsetof(CullingBounds, coneCutoff) == 40);
 
-			Draw instanceDraw = {};
-			instanceDraw.instanceOffset = i; // Used to look up the world matrix
-			instanceDraw.numInstances = 1;
-			
-			for (uint32_t primitiveNdx = mesh.firstPrimitive; primitiveNdx != mesh.endPrimitive; ++primitiveNdx)
+		CullingBounds cullingBounds(const math::MeshletBounds& bounds)
+		{
+			CullingBounds result;
+			for (int j = 0; j < 3; ++j)
 			{
-				auto& primitive = m_geometry.getPrimitiveById(primitiveNdx);
-				instanceDraw.indexOffset = primitive.indexOffset;
-				instanceDraw.numIndices = primitive.numIndices;
-				instanceDraw.materialIndex = primitive.materialNdx;
-				instanceDraw.vtxOffset = primitive.vtxOffset;
+				result.center[j] = bounds.center[j];
+				result.coneApex[j] = bounds.coneApex[j];
+				result.coneAxis[j] = bounds.coneAxis[j];
 			}
+			result.radius = bounds.radius;
+			result.coneCutoff = bounds.coneCutoff;
+			return result;
+		}
+	}
 
-			draws.push_back(instanceDraw);
+	RasterScene::~RasterScene()
+	{
+		// CPU only scenes never map a slice, and may not have a render context at all
+		for (auto& slice : m_matrixSlices)
+		{
+			if (slice.mapped)
+				RenderContextVk().allocator().unmapBuffer(slice.mapped);
+		}
+	}
+
+	void RasterScene::getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches, const math::Frustum* worldFrustum)
+	{
+		assert(draws.empty());
+		if (worldFrustum)
+		{
+			visibleDraws(*worldFrustum, draws);
+			// Compacted matrices are uploaded after those of all instances
+			const auto compactedOffset = (uint32_t)m_instanceWorldMtx.size();
+			for (auto& draw : draws)
+				draw.instanceOffset += compactedOffset;
+			uploadMatrixBuffer(&m_visibleWorldMtx);
+		}
+		else
+		{
+			const auto& grouped = instancedDraws();
+			draws.insert(draws.end(), grouped.begin(), grouped.end());
+			uploadMatrixBuffer();
 		}
 
 		auto& batch = batches.emplace_back();
+		fillBatch(batch);
 		batch.firstDraw = 0;
 		batch.endDraw = (uint32_t)draws.size();
+	}
+
+	bool RasterScene::getIndirectDraws(IndirectDraws& indirectDraws)
+	{
+		if (!m_cullingDescriptorSet || !m_indirectDraws)
+			return false;
+
+		uploadMatrixBuffer();
+		fillBatch(indirectDraws.batch);
+		indirectDraws.cullingDescriptorSet = m_cullingDescriptorSet->getDescriptor(0);
+		indirectDraws.drawCommands = m_indirectDraws.get();
+		indirectDraws.drawCount = m_indirectDrawCount.get();
+		indirectDraws.numInstances = (uint32_t)m_instanceWorldMtx.size();
+		indirectDraws.maxDraws = m_maxIndirectDraws;
+		return true;
+	}
+
+	void RasterScene::fillBatch(Batch& batch) const
+	{
 		batch.indexType = vk::IndexType::eUint32;
 		batch.indexBuffer = m_geometry.indexBuffer();
 		batch.textures = m_geometry.textures();
-		batch.descriptorSet = m_descriptorSet->getDescriptor(0);
+		batch.descriptorSet = m_descriptorSet->getDescriptor((uint32_t)RenderContextVk().frameInFlightIndex());
 		m_geometry.getVertexBindings(
 			batch.positionBinding,
 			batch.normalsBinding,
@@ -47,49 +125,505 @@ namespace rev::gfx
 		);
 	}
 
-	void RasterScene::addInstance(const math::Mat44f& worldMtx, uint32_t meshNdx)
+	uint32_t RasterScene::addInstance(const math::Mat44f& worldMtx, uint32_t meshNdx)
 	{
+		if (!m_instanceMeshNdx.empty() && meshNdx < m_instanceMeshNdx.back())
+			m_instancesSorted = false;
+		const auto instanceId = (uint32_t)m_instanceWorldMtx.size();
 		m_instanceWorldMtx.push_back(worldMtx);
 		m_instanceMeshNdx.push_back(meshNdx);
+		m_instanceSlot.push_back(instanceId);
+		m_slotInstance.push_back(instanceId);
+		m_drawsDirty = true;
+		m_boundsDirty = true;
+		markMatricesDirty({ instanceId, instanceId + 1 });
+		return instanceId;
+	}
+
+	void RasterScene::setInstanceTransform(uint32_t instanceId, const math::Mat44f& worldMtx)
+	{
+		const uint32_t slot = m_instanceSlot[instanceId];
+		m_instanceWorldMtx[slot] = worldMtx;
+		markMatricesDirty({ slot, slot + 1 });
+
+		// Cached bounds are only valid for sorted instances, so the slot is already final
+		if (!m_boundsDirty)
+			m_instanceWorldBounds.set(slot, worldMtx * m_geometry.meshBounds(m_instanceMeshNdx[slot]));
+	}
+
+	void RasterScene::markMatricesDirty(InstanceRange range)
+	{
+		for (auto& slice : m_matrixSlices)
+		{
+			auto& ranges = slice.dirtyRanges;
+			if (!ranges.empty() && range.begin <= ranges.back().end && range.end >= ranges.back().begin)
+			{
+				// Overlaps or touches the last range. Common when instances are updated in order
+				ranges.back().begin = std::min(ranges.back().begin, range.begin);
+				ranges.back().end = std::max(ranges.back().end, range.end);
+			}
+			else if (ranges.size() < kMaxDirtyRanges)
+			{
+				ranges.push_back(range);
+			}
+			else
+			{
+				// Too scattered to track. Write everything in between instead
+				for (auto& r : ranges)
+				{
+					range.begin = std::min(range.begin, r.begin);
+					range.end = std::max(range.end, r.end);
+				}
+				ranges.assign(1, range);
+			}
+		}
 	}
 
 	void RasterScene::clearInstances()
 	{
 		m_instanceWorldMtx.clear();
 		m_instanceMeshNdx.clear();
-		m_worldMtxBuffer = nullptr;
+		m_instanceSlot.clear();
+		m_slotInstance.clear();
+		m_instancesSorted = true;
+		m_draws.clear();
+		m_drawsDirty = false;
+		m_instanceWorldBounds.clear();
+		m_boundsDirty = false;
+		for (auto& slice : m_matrixSlices)
+			slice.dirtyRanges.clear(); // Keep the capacity for the next instances
+		m_cullingInstances = nullptr;
+		m_indirectDraws = nullptr;
+		m_indirectDrawCount = nullptr;
+		m_maxIndirectDraws = 0;
+	}
+
+	const std::vector<RasterQueue::Draw>& RasterScene::instancedDraws()
+	{
+		if (!m_drawsDirty)
+			return m_draws;
+
+		sortInstances();
+		m_draws.clear();
+
+		// One draw per primitive for each run of instances of the same mesh
+		const auto numInstances = (uint32_t)m_instanceMeshNdx.size();
+		for (uint32_t groupBegin = 0; groupBegin < numInstances;)
+		{
+			const uint32_t meshNdx = m_instanceMeshNdx[groupBegin];
+			uint32_t groupEnd = groupBegin + 1;
+			while (groupEnd < numInstances && m_instanceMeshNdx[groupEnd] == meshNdx)
+				++groupEnd;
+
+			addMeshDraws(meshNdx, groupBegin, groupEnd, 0.f, m_draws);
+			groupBegin = groupEnd;
+		}
+
+		m_drawsDirty = false;
+		return m_draws;
+	}
+
+	void RasterScene::visibleDraws(const math::Frustum& worldFrustum, std::vector<Draw>& draws)
+	{
+		draws.clear();
+		updateWorldBounds();
+		math::cullAABBs(worldFrustum, m_instanceWorldBounds, m_visibleInstances, m_cullingPool);
+
+		// Distance along the view direction, measured from the near plane, whose normal points to the camera
+		const auto& nearPlane = worldFrustum.plane(0);
+		auto instanceDepth = [&](uint32_t i) {
+			return worldFrustum.nearDistance() + nearPlane.t - dot(nearPlane.normal, m_instanceWorldBounds[i].center());
+		};
+
+		// Visible indices come sorted, so once their matrices are compacted, all the visible instances of a mesh
+		// are contiguous and can share a draw no matter which instances were culled in between
+		const auto numVisible = (uint32_t)m_visibleInstances.size();
+		m_visibleWorldMtx.resize(numVisible);
+		for (uint32_t i = 0; i < numVisible; ++i)
+			m_visibleWorldMtx[i] = m_instanceWorldMtx[m_visibleInstances[i]];
+
+		for (uint32_t groupBegin = 0; groupBegin < numVisible;)
+		{
+			const uint32_t meshNdx = m_instanceMeshNdx[m_visibleInstances[groupBegin]];
+			uint32_t groupEnd = groupBegin;
+			float depth = std::numeric_limits<float>::max();
+			while (groupEnd < numVisible && m_instanceMeshNdx[m_visibleInstances[groupEnd]] == meshNdx)
+				depth = std::min(depth, instanceDepth(m_visibleInstances[groupEnd++]));
+
+			if (isClusterCulled(meshNdx))
+			{
+				for (uint32_t i = groupBegin; i != groupEnd; ++i)
+					addVisibleMeshletDraws(m_visibleInstances[i], i, worldFrustum, instanceDepth(m_visibleInstances[i]), draws);
+			}
+			else
+				addMeshDraws(meshNdx, groupBegin, groupEnd, depth, draws);
+			groupBegin = groupEnd;
+		}
+	}
+
+	bool RasterScene::isClusterCulled(uint32_t meshNdx) const
+	{
+		const auto meshlets = m_geometry.meshMeshlets(meshNdx);
+		return meshlets.end - meshlets.begin >= kMinClusterCulledMeshlets;
+	}
+
+	void RasterScene::addVisibleMeshletDraws(uint32_t instanceNdx, uint32_t instanceOffset, const math::Frustum& worldFrustum, float depth, std::vector<Draw>& draws) const
+	{
+		const auto& worldMtx = m_instanceWorldMtx[instanceNdx];
+		const auto viewPoint = worldFrustum.origin();
+		const auto meshlets = m_geometry.meshMeshlets(m_instanceMeshNdx[instanceNdx]);
+		bool extendLastDraw = false; // Whether the previous meshlet was visible
+		for (uint32_t i = meshlets.begin; i != meshlets.end; ++i)
+		{
+			auto bounds = worldMtx * m_geometry.meshletBounds(i); // Without a cone if worldMtx mirrors or stretches
+			if (!m_backFaceCulling)
+				bounds.coneCutoff = 1.f;
+			if (!math::isMeshletVisible(bounds, worldFrustum, viewPoint))
+			{
+				extendLastDraw = false;
+				continue;
+			}
+
+			const auto& meshlet = m_geometry.meshlet(i);
+			const auto& primitive = m_geometry.getPrimitiveById(m_geometry.meshletPrimitive(i));
+			const uint32_t indexOffset = primitive.indexOffset + 3 * meshlet.firstTriangle;
+			if (extendLastDraw)
+			{
+				auto& last = draws.back();
+				if (last.vtxOffset == primitive.vtxOffset && last.indexOffset + last.numIndices == indexOffset)
+				{
+					last.numIndices += 3 * meshlet.numTriangles;
+					continue;
+				}
+			}
+
+			Draw& draw = draws.emplace_back();
+			draw.numIndices = 3 * meshlet.numTriangles;
+			draw.indexOffset = indexOffset;
+			draw.vtxOffset = primitive.vtxOffset;
+			draw.numInstances = 1;
+			draw.instanceOffset = instanceOffset;
+			draw.materialIndex = primitive.materialNdx;
+			draw.depth = depth;
+			extendLastDraw = true;
+		}
+	}
+
+	void RasterScene::addMeshDraws(uint32_t meshNdx, uint32_t instanceBegin, uint32_t instanceEnd, float depth, std::vector<Draw>& draws) const
+	{
+		const auto& mesh = m_geometry.mesh(meshNdx);
+		for (uint32_t primitiveNdx = mesh.firstPrimitive; primitiveNdx != mesh.endPrimitive; ++primitiveNdx)
+		{
+			auto& primitive = m_geometry.getPrimitiveById(primitiveNdx);
+			Draw& draw = draws.emplace_back();
+			draw.numIndices = primitive.numIndices;
+			draw.indexOffset = primitive.indexOffset;
+			draw.vtxOffset = primitive.vtxOffset;
+			draw.numInstances = instanceEnd - instanceBegin;
+			draw.instanceOffset = instanceBegin; // Used to look up the world matrix
+			draw.materialIndex = primitive.materialNdx;
+			draw.depth = depth;
+		}
+	}
+
+	const std::vector<math::Mat44f>& RasterScene::instanceWorldMatrices()
+	{
+		sortInstances();
+		return m_instanceWorldMtx;
+	}
+
+	const math::AABBSoA& RasterScene::instanceWorldBounds()
+	{
+		updateWorldBounds();
+		return m_instanceWorldBounds;
+	}
+
+	void RasterScene::updateWorldBounds()
+	{
+		if (!m_boundsDirty)
+			return;
+
+		sortInstances();
+
+		std::vector<math::AABB> worldBounds(m_instanceWorldMtx.size());
+		auto transformBounds = [&](size_t i) {
+			worldBounds[i] = m_instanceWorldMtx[i] * m_geometry.meshBounds(m_instanceMeshNdx[i]);
+		};
+		if (m_cullingPool)
+		{
+			core::parallelFor(*m_cullingPool, 0, worldBounds.size(), 1024, transformBounds);
+		}
+		else
+		{
+			for (size_t i = 0; i < worldBounds.size(); ++i)
+				transformBounds(i);
+		}
+		m_instanceWorldBounds.assign(worldBounds);
+		m_boundsDirty = false;
+	}
+
+	// Counting sort of instances by mesh. Stable, so instances of a mesh keep the order they were added in
+	void RasterScene::sortInstances()
+	{
+		if (m_instancesSorted)
+			return;
+
+		const uint32_t numMeshes = *std::max_element(m_instanceMeshNdx.begin(), m_instanceMeshNdx.end()) + 1;
+		std::vector<uint32_t> meshStart(numMeshes + 1, 0);
+		for (auto meshNdx : m_instanceMeshNdx)
+			++meshStart[meshNdx + 1];
+		for (uint32_t i = 0; i < numMeshes; ++i)
+			meshStart[i + 1] += meshStart[i];
+
+		std::vector<uint32_t> sortedMeshNdx(m_instanceMeshNdx.size());
+		std::vector<math::Mat44f> sortedWorldMtx(m_instanceWorldMtx.size());
+		std::vector<uint32_t> sortedInstances(m_slotInstance.size());
+		for (size_t i = 0; i < m_instanceMeshNdx.size(); ++i)
+		{
+			const uint32_t dst = meshStart[m_instanceMeshNdx[i]]++;
+			sortedMeshNdx[dst] = m_instanceMeshNdx[i];
+			sortedWorldMtx[dst] = m_instanceWorldMtx[i];
+			sortedInstances[dst] = m_slotInstance[i];
+			m_instanceSlot[m_slotInstance[i]] = dst;
+		}
+		m_instanceMeshNdx = std::move(sortedMeshNdx);
+		m_instanceWorldMtx = std::move(sortedWorldMtx);
+		m_slotInstance = std::move(sortedInstances);
+		m_instancesSorted = true;
+		markMatricesDirty({ 0, (uint32_t)m_instanceWorldMtx.size() });
 	}
 
 	void RasterScene::updateDescriptorSet(const std::shared_ptr<DescriptorSetLayout> layout)
 	{
+		const auto numFrames = RenderContextVk().numFramesInFlight();
 		if (!m_descriptorSet)
 		{
-			m_descriptorSet = std::make_shared<DescriptorSetPool>(layout, 1);
+			m_descriptorSet = std::make_shared<DescriptorSetPool>(layout, (uint32_t)numFrames);
 		}
+		m_matrixSlices.resize(numFrames);
 
-		uploadMatrixBuffer();
-
-		DescriptorSetUpdate geometryUpdate(*m_descriptorSet, 0);
-		geometryUpdate.addStorageBuffer("worldMtx", m_worldMtxBuffer);
-		geometryUpdate.addStorageBuffer("materials", m_geometry.materialsBuffer());
-		geometryUpdate.send();
-		m_descriptorSet->writeArrayTextureToDescriptor(0, "textures", m_geometry.textures());
+		// Matrices are written to each set when its slice is first uploaded
+		for (uint32_t i = 0; i < numFrames; ++i)
+		{
+			DescriptorSetUpdate geometryUpdate(*m_descriptorSet, i);
+			geometryUpdate.addStorageBuffer("materials", m_geometry.materialsBuffer());
+			if (m_matrixSlices[i].buffer)
+				geometryUpdate.addStorageBuffer("worldMtx", m_matrixSlices[i].buffer);
+			geometryUpdate.send();
+			m_descriptorSet->writeArrayTextureToDescriptor(i, "textures", m_geometry.textures());
+		}
 	}
 
-	void RasterScene::uploadMatrixBuffer()
+	void RasterScene::uploadMatrixBuffer(const std::vector<math::Mat44f>* compactedMatrices)
 	{
-		if (!m_worldMtxBuffer && !m_instanceWorldMtx.empty())
+		assert(!m_matrixSlices.empty()); // Created by updateDescriptorSet
+		sortInstances(); // Draw instance offsets refer to the sorted order
+
+		auto& rc = RenderContextVk();
+		const auto frameNdx = rc.frameInFlightIndex();
+		auto& slice = m_matrixSlices[frameNdx];
+		const size_t numInstances = m_instanceWorldMtx.size();
+		const size_t numCompacted = compactedMatrices ? compactedMatrices->size() : 0;
+		const bool grow = numInstances + numCompacted > slice.capacity;
+		if (!grow && slice.dirtyRanges.empty() && !numCompacted)
+			return; // Up to date
+
+		// The GPU may still be reading the slice from the last time this frame was in flight
+		rc.waitForFrameInFlight();
+
+		auto& alloc = rc.allocator();
+		if (grow)
 		{
-			auto& rc = RenderContextVk();
-			auto& alloc = rc.allocator();
-			m_worldMtxBuffer = alloc.createBufferForMapping(
-				sizeof(math::Mat44f) * m_instanceWorldMtx.size(),
+			if (slice.mapped)
+				alloc.unmapBuffer(slice.mapped);
+
+			slice.capacity = std::max(numInstances + numCompacted, 2 * slice.capacity);
+			slice.buffer = alloc.createBufferForMapping(
+				sizeof(math::Mat44f) * slice.capacity,
 				vk::BufferUsageFlagBits::eStorageBuffer,
 				rc.graphicsQueueFamily());
+			slice.mapped = alloc.mapBuffer<math::Mat44f>(*slice.buffer);
+			slice.dirtyRanges.assign(1, { 0, (uint32_t)numInstances });
 
-			auto mtxDst = alloc.mapBuffer<math::Mat44f>(*m_worldMtxBuffer);
-			memcpy(mtxDst, m_instanceWorldMtx.data(), sizeof(math::Mat44f) * m_instanceWorldMtx.size());
-			alloc.unmapBuffer(mtxDst);
+			DescriptorSetUpdate matrixUpdate(*m_descriptorSet, (uint32_t)frameNdx);
+			matrixUpdate.addStorageBuffer("worldMtx", slice.buffer);
+			matrixUpdate.send();
 		}
+
+		// Memory is host coherent, so no flush is needed
+		for (const auto& range : slice.dirtyRanges)
+		{
+			const auto end = std::min<size_t>(range.end, numInstances); // Instances may have been cleared since
+			if (range.begin < end)
+				memcpy(slice.mapped + range.begin, m_instanceWorldMtx.data() + range.begin, sizeof(math::Mat44f) * (end - range.begin));
+		}
+		slice.dirtyRanges.clear();
+		if (numCompacted)
+			memcpy(slice.mapped + numInstances, compactedMatrices->data(), sizeof(math::Mat44f) * numCompacted);
+	}
+
+	void RasterScene::updateCullingDescriptorSet(const std::shared_ptr<DescriptorSetLayout> layout)
+	{
+		if (!m_cullingDescriptorSet)
+		{
+			m_cullingDescriptorSet = std::make_shared<DescriptorSetPool>(layout, 1);
+		}
+
+		uploadCullingBuffers();
+		if (!m_indirectDraws)
+			return; // No instances to cull
+
+		DescriptorSetUpdate cullingUpdate(*m_cullingDescriptorSet, 0);
+		cullingUpdate.addStorageBuffer("instances", m_cullingInstances);
+		cullingUpdate.addStorageBuffer("meshDrawRanges", m_meshDrawRanges);
+		cullingUpdate.addStorageBuffer("drawTemplates", m_drawTemplates);
+		cullingUpdate.addStorageBuffer("drawBounds", m_drawBounds);
+		cullingUpdate.addStorageBuffer("drawCommands", m_indirectDraws);
+		cullingUpdate.addStorageBuffer("drawCount", m_indirectDrawCount);
+		cullingUpdate.send();
+	}
+
+	uint32_t RasterScene::readIndirectDrawCount() const
+	{
+		if (!m_indirectDrawCount)
+			return 0;
+
+		auto& alloc = RenderContextVk().allocator();
+		auto count = alloc.mapBuffer<uint32_t>(*m_indirectDrawCount);
+		uint32_t result = *count;
+		alloc.unmapBuffer(count);
+		return std::min(result, m_maxIndirectDraws); // Draws past the cap are counted, but not written
+	}
+
+	void RasterScene::buildCullingTemplates(CullingTemplates& templates) const
+	{
+		const auto numMeshes = m_geometry.numMeshes();
+		templates.meshDrawRanges.resize(2 * numMeshes);
+		templates.drawTemplates.clear();
+		templates.drawBounds.clear();
+		auto addTemplate = [&](uint32_t numIndices, uint32_t indexOffset, const RasterHeap::Primitive& primitive, const math::MeshletBounds& bounds) {
+			Draw& draw = templates.drawTemplates.emplace_back();
+			draw.numIndices = numIndices;
+			draw.indexOffset = indexOffset;
+			draw.vtxOffset = primitive.vtxOffset;
+			draw.numInstances = 0;
+			draw.instanceOffset = 0;
+			draw.materialIndex = primitive.materialNdx;
+			draw.depth = 0.f;
+			templates.drawBounds.push_back(bounds);
+		};
+		for (uint32_t meshNdx = 0; meshNdx < numMeshes; ++meshNdx)
+		{
+			templates.meshDrawRanges[2 * meshNdx] = (uint32_t)templates.drawTemplates.size();
+			if (isClusterCulled(meshNdx))
+			{
+				const auto meshlets = m_geometry.meshMeshlets(meshNdx);
+				for (uint32_t i = meshlets.begin; i != meshlets.end; ++i)
+				{
+					const auto& meshlet = m_geometry.meshlet(i);
+					const auto& primitive = m_geometry.getPrimitiveById(m_geometry.meshletPrimitive(i));
+					addTemplate(3 * meshlet.numTriangles, primitive.indexOffset + 3 * meshlet.firstTriangle, primitive, m_geometry.meshletBounds(i));
+				}
+			}
+			else
+			{
+				const auto& mesh = m_geometry.mesh(meshNdx);
+				for (uint32_t i = mesh.firstPrimitive; i != mesh.endPrimitive; ++i)
+				{
+					// Just the sphere around the primitive. Its triangles can face anywhere
+					const auto& box = m_geometry.primitiveBounds(i);
+					math::MeshletBounds bounds;
+					bounds.center = box.center();
+					bounds.radius = 0.5f * norm(box.max() - box.min());
+					bounds.coneApex = bounds.center;
+					bounds.coneAxis = math::Vec3f::zero();
+					bounds.coneCutoff = 1.f;
+					const auto& primitive = m_geometry.getPrimitiveById(i);
+					addTemplate(primitive.numIndices, primitive.indexOffset, primitive, bounds);
+				}
+			}
+			templates.meshDrawRanges[2 * meshNdx + 1] = (uint32_t)templates.drawTemplates.size();
+		}
+	}
+
+	void RasterScene::uploadCullingBuffers()
+	{
+		if (m_indirectDraws || m_instanceWorldMtx.empty())
+			return;
+
+		auto& rc = RenderContextVk();
+		auto& alloc = rc.allocator();
+
+		CullingTemplates templates;
+		buildCullingTemplates(templates);
+		const auto& meshDrawRanges = templates.meshDrawRanges;
+		std::vector<vk::DrawIndexedIndirectCommand> drawTemplates;
+		drawTemplates.reserve(templates.drawTemplates.size());
+		for (auto& draw : templates.drawTemplates)
+			drawTemplates.emplace_back(draw.numIndices, 0, draw.indexOffset, int32_t(draw.vtxOffset), 0);
+		std::vector<CullingBounds> drawBounds;
+		drawBounds.reserve(templates.drawBounds.size());
+		for (auto& bounds : templates.drawBounds)
+			drawBounds.push_back(cullingBounds(bounds));
+
+		// Instances, in the same order as the world matrices
+		const auto& bounds = instanceWorldBounds();
+		size_t maxDraws = 0;
+		m_cullingInstances = alloc.createBufferForMapping(
+			sizeof(CullingInstance) * bounds.size(),
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			rc.graphicsQueueFamily());
+		auto instanceDst = alloc.mapBuffer<CullingInstance>(*m_cullingInstances);
+		for (size_t i = 0; i < bounds.size(); ++i)
+		{
+			const auto box = bounds[i];
+			const auto& worldMtx = m_instanceWorldMtx[i];
+			auto& instance = instanceDst[i];
+			instance = {};
+			instance.worldMtx = worldMtx;
+			float maxScaleSq = 0.f;
+			for (int j = 0; j < 3; ++j)
+			{
+				instance.boundsMin[j] = box.min()[j];
+				instance.boundsMax[j] = box.max()[j];
+				maxScaleSq = std::max(maxScaleSq, squaredNorm(math::Vec3f(worldMtx(0, j), worldMtx(1, j), worldMtx(2, j))));
+			}
+			instance.meshNdx = m_instanceMeshNdx[i];
+			assert(instance.meshNdx < kCullBackFaces);
+			if (m_backFaceCulling && math::preservesNormalCone(worldMtx))
+				instance.meshNdx |= kCullBackFaces;
+			instance.maxScale = std::sqrt(maxScaleSq);
+
+			const auto meshNdx = m_instanceMeshNdx[i];
+			maxDraws += meshDrawRanges[2 * meshNdx + 1] - meshDrawRanges[2 * meshNdx];
+		}
+		alloc.unmapBuffer(instanceDst);
+		m_maxIndirectDraws = (uint32_t)std::min<size_t>(maxDraws, kMaxIndirectDraws);
+
+		auto uploadArray = [&](const auto& src) {
+			using T = typename std::decay_t<decltype(src)>::value_type;
+			auto buffer = alloc.createBufferForMapping(
+				sizeof(T) * src.size(),
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				rc.graphicsQueueFamily());
+			auto dst = alloc.mapBuffer<T>(*buffer);
+			std::copy(src.begin(), src.end(), dst);
+			alloc.unmapBuffer(dst);
+			return buffer;
+		};
+		m_meshDrawRanges = uploadArray(meshDrawRanges);
+		m_drawTemplates = uploadArray(drawTemplates);
+		m_drawBounds = uploadArray(drawBounds);
+
+		// Culling output
+		m_indirectDraws = alloc.createGpuBuffer(
+			sizeof(vk::DrawIndexedIndirectCommand) * m_maxIndirectDraws,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+			rc.graphicsQueueFamily());
+		// Mappable, so the count can be read back
+		m_indirectDrawCount = alloc.createBufferForMapping(
+			sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			rc.graphicsQueueFamily());
 	}
 }
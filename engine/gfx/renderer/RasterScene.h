@@ -23,9 +23,15 @@
 #include <gfx/renderer/RasterQueue.h>
 #include <gfx/renderer/RasterHeap.h>
 #include <math/algebra/matrix.h>
+#include <math/geometry/frustumCulling.h>
 
 #include <vector>
 
+namespace rev::core
+{
+	class ThreadPool;
+}
+
 namespace rev::gfx
 {
 	class GPUBuffer;
@@ -36,29 +42,125 @@ namespace rev::gfx
 		RasterScene();
 		~RasterScene();
 
-		void getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches) override;
+		void getDrawBatches(std::vector<Draw>& draws, std::vector<Batch>& batches, const math::Frustum* worldFrustum) override;
+		bool getIndirectDraws(IndirectDraws& indirectDraws) override;
 
-		// Invalidates the order of renderables
-		void addInstance(const math::Mat44f& worldMtx, uint32_t meshNdx);
+		// Invalidates the order of renderables.
+		// Returns an id for the instance, valid until clearInstances.
+		uint32_t addInstance(const math::Mat44f& worldMtx, uint32_t meshNdx);
+		// Keeps draws and instance order. Only the changed matrix is uploaded again.
+		void setInstanceTransform(uint32_t instanceId, const math::Mat44f& worldMtx);
 		void clearInstances();
 
 		void updateDescriptorSet(const std::shared_ptr<DescriptorSetLayout>);
+		// Uploads instance bounds and draw templates for GPU culling. Needed for getIndirectDraws.
+		// Instances and meshlets are culled like in visibleDraws. Output is capped at kMaxIndirectDraws.
+		// Bounds are uploaded once, so instances moved after this are culled at their old location.
+		void updateCullingDescriptorSet(const std::shared_ptr<DescriptorSetLayout>);
+		// Number of draws written by the last GPU culling. The GPU must be done with it.
+		uint32_t readIndirectDrawCount() const;
+
+		// Inputs of GPU culling, as uploaded by updateCullingDescriptorSet, built on the CPU.
+		struct CullingTemplates
+		{
+			std::vector<uint32_t> meshDrawRanges; // First and end draw template of each mesh, interleaved
+			std::vector<Draw> drawTemplates; // Culling fills in the instance of each draw
+			std::vector<math::MeshletBounds> drawBounds; // Local bounds of each draw template
+		};
+		// Cluster culled meshes get one template per meshlet, and the rest one per primitive.
+		void buildCullingTemplates(CullingTemplates& templates) const;
+
+		// Instanced draws for the current instances, without touching the GPU.
+		// Instances of the same mesh are grouped, and each primitive of the mesh gets a single draw for the whole group.
+		// Instance offsets index the world matrices in the order returned by instanceWorldMatrices().
+		const std::vector<Draw>& instancedDraws();
+		// World matrices, sorted so that the instances of each mesh are contiguous.
+		const std::vector<math::Mat44f>& instanceWorldMatrices();
+		// World space bounds of the instances, in the same order as instanceWorldMatrices().
+		const math::AABBSoA& instanceWorldBounds();
+
+		// Like instancedDraws, but only for the instances whose bounds intersect worldFrustum.
+		// The world matrices of visible instances are compacted, so all visible instances of a mesh still share
+		// a single draw per primitive. Instance offsets index visibleWorldMatrices().
+		// Draw depth is that of the nearest instance center.
+		// Meshes with enough meshlets are also culled per meshlet, against the frustum and, with back face culling, by
+		// facing. Each visible instance of those gets its own draws, one per run of consecutive visible meshlets.
+		// draws is overwritten.
+		void visibleDraws(const math::Frustum& worldFrustum, std::vector<Draw>& draws);
+		// World matrices of the instances found visible by the last call to visibleDraws, in draw order.
+		const std::vector<math::Mat44f>& visibleWorldMatrices() const { return m_visibleWorldMtx; }
+
+		// Pool used to update instance bounds and cull them. Culling runs on the calling thread when null.
+		void setCullingPool(core::ThreadPool* pool) { m_cullingPool = pool; }
+		// Whether meshlets can be culled by facing. Must match the cull mode of the pipeline drawing the scene,
+		// or double sided and open meshes lose their back faces. Off by default, like the gbuffer pipeline.
+		// Set it before updateCullingDescriptorSet, which uploads it for GPU culling.
+		void setBackFaceCulling(bool cull) { m_backFaceCulling = cull; }
+		bool backFaceCulling() const { return m_backFaceCulling; }
 
 		gfx::RasterHeap m_geometry;
 
 
 	private:
-		void uploadMatrixBuffer();
+		void sortInstances();
+		void updateWorldBounds();
+		void addMeshDraws(uint32_t meshNdx, uint32_t instanceBegin, uint32_t instanceEnd, float depth, std::vector<Draw>& draws) const;
+		void addVisibleMeshletDraws(uint32_t instanceNdx, uint32_t instanceOffset, const math::Frustum& worldFrustum, float depth, std::vector<Draw>& draws) const;
+		bool isClusterCulled(uint32_t meshNdx) const;
+		// Smaller meshes are cheaper to draw whole and instanced than to cull per meshlet
+		static constexpr uint32_t kMinClusterCulledMeshlets = 8;
+		struct InstanceRange
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+		void markMatricesDirty(InstanceRange range);
+		// Writes the changed matrices to the slice of the current frame in flight.
+		// Compacted matrices, when given, are written right after those of all instances.
+		void uploadMatrixBuffer(const std::vector<math::Mat44f>* compactedMatrices = nullptr);
+		void uploadCullingBuffers();
+		void fillBatch(Batch& batch) const;
 
 		std::vector<uint32_t> m_instanceMeshNdx;
 		std::vector<math::Mat44f> m_instanceWorldMtx;
-		std::shared_ptr<GPUBuffer> m_worldMtxBuffer;
-		std::shared_ptr<DescriptorSetPool> m_descriptorSet;
+		std::vector<uint32_t> m_instanceSlot; // Position of each instance id in the (sorted) instance arrays
+		std::vector<uint32_t> m_slotInstance; // Id of the instance at each position
+		bool m_instancesSorted = true;
+		std::vector<Draw> m_draws; // Cached until instances change
+		bool m_drawsDirty = false;
+		math::AABBSoA m_instanceWorldBounds; // Cached until instances change
+		bool m_boundsDirty = false;
+		std::vector<uint32_t> m_visibleInstances;
+		std::vector<math::Mat44f> m_visibleWorldMtx;
+		core::ThreadPool* m_cullingPool = nullptr;
+		bool m_backFaceCulling = false;
+		std::shared_ptr<DescriptorSetPool> m_descriptorSet; // One set per frame in flight
+
+		// World matrices, one slice per frame in flight, so the CPU never writes to a slice the GPU may be reading.
+		// Slices stay mapped, grow geometrically, and are only written where instances changed since their last use.
+		// When drawing culled instances, their compacted matrices follow those of all instances, and are written every frame.
+		struct MatrixSlice
+		{
+			std::shared_ptr<GPUBuffer> buffer;
+			math::Mat44f* mapped = nullptr;
+			size_t capacity = 0; // In matrices
+			std::vector<InstanceRange> dirtyRanges;
+		};
+		static constexpr size_t kMaxDirtyRanges = 64; // More than this are merged into one
+		std::vector<MatrixSlice> m_matrixSlices;
+
+		// GPU culling
+		std::shared_ptr<GPUBuffer> m_cullingInstances; // World matrix, bounds and mesh of each instance
+		std::shared_ptr<GPUBuffer> m_meshDrawRanges; // Range of draw templates of each mesh
+		std::shared_ptr<GPUBuffer> m_drawTemplates; // One indirect draw per meshlet of cluster culled meshes, or per primitive of the rest
+		std::shared_ptr<GPUBuffer> m_drawBounds; // Local bounds of each draw template
+		std::shared_ptr<GPUBuffer> m_indirectDraws;
+		std::shared_ptr<GPUBuffer> m_indirectDrawCount;
+		uint32_t m_maxIndirectDraws = 0;
+		static constexpr uint32_t kMaxIndirectDraws = 1 << 20; // Caps the draw buffer when there are many meshlets
+		std::shared_ptr<DescriptorSetPool> m_cullingDescriptorSet;
 	};
 
 	inline RasterScene::RasterScene()
 	{}
-
-	inline RasterScene::~RasterScene()
-	{}
 }
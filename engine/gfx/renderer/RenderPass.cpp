@@ -25,7 +25,7 @@ using namespace rev::math;
 
 namespace rev::gfx
 {
-	void RenderPass::begin(vk::CommandBuffer cmd, const Vec2u& targetSize)
+	void RenderPass::begin(vk::CommandBuffer cmd, const Vec2u& targetSize, vk::SubpassContents contents)
 	{
 		refreshFrameBuffer(targetSize); // Refresh frame buffer
 
@@ -65,8 +65,14 @@ namespace rev::gfx
 		passInfo.renderArea.extent.width = targetSize.x();
 		passInfo.renderArea.extent.height = targetSize.y();
 		passInfo.clearValueCount = 0;
-		cmd.beginRenderPass(passInfo, vk::SubpassContents::eInline);
+		cmd.beginRenderPass(passInfo, contents);
 
+		if (contents == vk::SubpassContents::eInline)
+			setDrawArea(cmd, targetSize);
+	}
+
+	void RenderPass::setDrawArea(vk::CommandBuffer cmd, const Vec2u& targetSize) const
+	{
 		// Update drawing space
 		vk::Viewport viewport;
 		viewport.x = 0;
@@ -76,8 +82,12 @@ namespace rev::gfx
 		viewport.width = (float)targetSize.x();
 		viewport.height = (float)targetSize.y();
 
+		vk::Rect2D scissor;
+		scissor.extent.width = targetSize.x();
+		scissor.extent.height = targetSize.y();
+
 		cmd.setViewport(0, 1, &viewport);
-		cmd.setScissor(0, passInfo.renderArea);
+		cmd.setScissor(0, scissor);
 	}
 
 	void RenderPass::setClearDepth(float depth)
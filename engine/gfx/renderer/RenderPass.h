@@ -40,7 +40,11 @@ namespace rev::gfx
 
 		vk::RenderPass vkPass() const { return m_vkPass; }
 
-		void begin(vk::CommandBuffer cmd, const math::Vec2u& targetSize);
+		// With eSecondaryCommandBuffers contents, draw area state is not set. Secondary buffers must set it themselves.
+		void begin(vk::CommandBuffer cmd, const math::Vec2u& targetSize, vk::SubpassContents contents = vk::SubpassContents::eInline);
+		void setDrawArea(vk::CommandBuffer cmd, const math::Vec2u& targetSize) const;
+		// Inheritance info for secondary command buffers executed inside the pass. Only valid after begin.
+		vk::CommandBufferInheritanceInfo inheritanceInfo() const { return vk::CommandBufferInheritanceInfo(m_vkPass, 0, m_fb); }
 
 		void resetClearDepth() { m_clearZ = false; }
 		void setClearDepth(float depth);
@@ -18,8 +18,10 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#include <core/tasks/parallelFor.h>
 #include <gfx/backend/Vulkan/vulkanCommandQueue.h>
 #include <gfx/backend/Vulkan/gpuBuffer.h>
+#include <gfx/backend/computePipeline.h>
 #include <gfx/backend/rasterPipeline.h>
 #include <gfx/renderer/deferred/DeferredRenderer.h>
 #include <gfx/renderer/renderPass/fullScreenPass.h>
@@ -27,12 +29,39 @@
 #include <gfx/Image.h>
 #include <gfx/ImGui.h>
 
+#include <numeric>
+#include <tuple>
+
 #include <imgui/imgui.h>
 #include <imgui/backends/imgui_impl_vulkan.h>
 #include <imgui/backends/imgui_impl_win32.h>
 
 namespace rev::gfx
 {
+	namespace
+	{
+		auto geometryState(const RasterQueue::Batch& b)
+		{
+			return std::tie(b.indexBuffer, b.indexType, b.positionBinding, b.normalsBinding, b.tangentsBinding, b.texCoordBinding);
+		}
+
+		// ids[i] is the index of the first batch with the same state as batch i, according to less and equal.
+		// Sorting the batch indices keeps this O(n log n) in the number of batches.
+		template<class Less, class Equal>
+		void sharedStateIds(const std::vector<RasterQueue::Batch>& batches, std::vector<uint32_t>& order, std::vector<uint32_t>& ids, const Less& less, const Equal& equal)
+		{
+			order.resize(batches.size());
+			std::iota(order.begin(), order.end(), 0u);
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return less(batches[a], batches[b]); });
+			ids.resize(batches.size());
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				const bool shared = i > 0 && equal(batches[order[i - 1]], batches[order[i]]);
+				ids[order[i]] = shared ? ids[order[i - 1]] : order[i];
+			}
+		}
+	}
+
 	//---------------------------------------------------------------------------------------------------------------------
 	DeferredRenderer::DeferredRenderer()
 	{}
@@ -83,10 +112,21 @@ namespace rev::gfx
 		auto device = m_ctxt->nativeDevice();
 		m_gBufferPipeline.reset();
 		device.destroyPipelineLayout(m_gbufferPipelineLayout);
+		m_cullingPipeline.reset();
+		device.destroyPipelineLayout(m_cullingPipelineLayout);
 		device.destroyRenderPass(m_gBufferPass->vkPass());
 		device.destroySemaphore(m_imageAvailableSemaphore);
 	}
 
+	//---------------------------------------------------------------------------------------------------------------------
+	void DeferredRenderer::setRecordingPool(core::ThreadPool* pool)
+	{
+		m_recordingPool = pool;
+		// One command pool per job. The calling thread takes part in the work too
+		if (pool)
+			m_ctxt->initRecordingThreads(pool->numWorkers() + 1);
+	}
+
 	//---------------------------------------------------------------------------------------------------------------------
 	void DeferredRenderer::onResize(const math::Vec2u& newSize)
 	{
@@ -146,13 +186,126 @@ namespace rev::gfx
 		m_frameConstants.proj = scene.proj;
 		m_frameConstants.view = scene.view;
 
+		// Gather opaque geometry from all queues
+		const math::Frustum* cullFrustum = scene.cullFrustum ? &*scene.cullFrustum : nullptr;
+		const bool gpuCulling = m_gpuCulling && cullFrustum && m_ctxt->deviceInfo().gpuCulling();
+		m_draws.clear();
+		m_batches.clear();
+		m_drawBatch.clear();
+		m_indirectDraws.clear();
+		for(const auto& queue : scene.m_opaqueGeometry)
+		{
+			if (gpuCulling)
+			{
+				auto& indirectDraws = m_indirectDraws.emplace_back();
+				if (queue->getIndirectDraws(indirectDraws))
+					continue;
+				m_indirectDraws.pop_back(); // Culled on the CPU instead
+			}
+
+			m_queueDraws.clear();
+			m_queueBatches.clear();
+			queue->getDrawBatches(m_queueDraws, m_queueBatches, cullFrustum);
+
+			const auto drawOffset = (uint32_t)m_draws.size();
+			m_draws.insert(m_draws.end(), m_queueDraws.begin(), m_queueDraws.end());
+			for (auto& batch : m_queueBatches)
+			{
+				batch.firstDraw += drawOffset;
+				batch.endDraw += drawOffset;
+				m_drawBatch.insert(m_drawBatch.end(), batch.endDraw - batch.firstDraw, (uint32_t)m_batches.size());
+				m_batches.push_back(std::move(batch));
+			}
+
+			m_doubleBufferNdx ^= 1;
+		}
+
+		// Sort draws by state
+		const float nearDepth = cullFrustum ? cullFrustum->nearDistance() : 0.f;
+		const float farDepth = cullFrustum ? cullFrustum->farDistance() : 1.f;
+		m_sortedDraws.clear();
+		// Batches sharing state get the id of the first of them
+		sharedStateIds(m_batches, m_batchOrder, m_descriptorSetIds,
+			[](const RasterQueue::Batch& a, const RasterQueue::Batch& b) { return a.descriptorSet < b.descriptorSet; },
+			[](const RasterQueue::Batch& a, const RasterQueue::Batch& b) { return a.descriptorSet == b.descriptorSet; });
+		sharedStateIds(m_batches, m_batchOrder, m_geometryIds,
+			[](const RasterQueue::Batch& a, const RasterQueue::Batch& b) { return geometryState(a) < geometryState(b); },
+			[](const RasterQueue::Batch& a, const RasterQueue::Batch& b) { return sameIndexBuffer(a, b) && sameVertexBuffers(a, b); });
+		for (uint32_t batchNdx = 0; batchNdx < m_batches.size(); ++batchNdx)
+		{
+			const auto& batch = m_batches[batchNdx];
+			const uint32_t descriptorSetId = m_descriptorSetIds[batchNdx];
+			const uint32_t geometryId = m_geometryIds[batchNdx];
+
+			for (uint32_t i = batch.firstDraw; i < batch.endDraw; ++i)
+			{
+				const auto& draw = m_draws[i];
+				const uint32_t depthBucket = DrawKey::depthToBucket(draw.depth, nearDepth, farDepth);
+				const uint64_t key = DrawKey::encode(0, descriptorSetId, geometryId, draw.materialIndex, depthBucket);
+				m_sortedDraws.push_back({ key, i });
+			}
+		}
+		radixSort(m_sortedDraws, m_sortScratch);
+
 		// Render geometry if the scene is loaded
 		auto scope = m_ctxt->getScopedCmdBuffer(static_cast<VulkanCommandQueue&>(m_ctxt->GfxQueue()).nativeQueue());
 		auto cmd = scope.cmd;
-		m_gBufferPass->begin(cmd, m_windowSize);
 
-		// Bind pipeline
-		m_gBufferPipeline->bind(cmd);
+		// Compute work can't be recorded inside the render pass
+		if (!m_indirectDraws.empty())
+			recordGPUCulling(cmd, *cullFrustum);
+
+		// Split recording across the pool when there are enough draws to keep several threads busy
+		const size_t numDraws = m_sortedDraws.size();
+		size_t numJobs = 0;
+		if (m_recordingPool)
+			numJobs = numRecordingJobs(numDraws, m_ctxt->numRecordingThreads(), kMinDrawsPerRecordingJob);
+
+		// Reload outside of the recording jobs, so they don't race to do it
+		m_gBufferPipeline->refresh();
+
+		m_bindStats = {};
+		if (numJobs > 1)
+		{
+			m_gBufferPass->begin(cmd, m_windowSize, vk::SubpassContents::eSecondaryCommandBuffers);
+
+			const auto inheritance = m_gBufferPass->inheritanceInfo();
+			m_secondaryCmdBuffers.resize(numJobs);
+			m_jobBindStats.assign(numJobs, {});
+			// Jobs use the pool of their own index, so no two threads ever record from the same pool
+			core::parallelFor(*m_recordingPool, 0, numJobs, 1, [&](size_t job) {
+				auto secondary = m_ctxt->getSecondaryCmdBuffer(job);
+				secondary.begin(vk::CommandBufferBeginInfo(
+					vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+					&inheritance));
+				m_gBufferPass->setDrawArea(secondary, m_windowSize);
+
+				const auto [sortedBegin, sortedEnd] = recordingJobRange(numDraws, numJobs, job);
+				recordGeometryDraws(secondary, sortedBegin, sortedEnd, job + 1 == numJobs, m_jobBindStats[job]);
+
+				secondary.end();
+				m_secondaryCmdBuffers[job] = secondary;
+			});
+
+			cmd.executeCommands(m_secondaryCmdBuffers);
+			for (const auto& jobStats : m_jobBindStats)
+				m_bindStats += jobStats;
+			m_bindStats.recordingJobs = (uint32_t)numJobs;
+		}
+		else
+		{
+			m_gBufferPass->begin(cmd, m_windowSize);
+			recordGeometryDraws(cmd, 0, numDraws, true, m_bindStats);
+		}
+
+		m_gBufferPass->end(cmd);
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------
+	void DeferredRenderer::recordGeometryDraws(vk::CommandBuffer cmd, size_t sortedBegin, size_t sortedEnd, bool withIndirectDraws, BindStats& stats) const
+	{
+		// Bind pipeline. Already refreshed by renderGeometryPass
+		m_gBufferPipeline->bindRefreshed(cmd);
 
 		// Frame set up
 		cmd.pushConstants<FramePushConstants>(
@@ -167,25 +320,25 @@ namespace rev::gfx
 			m_gbufferPipelineLayout,
 			0, m_geomFrameDescriptors->getDescriptor(0), {});
 
-		// Render opaque geometry
-		std::vector<RasterQueue::Draw> draws;
-		std::vector<RasterQueue::Batch> batches;
-		for(const auto& queue : scene.m_opaqueGeometry)
+		// Record draws. State is only checked when the batch changes, and binds that match the bound state are skipped
+		stats.draws += uint32_t(sortedEnd - sortedBegin);
+		BatchBinder binder(stats);
+		auto bindBatch = [&](const RasterQueue::Batch& batch)
 		{
-			// Get queue draw batches
-			draws.clear();
-			batches.clear();
-			queue->getDrawBatches(draws, batches);
-
-			for (const auto& batch : batches)
+			const auto binds = binder.bind(batch);
+			if (binds.descriptorSet)
 			{
-				// Update descriptor set
 				cmd.bindDescriptorSets(
 					vk::PipelineBindPoint::eGraphics,
 					m_gbufferPipelineLayout,
-					1, batch.descriptorSet , {});
+					1, batch.descriptorSet, {});
+			}
 
+			if (binds.indexBuffer)
 				cmd.bindIndexBuffer(batch.indexBuffer->buffer(), batch.indexBuffer->offset(), batch.indexType);
+
+			if (binds.vertexBuffers)
+			{
 				cmd.bindVertexBuffers(0, {
 					batch.positionBinding.first->buffer(),
 					batch.normalsBinding.first->buffer(),
@@ -197,18 +350,74 @@ namespace rev::gfx
 					batch.tangentsBinding.first->offset() + batch.tangentsBinding.second,
 					batch.texCoordBinding.first->offset() + batch.texCoordBinding.second
 					});
-
-				for (uint32_t i = batch.firstDraw; i < batch.endDraw; ++i)
-				{
-					auto& draw = draws[i];
-					cmd.drawIndexed(draw.numIndices, draw.numInstances, draw.indexOffset, draw.vtxOffset, draw.instanceOffset);
-				}
 			}
+		};
 
-			m_doubleBufferNdx ^= 1;
+		for (size_t i = sortedBegin; i < sortedEnd; ++i)
+		{
+			const auto drawNdx = m_sortedDraws[i].drawNdx;
+			bindBatch(m_batches[m_drawBatch[drawNdx]]);
+
+			auto& draw = m_draws[drawNdx];
+			cmd.drawIndexed(draw.numIndices, draw.numInstances, draw.indexOffset, draw.vtxOffset, draw.instanceOffset);
 		}
 
-		m_gBufferPass->end(cmd);
+		if (!withIndirectDraws)
+			return;
+
+		// GPU driven draws, written by the culling shader
+		for (const auto& indirectDraws : m_indirectDraws)
+		{
+			bindBatch(indirectDraws.batch);
+			cmd.drawIndexedIndirectCount(
+				indirectDraws.drawCommands->buffer(), 0,
+				indirectDraws.drawCount->buffer(), 0,
+				indirectDraws.maxDraws,
+				sizeof(vk::DrawIndexedIndirectCommand));
+			++stats.indirectDraws;
+		}
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------
+	void DeferredRenderer::recordGPUCulling(vk::CommandBuffer cmd, const math::Frustum& worldFrustum)
+	{
+		// Previous frames may still be reading the outputs
+		vk::MemoryBarrier drawsRead(vk::AccessFlagBits::eIndirectCommandRead, vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite);
+		cmd.pipelineBarrier(
+			vk::PipelineStageFlagBits::eDrawIndirect,
+			vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+			{}, drawsRead, {}, {});
+
+		for (const auto& indirectDraws : m_indirectDraws)
+			cmd.fillBuffer(indirectDraws.drawCount->buffer(), 0, sizeof(uint32_t), 0);
+
+		vk::MemoryBarrier countReset(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, countReset, {}, {});
+
+		CullingPushConstants constants;
+		for (size_t i = 0; i < 6; ++i)
+		{
+			const auto& plane = worldFrustum.plane(i);
+			constants.planes[i] = math::Vec4f(plane.normal.x(), plane.normal.y(), plane.normal.z(), plane.t);
+		}
+		const auto viewPoint = worldFrustum.origin();
+		constants.viewPoint = math::Vec4f(viewPoint.x(), viewPoint.y(), viewPoint.z(), 1.f);
+
+		m_cullingPipeline->bind(cmd);
+		for (const auto& indirectDraws : m_indirectDraws)
+		{
+			constants.numInstances = indirectDraws.numInstances;
+			constants.maxDraws = indirectDraws.maxDraws;
+			m_cullingPipeline->bindDescriptorSets(cmd, indirectDraws.cullingDescriptorSet);
+			cmd.pushConstants<CullingPushConstants>(m_cullingPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+			// One workgroup per instance, in rows of up to kMaxCullingGroupsX
+			const auto groupsX = std::min(indirectDraws.numInstances, kMaxCullingGroupsX);
+			const auto groupsY = (indirectDraws.numInstances + kMaxCullingGroupsX - 1) / kMaxCullingGroupsX;
+			cmd.dispatch(groupsX, groupsY, 1);
+		}
+
+		vk::MemoryBarrier drawsWritten(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {}, drawsWritten, {}, {});
 	}
 
 	//---------------------------------------------------------------------------------------------------------------------
@@ -337,6 +546,13 @@ namespace rev::gfx
 			float fStops = log2f(m_postProConstants.exposure);
 			ImGui::SliderFloat("Exposure", &fStops, -3.f, 3.f);
 			m_postProConstants.exposure = powf(2.f, fStops);
+
+			if (m_ctxt->deviceInfo().gpuCulling())
+				ImGui::Checkbox("GPU Culling", &m_gpuCulling);
+
+			ImGui::Text("Draws: %u (%u indirect)", m_bindStats.draws, m_bindStats.indirectDraws);
+			ImGui::Text("Binds: %u (%u skipped)", m_bindStats.binds, m_bindStats.skippedBinds);
+			ImGui::Text("Recording jobs: %u", m_bindStats.recordingJobs);
 		}
 	}
 
@@ -372,6 +588,16 @@ namespace rev::gfx
 		m_postProDescriptorLayout->addImage("HDR Light", 0, vk::ShaderStageFlagBits::eFragment);
 		m_postProDescriptorLayout->close();
 		m_postProDescriptors = std::make_shared <DescriptorSetPool>(m_postProDescriptorLayout, 1);
+
+		// --- GPU culling ---
+		m_cullingDescriptorLayout = std::make_shared<DescriptorSetLayout>();
+		m_cullingDescriptorLayout->addStorageBuffer("instances", 0, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->addStorageBuffer("meshDrawRanges", 1, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->addStorageBuffer("drawTemplates", 2, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->addStorageBuffer("drawBounds", 3, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->addStorageBuffer("drawCommands", 4, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->addStorageBuffer("drawCount", 5, vk::ShaderStageFlagBits::eCompute);
+		m_cullingDescriptorLayout->close();
 	}
 
 	//---------------------------------------------------------------------------------------------------------------------
@@ -470,9 +696,22 @@ namespace rev::gfx
 			"gbuffer.frag.spv",
 			true);
 
+		// GPU culling pipeline
+		vk::PushConstantRange cullingPushRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullingPushConstants));
+		auto cullingSetLayout = m_cullingDescriptorLayout->layout();
+		vk::PipelineLayoutCreateInfo cullingLayoutInfo({},
+			1, &cullingSetLayout, // Descriptor sets
+			1, &cullingPushRange); // Push constants
+
+		m_cullingPipelineLayout = device.createPipelineLayout(cullingLayoutInfo);
+		if (m_ctxt->deviceInfo().gpuCulling()) // The shader uses scalar block layouts
+			m_cullingPipeline = std::make_unique<gfx::ComputePipeline>(m_cullingPipelineLayout, "cullInstances.comp.spv");
+
 		// Set up shader reload
 		m_shaderWatcher->listen([this](auto paths) {
 			m_gBufferPipeline->invalidate();
+			if (m_cullingPipeline)
+				m_cullingPipeline->invalidate();
 			m_lightingPass->invalidateShaders();
 			m_postPass->invalidateShaders();
 			});
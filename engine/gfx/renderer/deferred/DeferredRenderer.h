@@ -22,18 +22,29 @@
 #include <core/platform/fileSystem/FolderWatcher.h>
 #include <gfx/backend/DescriptorSet.h>
 #include <gfx/backend/Vulkan/Vulkan.h>
+#include <gfx/renderer/DrawKey.h>
+#include <gfx/renderer/DrawRecording.h>
+#include <gfx/renderer/RasterQueue.h>
 #include <gfx/renderer/RenderPass.h>
 #include <gfx/renderer/EnvironmentProbe.h>
 #include <math/algebra/matrix.h>
+#include <math/geometry/types.h>
+
+#include <optional>
+
+namespace rev::core
+{
+	class ThreadPool;
+}
 
 namespace rev::gfx
 {
 	class FrameBufferManager;
 	class GPUBuffer;
+	class ComputePipeline;
 	class RasterPipeline;
 	class RenderContextVulkan;
 	class FullScreenPass;
-	class RasterQueue;
 
 	class DeferredRenderer
 	{
@@ -44,6 +55,7 @@ namespace rev::gfx
 
 			math::Mat44f proj;
 			math::Mat44f view;
+			std::optional<math::Frustum> cullFrustum; // World space. Geometry outside of it can be skipped
 			math::Vec3f lightDir;
 			math::Vec3f ambientColor;
 			math::Vec3f lightColor;
@@ -54,6 +66,9 @@ namespace rev::gfx
 			uint32_t maxTexturesPerBatch;
 		};
 
+		// Geometry pass stats for the last frame
+		using BindStats = gfx::BindStats;
+
 		DeferredRenderer();
 		~DeferredRenderer();
 
@@ -69,6 +84,12 @@ namespace rev::gfx
 		void render(SceneDesc& scene);
 		void updateUI();
 		auto batchDescriptorLayout() const { return m_geomBatchDescriptorLayout; }
+		const BindStats& bindStats() const { return m_bindStats; }
+		// Layout for RasterScene::updateCullingDescriptorSet
+		auto cullingDescriptorLayout() const { return m_cullingDescriptorLayout; }
+		// Pool used to record the geometry pass into secondary command buffers. Recorded inline when null.
+		// Must be called after init.
+		void setRecordingPool(core::ThreadPool* pool);
 
 	private:
 		void createDescriptorLayouts(size_t numTextures);
@@ -81,6 +102,8 @@ namespace rev::gfx
 		void loadIBLLUT();
 
 		void renderGeometryPass(SceneDesc& scene);
+		void recordGPUCulling(vk::CommandBuffer cmd, const math::Frustum& worldFrustum);
+		void recordGeometryDraws(vk::CommandBuffer cmd, size_t sortedBegin, size_t sortedEnd, bool withIndirectDraws, BindStats& stats) const;
 		void renderLightingPass();
 		void renderPostProPass();
 
@@ -105,6 +128,7 @@ namespace rev::gfx
 		std::shared_ptr<gfx::DescriptorSetPool> m_geomFrameDescriptors;
 		std::shared_ptr<gfx::DescriptorSetPool> m_lightingDescriptors;
 		std::shared_ptr<gfx::DescriptorSetPool> m_postProDescriptors;
+		std::shared_ptr<gfx::DescriptorSetLayout> m_cullingDescriptorLayout;
 
 		vk::PipelineLayout m_gbufferPipelineLayout;
 		std::unique_ptr<gfx::RasterPipeline> m_gBufferPipeline;
@@ -112,6 +136,8 @@ namespace rev::gfx
 		std::unique_ptr<gfx::RasterPipeline> m_lightingPipeline;
 		vk::PipelineLayout m_postPipelineLayout;
 		std::unique_ptr<gfx::RasterPipeline> m_postPipeline;
+		vk::PipelineLayout m_cullingPipelineLayout;
+		std::unique_ptr<gfx::ComputePipeline> m_cullingPipeline;
 
 		std::shared_ptr<gfx::ImageBuffer> m_hdrLightBuffer;
 		std::shared_ptr<gfx::ImageBuffer> m_emissiveBuffer;
@@ -157,6 +183,15 @@ namespace rev::gfx
 			float bloom;
 		} m_postProConstants;
 
+		static constexpr uint32_t kMaxCullingGroupsX = 65535; // Minimum maxComputeWorkGroupCount guaranteed by Vulkan
+		struct CullingPushConstants
+		{
+			math::Vec4f planes[6]; // World space. Normal pointing outwards and distance
+			math::Vec4f viewPoint; // World space
+			uint32_t numInstances;
+			uint32_t maxDraws;
+		};
+
 		std::unique_ptr<gfx::RenderPass> m_gBufferPass;
 		std::unique_ptr<gfx::FullScreenPass> m_lightingPass;
 		std::unique_ptr<gfx::FullScreenPass> m_postPass; // Combined post process effects
@@ -168,5 +203,26 @@ namespace rev::gfx
 		std::unique_ptr<gfx::FrameBufferManager> m_frameBuffers;
 
 		core::FolderWatcher::path m_shadersFolder;
+
+		// Geometry pass draw lists, reused across frames
+		std::vector<RasterQueue::Draw> m_queueDraws;
+		std::vector<RasterQueue::Batch> m_queueBatches;
+		std::vector<RasterQueue::Draw> m_draws;
+		std::vector<RasterQueue::Batch> m_batches;
+		std::vector<uint32_t> m_drawBatch; // Batch of each draw
+		std::vector<uint32_t> m_batchOrder; // Scratch to find batches sharing state
+		std::vector<uint32_t> m_descriptorSetIds; // Per batch
+		std::vector<uint32_t> m_geometryIds; // Per batch
+		std::vector<SortedDraw> m_sortedDraws;
+		std::vector<SortedDraw> m_sortScratch;
+		std::vector<RasterQueue::IndirectDraws> m_indirectDraws;
+		bool m_gpuCulling = false;
+		BindStats m_bindStats;
+
+		// Multithreaded recording
+		static constexpr size_t kMinDrawsPerRecordingJob = 512; // Smaller jobs cost more to schedule than to record
+		core::ThreadPool* m_recordingPool = nullptr;
+		std::vector<vk::CommandBuffer> m_secondaryCmdBuffers;
+		std::vector<BindStats> m_jobBindStats;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2018 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "animation.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace rev::gfx {
+
+	namespace
+	{
+		math::Vec3f lerp(const math::Vec3f& a, const math::Vec3f& b, float f)
+		{
+			return a * (1 - f) + b * f;
+		}
+
+		// Along the shortest path
+		math::Quatf lerp(const math::Quatf& a, const math::Quatf& b, float f)
+		{
+			const float cosTheta = a.x() * b.x() + a.y() * b.y() + a.z() * b.z() + a.w() * b.w();
+			if (cosTheta < 0.f)
+				return math::Quatf::lerp(a, math::Quatf(-b.x(), -b.y(), -b.z(), -b.w()), f);
+			return math::Quatf::lerp(a, b, f);
+		}
+
+		// Leaves dst untouched for empty channels
+		template<class T>
+		void sampleChannel(const Animation::Channel<T>& channel, float t, uint32_t& key, T& dst)
+		{
+			if (channel.t.empty())
+				return;
+			if (t <= channel.t[0])
+			{
+				key = 0;
+				dst = channel.values[0];
+				return;
+			}
+			if (t >= channel.t.back())
+			{
+				key = uint32_t(channel.t.size() - 1);
+				dst = channel.values.back();
+				return;
+			}
+			// Value is within two others
+			key = Animation::findKey(channel.t, t, key);
+			const auto t0 = channel.t[key];
+			const auto t1 = channel.t[key + 1];
+			dst = lerp(channel.values[key], channel.values[key + 1], (t - t0) / (t1 - t0));
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint32_t Animation::findKey(const std::vector<float>& times, float t, uint32_t hint)
+	{
+		assert(times.size() >= 2 && times[0] <= t && t < times.back());
+		if (size_t(hint) + 1 < times.size() && times[hint] <= t)
+		{
+			if (t < times[hint + 1])
+				return hint;
+			// Forward playback rarely skips more than one key per frame
+			if (size_t(hint) + 2 < times.size() && t < times[hint + 2])
+				return hint + 1;
+		}
+		// Seek or loop
+		auto next = std::upper_bound(times.begin(), times.end(), t);
+		return uint32_t(next - times.begin() - 1);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst) const
+	{
+		uint32_t key = 0;
+		if (channelNdx < m_translationChannels.size())
+			sampleChannel(m_translationChannels[channelNdx], t, key, dst.translation);
+		key = 0;
+		sampleChannel(m_rotationChannels[channelNdx], t, key, dst.rotation);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst, Cursor& cursor) const
+	{
+		cursor.translationKeys.resize(m_translationChannels.size(), 0);
+		cursor.rotationKeys.resize(m_rotationChannels.size(), 0);
+		if (channelNdx < m_translationChannels.size())
+			sampleChannel(m_translationChannels[channelNdx], t, cursor.translationKeys[channelNdx], dst.translation);
+		sampleChannel(m_rotationChannels[channelNdx], t, cursor.rotationKeys[channelNdx], dst.rotation);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getPose(float t, Pose& dst) const
+	{
+		Cursor cursor;
+		getPose(t, dst, cursor);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void Animation::getPose(float t, Pose& dst, Cursor& cursor) const
+	{
+		dst.joints.resize(m_rotationChannels.size());
+		for (size_t i = 0; i < dst.joints.size(); ++i)
+			getChannelPose(i, t, dst.joints[i], cursor);
+	}
+
+}
@@ -21,6 +21,7 @@
 
 #include <math/algebra/vector.h>
 #include <math/algebra/quaternion.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -49,46 +50,33 @@ namespace rev::gfx {
 			std::vector<T> values;
 		};
 
+		// Playback state of a single instance of an animation.
+		// Remembers the last key sampled on each channel, so playing forward only has to look at the next key.
+		struct Cursor
+		{
+			std::vector<uint32_t> translationKeys;
+			std::vector<uint32_t> rotationKeys;
+		};
+
 		void getPose(float t, Pose& dst) const;
+		void getPose(float t, Pose& dst, Cursor& cursor) const;
 		float duration() const
 		{
 			return m_rotationChannels[0].t.back();
 		}
-		
-		void getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst)
-		{
-			auto& channel = m_rotationChannels[channelNdx];
-			if(channel.t.empty())
-				return;
-			if(t <= channel.t[0])
-			{
-				dst.rotation = channel.values[0];
-				return;
-			}
-			if(t >= channel.t.back())
-			{
-				dst.rotation = channel.values.back();
-				return;
-			}
-			// Value is within two others
-			for(size_t i = 0; i < channel.t.size(); ++i)
-			{
-				if(channel.t[i+1] > t)
-				{
-					auto& v0 = channel.values[i];
-					auto& v1 = channel.values[i+1];
-					auto t0 = channel.t[i];
-					auto t1 = channel.t[i+1];
-					auto f = (t-t0)/(t1-t0);
-					auto v = math::Quatf::lerp(v0, v1, f);
-					dst.rotation = v;
-					break;
-				}
-			}
-		}
+
+		void getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst) const;
+		void getChannelPose(size_t channelNdx, float t, Pose::JointPose& dst, Cursor& cursor) const;
+
+		// Index of the last key in times not after t. Needs times[0] <= t < times.back().
+		// Checks the hinted key and the one after it before falling back to a binary search.
+		static uint32_t findKey(const std::vector<float>& times, float t, uint32_t hint);
 
 		std::vector<Channel<math::Vec3f>> m_translationChannels;
 		std::vector<Channel<math::Quatf>> m_rotationChannels;
+		// Node animated by each channel, as an index into the nodes of the scene the clip was loaded with.
+		// Empty when the clip doesn't know its targets.
+		std::vector<uint32_t> m_channelNodes;
 	};
 
 }
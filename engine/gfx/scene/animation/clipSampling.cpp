@@ -0,0 +1,321 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2018 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "clipSampling.h"
+
+#include <cmath>
+#include <immintrin.h>
+#include <math/cpuFeatures.h>
+
+namespace rev::gfx {
+
+	namespace
+	{
+		const bool sUseAVX2 = math::cpuFeatures().hasAVX2FMA();
+
+		static_assert(sizeof(math::Quatf) == 4 * sizeof(float));
+		static_assert(sizeof(math::Vec3f) == 3 * sizeof(float));
+
+		const float kIdentity[4] = { 0.f, 0.f, 0.f, 1.f };
+		const float kZero[3] = { 0.f, 0.f, 0.f };
+
+		// Keys of channel around t, as float arrays, and the interpolation factor between them.
+		// Times outside the channel clamp to its first or last key. Returns false for channels without keys.
+		template<class T>
+		bool findKeys(const Animation::Channel<T>& channel, float t, uint32_t& key, const float*& v0, const float*& v1, float& f)
+		{
+			if (channel.t.empty())
+				return false;
+			if (t <= channel.t[0])
+			{
+				key = 0;
+				v0 = v1 = reinterpret_cast<const float*>(&channel.values[0]);
+				f = 0.f;
+				return true;
+			}
+			if (t >= channel.t.back())
+			{
+				key = uint32_t(channel.t.size() - 1);
+				v0 = v1 = reinterpret_cast<const float*>(&channel.values.back());
+				f = 0.f;
+				return true;
+			}
+			key = Animation::findKey(channel.t, t, key);
+			v0 = reinterpret_cast<const float*>(&channel.values[key]);
+			v1 = reinterpret_cast<const float*>(&channel.values[key + 1]);
+			f = (t - channel.t[key]) / (channel.t[key + 1] - channel.t[key]);
+			return true;
+		}
+
+		// Slerp weights from "A Fast and Accurate Algorithm for Computing SLERP" (Eberly 2011).
+		// sin(f*theta)/sin(theta) is expanded as a polynomial in cos(theta) - 1, which converges for cos(theta) >= 0.
+		// That is always the case after flipping quaternions to the shortest path.
+		// Twelve terms, with the last one scaled by mu, keep the error in the weights below 1e-6.
+		constexpr int kSlerpTerms = 12;
+		constexpr float kSlerpMu = 1.89371761f;
+		constexpr float slerpU(int i) { return (i == kSlerpTerms ? kSlerpMu : 1.f) / (i * (2 * i + 1)); }
+		constexpr float slerpV(int i) { return (i == kSlerpTerms ? kSlerpMu : 1.f) * i / (2 * i + 1); }
+
+		// sin(f*theta)/sin(theta), with cosThetaMinus1 = cos(theta) - 1
+		float slerpWeight(float f, float cosThetaMinus1)
+		{
+			const float f2 = f * f;
+			float c = 1.f;
+			for (int i = kSlerpTerms; i > 0; --i)
+				c = 1.f + (slerpU(i) * f2 - slerpV(i)) * cosThetaMinus1 * c;
+			return f * c;
+		}
+
+		__forceinline __m256 slerpWeight(__m256 f, __m256 cosThetaMinus1)
+		{
+			const __m256 one = _mm256_set1_ps(1.f);
+			const __m256 f2 = _mm256_mul_ps(f, f);
+			__m256 c = one;
+			for (int i = kSlerpTerms; i > 0; --i)
+			{
+				const __m256 b = _mm256_fmsub_ps(_mm256_set1_ps(slerpU(i)), f2, _mm256_set1_ps(slerpV(i)));
+				c = _mm256_fmadd_ps(_mm256_mul_ps(b, cosThetaMinus1), c, one);
+			}
+			return _mm256_mul_ps(f, c);
+		}
+
+		__forceinline __m256 pack(__m128 lo, __m128 hi)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+		}
+
+		// Loads eight quaternions as x, y, z and w registers
+		__forceinline void loadQuats(const float* const* src, __m256 q[4])
+		{
+			__m128 lo0 = _mm_loadu_ps(src[0]), lo1 = _mm_loadu_ps(src[1]), lo2 = _mm_loadu_ps(src[2]), lo3 = _mm_loadu_ps(src[3]);
+			__m128 hi0 = _mm_loadu_ps(src[4]), hi1 = _mm_loadu_ps(src[5]), hi2 = _mm_loadu_ps(src[6]), hi3 = _mm_loadu_ps(src[7]);
+			_MM_TRANSPOSE4_PS(lo0, lo1, lo2, lo3);
+			_MM_TRANSPOSE4_PS(hi0, hi1, hi2, hi3);
+			q[0] = pack(lo0, hi0);
+			q[1] = pack(lo1, hi1);
+			q[2] = pack(lo2, hi2);
+			q[3] = pack(lo3, hi3);
+		}
+
+		// Writes back the lanes set in mask
+		__forceinline void storeQuats(const __m256 q[4], Pose::JointPose* dst, uint32_t mask)
+		{
+			__m128 lo0 = _mm256_castps256_ps128(q[0]), lo1 = _mm256_castps256_ps128(q[1]);
+			__m128 lo2 = _mm256_castps256_ps128(q[2]), lo3 = _mm256_castps256_ps128(q[3]);
+			__m128 hi0 = _mm256_extractf128_ps(q[0], 1), hi1 = _mm256_extractf128_ps(q[1], 1);
+			__m128 hi2 = _mm256_extractf128_ps(q[2], 1), hi3 = _mm256_extractf128_ps(q[3], 1);
+			_MM_TRANSPOSE4_PS(lo0, lo1, lo2, lo3);
+			_MM_TRANSPOSE4_PS(hi0, hi1, hi2, hi3);
+			const __m128 lanes[8] = { lo0, lo1, lo2, lo3, hi0, hi1, hi2, hi3 };
+			for (int i = 0; i < 8; ++i)
+			{
+				if (mask & (1 << i))
+					_mm_storeu_ps(reinterpret_cast<float*>(&dst[i].rotation), lanes[i]);
+			}
+		}
+
+		__forceinline __m256 gather(const float* const* src, int component)
+		{
+			return _mm256_setr_ps(
+				src[0][component], src[1][component], src[2][component], src[3][component],
+				src[4][component], src[5][component], src[6][component], src[7][component]);
+		}
+
+		void resizeOutputs(const Animation& animation, Pose& dst, Animation::Cursor& cursor)
+		{
+			dst.joints.resize(animation.m_rotationChannels.size());
+			cursor.translationKeys.resize(animation.m_translationChannels.size(), 0);
+			cursor.rotationKeys.resize(animation.m_rotationChannels.size(), 0);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void sampleClip(const Animation& animation, float t, Pose& dst, RotationInterpolation interpolation)
+	{
+		Animation::Cursor cursor;
+		sampleClip(animation, t, dst, cursor, interpolation);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation)
+	{
+		if (sUseAVX2)
+			avx2::sampleClip(animation, t, dst, cursor, interpolation);
+		else
+			scalar::sampleClip(animation, t, dst, cursor, interpolation);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void scalar::sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation)
+	{
+		resizeOutputs(animation, dst, cursor);
+		const size_t numTranslations = animation.m_translationChannels.size();
+		for (size_t i = 0; i < dst.joints.size(); ++i)
+		{
+			auto& joint = dst.joints[i];
+			const float* v0;
+			const float* v1;
+			float f;
+			if (i < numTranslations && findKeys(animation.m_translationChannels[i], t, cursor.translationKeys[i], v0, v1, f))
+			{
+				float* translation = reinterpret_cast<float*>(&joint.translation);
+				for (int c = 0; c < 3; ++c)
+					translation[c] = v0[c] + (v1[c] - v0[c]) * f;
+			}
+
+			if (!findKeys(animation.m_rotationChannels[i], t, cursor.rotationKeys[i], v0, v1, f))
+				continue;
+			float cosTheta = v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2] + v0[3] * v1[3];
+			float sign = 1.f;
+			if (cosTheta < 0.f) // Shortest path
+			{
+				sign = -1.f;
+				cosTheta = -cosTheta;
+			}
+			float w0, w1;
+			if (interpolation == RotationInterpolation::SLerp)
+			{
+				w0 = slerpWeight(1.f - f, cosTheta - 1.f);
+				w1 = sign * slerpWeight(f, cosTheta - 1.f);
+			}
+			else
+			{
+				w0 = 1.f - f;
+				w1 = sign * f;
+			}
+			float q[4];
+			for (int c = 0; c < 4; ++c)
+				q[c] = v0[c] * w0 + v1[c] * w1;
+			if (interpolation == RotationInterpolation::NLerp)
+			{
+				const float invNorm = 1.f / std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+				for (int c = 0; c < 4; ++c)
+					q[c] *= invNorm;
+			}
+			joint.rotation = math::Quatf(q[0], q[1], q[2], q[3]);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void avx2::sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation)
+	{
+		resizeOutputs(animation, dst, cursor);
+		const size_t numJoints = dst.joints.size();
+		const size_t numTranslations = animation.m_translationChannels.size();
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256 signBit = _mm256_set1_ps(-0.f);
+
+		for (size_t first = 0; first < numJoints; first += 8)
+		{
+			// Key search is scalar, since every channel has its own key times.
+			// Lanes past the end, or without keys, interpolate constants and are not written back.
+			const float* translation0[8];
+			const float* translation1[8];
+			const float* rotation0[8];
+			const float* rotation1[8];
+			alignas(32) float translationF[8];
+			alignas(32) float rotationF[8];
+			uint32_t translationMask = 0;
+			uint32_t rotationMask = 0;
+			for (uint32_t lane = 0; lane < 8; ++lane)
+			{
+				const size_t i = first + lane;
+				if (i < numJoints && i < numTranslations && findKeys(animation.m_translationChannels[i], t, cursor.translationKeys[i], translation0[lane], translation1[lane], translationF[lane]))
+					translationMask |= 1 << lane;
+				else
+				{
+					translation0[lane] = translation1[lane] = kZero;
+					translationF[lane] = 0.f;
+				}
+				if (i < numJoints && findKeys(animation.m_rotationChannels[i], t, cursor.rotationKeys[i], rotation0[lane], rotation1[lane], rotationF[lane]))
+					rotationMask |= 1 << lane;
+				else
+				{
+					rotation0[lane] = rotation1[lane] = kIdentity;
+					rotationF[lane] = 0.f;
+				}
+			}
+			Pose::JointPose* joints = &dst.joints[first];
+
+			if (translationMask)
+			{
+				const __m256 f = _mm256_load_ps(translationF);
+				alignas(32) float result[3][8];
+				for (int c = 0; c < 3; ++c)
+				{
+					const __m256 a = gather(translation0, c);
+					const __m256 b = gather(translation1, c);
+					_mm256_store_ps(result[c], _mm256_fmadd_ps(_mm256_sub_ps(b, a), f, a));
+				}
+				for (uint32_t lane = 0; lane < 8; ++lane)
+				{
+					if (translationMask & (1 << lane))
+						joints[lane].translation = math::Vec3f(result[0][lane], result[1][lane], result[2][lane]);
+				}
+			}
+
+			if (rotationMask)
+			{
+				__m256 q0[4], q1[4];
+				loadQuats(rotation0, q0);
+				loadQuats(rotation1, q1);
+				const __m256 f = _mm256_load_ps(rotationF);
+
+				// Flip q1 where the quaternions are more than 90 degrees apart, to take the shortest path
+				__m256 cosTheta = _mm256_mul_ps(q0[0], q1[0]);
+				cosTheta = _mm256_fmadd_ps(q0[1], q1[1], cosTheta);
+				cosTheta = _mm256_fmadd_ps(q0[2], q1[2], cosTheta);
+				cosTheta = _mm256_fmadd_ps(q0[3], q1[3], cosTheta);
+				const __m256 sign = _mm256_and_ps(cosTheta, signBit);
+				cosTheta = _mm256_xor_ps(cosTheta, sign);
+
+				__m256 w0, w1;
+				if (interpolation == RotationInterpolation::SLerp)
+				{
+					const __m256 cosThetaMinus1 = _mm256_sub_ps(cosTheta, one);
+					w0 = slerpWeight(_mm256_sub_ps(one, f), cosThetaMinus1);
+					w1 = slerpWeight(f, cosThetaMinus1);
+				}
+				else
+				{
+					w0 = _mm256_sub_ps(one, f);
+					w1 = f;
+				}
+				w1 = _mm256_xor_ps(w1, sign);
+
+				__m256 q[4];
+				for (int c = 0; c < 4; ++c)
+					q[c] = _mm256_fmadd_ps(q1[c], w1, _mm256_mul_ps(q0[c], w0));
+
+				if (interpolation == RotationInterpolation::NLerp)
+				{
+					__m256 norm2 = _mm256_mul_ps(q[0], q[0]);
+					norm2 = _mm256_fmadd_ps(q[1], q[1], norm2);
+					norm2 = _mm256_fmadd_ps(q[2], q[2], norm2);
+					norm2 = _mm256_fmadd_ps(q[3], q[3], norm2);
+					const __m256 invNorm = _mm256_div_ps(one, _mm256_sqrt_ps(norm2));
+					for (int c = 0; c < 4; ++c)
+						q[c] = _mm256_mul_ps(q[c], invNorm);
+				}
+				storeQuats(q, joints, rotationMask);
+			}
+		}
+	}
+
+}
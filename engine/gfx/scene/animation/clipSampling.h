@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2018 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include "animation.h"
+
+namespace rev::gfx {
+
+	enum class RotationInterpolation
+	{
+		NLerp, // Normalized linear interpolation. Cheaper, with a small error in angular speed between keys
+		SLerp  // Spherical, constant angular speed. Uses a polynomial approximation instead of trigonometric functions
+	};
+
+	// Samples every channel of animation at time t, writing joint i of dst from the translation and rotation channels i.
+	// dst is resized to the number of rotation channels. Joints whose channels have no keys are left untouched.
+	// Rotations always interpolate along the shortest path.
+	// The default entry points dispatch at runtime to an AVX2 implementation that processes eight joints at a time in SoA
+	// form, or to a scalar fallback. Both are also exposed directly for testing and benchmarking.
+	void sampleClip(const Animation& animation, float t, Pose& dst, RotationInterpolation interpolation = RotationInterpolation::NLerp);
+	void sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation = RotationInterpolation::NLerp);
+
+	namespace scalar
+	{
+		void sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation);
+	}
+
+	// Only call these when math::cpuFeatures().hasAVX2FMA()
+	namespace avx2
+	{
+		void sampleClip(const Animation& animation, float t, Pose& dst, Animation::Cursor& cursor, RotationInterpolation interpolation);
+	}
+
+}
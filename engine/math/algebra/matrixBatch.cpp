@@ -0,0 +1,343 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "matrixBatch.h"
+
+#include <immintrin.h>
+#include <math/cpuFeatures.h>
+#include <math/geometry/aabb.h>
+
+namespace rev::math
+{
+	namespace
+	{
+		const bool sUseAVX2 = cpuFeatures().hasAVX2FMA();
+
+		//--------------------------------------------------------------------------------------------------------------
+		// SSE helpers
+		//--------------------------------------------------------------------------------------------------------------
+		// result = a * b, without FMA so it runs on any SSE capable CPU
+		__forceinline void mul44_sse(const Mat44f& a, const Mat44f& b, Mat44f& result)
+		{
+			// Load everything first, so result can alias a or b
+			const __m128 a0 = a.m_cols[0];
+			const __m128 a1 = a.m_cols[1];
+			const __m128 a2 = a.m_cols[2];
+			const __m128 a3 = a.m_cols[3];
+			for (int j = 0; j < 4; ++j)
+			{
+				const __m128 bj = b.m_cols[j];
+				__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bj, bj, 0x00));
+				r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bj, bj, 0x55)));
+				r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bj, bj, 0xaa)));
+				r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bj, bj, 0xff)));
+				result.m_cols[j] = r;
+			}
+		}
+
+		__forceinline Vec3f toVec3(__m128 x)
+		{
+			alignas(16) float v[4];
+			_mm_store_ps(v, x);
+			return Vec3f(v[0], v[1], v[2]);
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		// AVX2 helpers. Each ymm register holds the same column of two different matrices
+		//--------------------------------------------------------------------------------------------------------------
+		__forceinline __m256 pack(__m128 lo, __m128 hi)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+		}
+
+		__forceinline void unpack(__m256 x, __m128& lo, __m128& hi)
+		{
+			lo = _mm256_castps256_ps128(x);
+			hi = _mm256_extractf128_ps(x, 1);
+		}
+
+		// r0 = a0 * b0, r1 = a1 * b1
+		__forceinline void mul44x2_avx2(
+			const Mat44f& a0, const Mat44f& a1,
+			const Mat44f& b0, const Mat44f& b1,
+			Mat44f& r0, Mat44f& r1)
+		{
+			const __m256 ac0 = pack(a0.m_cols[0], a1.m_cols[0]);
+			const __m256 ac1 = pack(a0.m_cols[1], a1.m_cols[1]);
+			const __m256 ac2 = pack(a0.m_cols[2], a1.m_cols[2]);
+			const __m256 ac3 = pack(a0.m_cols[3], a1.m_cols[3]);
+			for (int j = 0; j < 4; ++j)
+			{
+				const __m256 bj = pack(b0.m_cols[j], b1.m_cols[j]);
+				// In lane broadcasts, so each half gets the components of its own matrix
+				__m256 r = _mm256_mul_ps(ac0, _mm256_permute_ps(bj, 0x00));
+				r = _mm256_fmadd_ps(ac1, _mm256_permute_ps(bj, 0x55), r);
+				r = _mm256_fmadd_ps(ac2, _mm256_permute_ps(bj, 0xaa), r);
+				r = _mm256_fmadd_ps(ac3, _mm256_permute_ps(bj, 0xff), r);
+				unpack(r, r0.m_cols[j], r1.m_cols[j]);
+			}
+		}
+
+		// Loads and stores of Vec3f that never touch memory past the third component
+		__forceinline __m128i xyzMask()
+		{
+			return _mm_setr_epi32(-1, -1, -1, 0);
+		}
+
+		__forceinline __m256 loadXYZx2(const Vec3f& v0, const Vec3f& v1)
+		{
+			const __m128i mask = xyzMask();
+			return pack(_mm_maskload_ps(v0.data(), mask), _mm_maskload_ps(v1.data(), mask));
+		}
+
+		__forceinline void storeXYZx2(__m256 x, Vec3f& v0, Vec3f& v1)
+		{
+			const __m128i mask = xyzMask();
+			_mm_maskstore_ps(v0.data(), mask, _mm256_castps256_ps128(x));
+			_mm_maskstore_ps(v1.data(), mask, _mm256_extractf128_ps(x, 1));
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Dispatch
+	//------------------------------------------------------------------------------------------------------------------
+	void batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out)
+	{
+		if (sUseAVX2)
+			avx2::batchMultiply(n, a, b, out);
+		else
+			sse::batchMultiply(n, a, b, out);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out)
+	{
+		if (sUseAVX2)
+			avx2::batchMultiply(n, a, b, out);
+		else
+			sse::batchMultiply(n, a, b, out);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out)
+	{
+		if (sUseAVX2)
+			avx2::batchMultiply(n, a, aIndices, b, out);
+		else
+			sse::batchMultiply(n, a, aIndices, b, out);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out)
+	{
+		if (sUseAVX2)
+			avx2::batchTransformPoints(n, m, in, out);
+		else
+			sse::batchTransformPoints(n, m, in, out);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out)
+	{
+		if (sUseAVX2)
+			avx2::batchTransformAABBs(n, m, in, out);
+		else
+			sse::batchTransformAABBs(n, m, in, out);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// SSE fallback. Separate mul and add, so results can differ from the AVX2 path in the last bits
+	//------------------------------------------------------------------------------------------------------------------
+	void sse::batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out)
+	{
+		for (size_t i = 0; i < n; ++i)
+			mul44_sse(a[i], b[i], out[i]);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void sse::batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out)
+	{
+		const Mat44f aCopy = a; // a could be one of the outputs
+		for (size_t i = 0; i < n; ++i)
+			mul44_sse(aCopy, b[i], out[i]);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void sse::batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out)
+	{
+		for (size_t i = 0; i < n; ++i)
+			mul44_sse(a[aIndices[i]], b[i], out[i]);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void sse::batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out)
+	{
+		const __m128 c0 = m.m_cols[0];
+		const __m128 c1 = m.m_cols[1];
+		const __m128 c2 = m.m_cols[2];
+		const __m128 c3 = m.m_cols[3];
+		for (size_t i = 0; i < n; ++i)
+		{
+			const Vec3f& p = in[i];
+			__m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x())), c3);
+			r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p.y())));
+			r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p.z())));
+			out[i] = toVec3(r);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void sse::batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out)
+	{
+		const __m128 c0 = m.m_cols[0];
+		const __m128 c1 = m.m_cols[1];
+		const __m128 c2 = m.m_cols[2];
+		const __m128 c3 = m.m_cols[3];
+		for (size_t i = 0; i < n; ++i)
+		{
+			const Vec3f& lo = in[i].min();
+			const Vec3f& hi = in[i].max();
+			// Same approach as operator*(Mat44f, AABB): extremes of each column's contribution
+			__m128 xa = _mm_mul_ps(c0, _mm_set1_ps(lo.x()));
+			__m128 xb = _mm_mul_ps(c0, _mm_set1_ps(hi.x()));
+			__m128 ya = _mm_mul_ps(c1, _mm_set1_ps(lo.y()));
+			__m128 yb = _mm_mul_ps(c1, _mm_set1_ps(hi.y()));
+			__m128 za = _mm_mul_ps(c2, _mm_set1_ps(lo.z()));
+			__m128 zb = _mm_mul_ps(c2, _mm_set1_ps(hi.z()));
+			__m128 rMin = _mm_add_ps(_mm_add_ps(_mm_min_ps(xa, xb), _mm_min_ps(ya, yb)), _mm_add_ps(_mm_min_ps(za, zb), c3));
+			__m128 rMax = _mm_add_ps(_mm_add_ps(_mm_max_ps(xa, xb), _mm_max_ps(ya, yb)), _mm_add_ps(_mm_max_ps(za, zb), c3));
+			out[i] = AABB(toVec3(rMin), toVec3(rMax));
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// AVX2. Accumulates with fused multiply-adds
+	//------------------------------------------------------------------------------------------------------------------
+	void avx2::batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out)
+	{
+		size_t i = 0;
+		for (; i + 1 < n; i += 2)
+			mul44x2_avx2(a[i], a[i + 1], b[i], b[i + 1], out[i], out[i + 1]);
+		if (i < n)
+			out[i] = a[i] * b[i];
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void avx2::batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out)
+	{
+		// Both halves share the same left operand
+		const __m256 ac0 = _mm256_broadcast_ps(&a.m_cols[0]);
+		const __m256 ac1 = _mm256_broadcast_ps(&a.m_cols[1]);
+		const __m256 ac2 = _mm256_broadcast_ps(&a.m_cols[2]);
+		const __m256 ac3 = _mm256_broadcast_ps(&a.m_cols[3]);
+		size_t i = 0;
+		for (; i + 1 < n; i += 2)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				const __m256 bj = pack(b[i].m_cols[j], b[i + 1].m_cols[j]);
+				__m256 r = _mm256_mul_ps(ac0, _mm256_permute_ps(bj, 0x00));
+				r = _mm256_fmadd_ps(ac1, _mm256_permute_ps(bj, 0x55), r);
+				r = _mm256_fmadd_ps(ac2, _mm256_permute_ps(bj, 0xaa), r);
+				r = _mm256_fmadd_ps(ac3, _mm256_permute_ps(bj, 0xff), r);
+				unpack(r, out[i].m_cols[j], out[i + 1].m_cols[j]);
+			}
+		}
+		if (i < n)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				const __m128 bj = b[i].m_cols[j];
+				__m128 r = _mm_mul_ps(_mm256_castps256_ps128(ac0), _mm_permute_ps(bj, 0x00));
+				r = _mm_fmadd_ps(_mm256_castps256_ps128(ac1), _mm_permute_ps(bj, 0x55), r);
+				r = _mm_fmadd_ps(_mm256_castps256_ps128(ac2), _mm_permute_ps(bj, 0xaa), r);
+				r = _mm_fmadd_ps(_mm256_castps256_ps128(ac3), _mm_permute_ps(bj, 0xff), r);
+				out[i].m_cols[j] = r;
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void avx2::batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out)
+	{
+		size_t i = 0;
+		for (; i + 1 < n; i += 2)
+			mul44x2_avx2(a[aIndices[i]], a[aIndices[i + 1]], b[i], b[i + 1], out[i], out[i + 1]);
+		if (i < n)
+			out[i] = a[aIndices[i]] * b[i];
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void avx2::batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out)
+	{
+		const __m256 c0 = _mm256_broadcast_ps(&m.m_cols[0]);
+		const __m256 c1 = _mm256_broadcast_ps(&m.m_cols[1]);
+		const __m256 c2 = _mm256_broadcast_ps(&m.m_cols[2]);
+		const __m256 c3 = _mm256_broadcast_ps(&m.m_cols[3]);
+		size_t i = 0;
+		for (; i + 1 < n; i += 2)
+		{
+			const __m256 p = loadXYZx2(in[i], in[i + 1]);
+			__m256 r = _mm256_fmadd_ps(c0, _mm256_permute_ps(p, 0x00), c3);
+			r = _mm256_fmadd_ps(c1, _mm256_permute_ps(p, 0x55), r);
+			r = _mm256_fmadd_ps(c2, _mm256_permute_ps(p, 0xaa), r);
+			storeXYZx2(r, out[i], out[i + 1]);
+		}
+		if (i < n)
+			sse::batchTransformPoints(1, m, in + i, out + i);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void avx2::batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out)
+	{
+		// Boxes are read and written as raw floats: min.xyz followed by max.xyz
+		static_assert(sizeof(AABB) == 6 * sizeof(float));
+		const __m256 c0 = _mm256_broadcast_ps(&m.m_cols[0]);
+		const __m256 c1 = _mm256_broadcast_ps(&m.m_cols[1]);
+		const __m256 c2 = _mm256_broadcast_ps(&m.m_cols[2]);
+		const __m256 c3 = _mm256_broadcast_ps(&m.m_cols[3]);
+		const __m128i mask = xyzMask();
+		size_t i = 0;
+		for (; i + 1 < n; i += 2)
+		{
+			const float* src0 = reinterpret_cast<const float*>(in + i);
+			const float* src1 = reinterpret_cast<const float*>(in + i + 1);
+			// lo = (min.x, min.y, min.z, max.x), hi = (min.z, max.x, max.y, max.z). Neither load leaves the box.
+			const __m256 lo = pack(_mm_loadu_ps(src0), _mm_loadu_ps(src1));
+			const __m256 hi = pack(_mm_loadu_ps(src0 + 2), _mm_loadu_ps(src1 + 2));
+			__m256 xa = _mm256_mul_ps(c0, _mm256_permute_ps(lo, 0x00));
+			__m256 xb = _mm256_mul_ps(c0, _mm256_permute_ps(hi, 0x55));
+			__m256 ya = _mm256_mul_ps(c1, _mm256_permute_ps(lo, 0x55));
+			__m256 yb = _mm256_mul_ps(c1, _mm256_permute_ps(hi, 0xaa));
+			__m256 za = _mm256_mul_ps(c2, _mm256_permute_ps(lo, 0xaa));
+			__m256 zb = _mm256_mul_ps(c2, _mm256_permute_ps(hi, 0xff));
+			__m256 rMin = _mm256_add_ps(_mm256_add_ps(_mm256_min_ps(xa, xb), _mm256_min_ps(ya, yb)), _mm256_add_ps(_mm256_min_ps(za, zb), c3));
+			__m256 rMax = _mm256_add_ps(_mm256_add_ps(_mm256_max_ps(xa, xb), _mm256_max_ps(ya, yb)), _mm256_add_ps(_mm256_max_ps(za, zb), c3));
+			// The fourth component of min spills into max.x, which the masked store overwrites right after
+			float* dst0 = reinterpret_cast<float*>(out + i);
+			float* dst1 = reinterpret_cast<float*>(out + i + 1);
+			_mm_storeu_ps(dst0, _mm256_castps256_ps128(rMin));
+			_mm_storeu_ps(dst1, _mm256_extractf128_ps(rMin, 1));
+			_mm_maskstore_ps(dst0 + 3, mask, _mm256_castps256_ps128(rMax));
+			_mm_maskstore_ps(dst1 + 3, mask, _mm256_extractf128_ps(rMax, 1));
+		}
+		if (i < n)
+			sse::batchTransformAABBs(1, m, in + i, out + i);
+	}
+}
@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "matrix.h"
+#include "vector.h"
+
+namespace rev::math
+{
+	struct AABB;
+
+	// Batched Mat44f kernels for hierarchy and instance updates.
+	// The default entry points dispatch at runtime to 8-wide AVX2 code, which processes two matrices per ymm register,
+	// or to a 4-wide SSE fallback. Both implementations are also exposed directly for testing and benchmarking.
+	// The AVX2 kernels use fused multiply-adds, and the SSE ones separate mul and add, so results may differ in the last bits
+	// depending on the dispatched path. Compare against them with a tolerance, not for exact equality.
+	// Unless noted otherwise, outputs may alias the inputs of the same index, but not other elements.
+
+	// out[i] = a[i] * b[i]
+	void batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out);
+	// out[i] = a * b[i]
+	void batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out);
+	// out[i] = a[aIndices[i]] * b[i]. Transform propagation, with a being the parents' world matrices.
+	// The referenced elements of a must not be written by the same call.
+	void batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out);
+	// out[i] = (m * Vec4f(in[i], 1)).xyz()
+	void batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out);
+	// out[i] = m * in[i]
+	void batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out);
+
+	namespace sse
+	{
+		void batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out);
+		void batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out);
+		void batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out);
+		void batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out);
+		void batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out);
+	}
+
+	// Only call these when cpuFeatures().hasAVX2FMA()
+	namespace avx2
+	{
+		void batchMultiply(size_t n, const Mat44f* a, const Mat44f* b, Mat44f* out);
+		void batchMultiply(size_t n, const Mat44f& a, const Mat44f* b, Mat44f* out);
+		void batchMultiply(size_t n, const Mat44f* a, const uint32_t* aIndices, const Mat44f* b, Mat44f* out);
+		void batchTransformPoints(size_t n, const Mat44f& m, const Vec3f* in, Vec3f* out);
+		void batchTransformAABBs(size_t n, const Mat44f& m, const AABB* in, AABB* out);
+	}
+}
@@ -0,0 +1,378 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// Structure of arrays packs of 8 floats, for data parallel math.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+#include "matrix.h"
+#include "vector.h"
+
+// 8-wide packs map to a single ymm register when the build targets AVX2, and to pairs of xmm registers otherwise.
+// Operations are written to give bit-identical results to the scalar Vector code: no FMA contractions, and
+// reductions happen in the same order as the scalar loops. That also requires the compiler not to contract the
+// scalar code, which is the default with MSVC's /fp:precise, but needs -ffp-contract=off on gcc and clang.
+// Defining REV_SIMD8_AVX2 to 0 forces the SSE fallback on AVX2 builds, so tests can cover both paths.
+#ifndef REV_SIMD8_AVX2
+#if defined(__AVX2__)
+#define REV_SIMD8_AVX2 1
+#else
+#define REV_SIMD8_AVX2 0
+#endif
+#endif
+
+// Pack types and their functions live in their own namespace so that overloads like sqrt or min, which take packs,
+// don't hide the scalar versions from unqualified calls inside rev::math. They are found through ADL instead.
+namespace rev::math::simd
+{
+	//------------------------------------------------------------------------------------------------------------------
+	// 8 float lanes. Comparisons return lane masks with all bits set in the lanes where the comparison is true.
+	struct float8
+	{
+		static constexpr size_t kWidth = 8;
+
+		float8() = default;
+		float8(float x) // Broadcast
+		{
+#if REV_SIMD8_AVX2
+			v = _mm256_set1_ps(x);
+#else
+			lo = hi = _mm_set1_ps(x);
+#endif
+		}
+
+#if REV_SIMD8_AVX2
+		explicit float8(__m256 x) : v(x) {}
+#else
+		float8(__m128 l, __m128 h) : lo(l), hi(h) {}
+#endif
+
+		static float8 zero() { return float8(0.f); }
+
+		static float8 load(const float* src)
+		{
+#if REV_SIMD8_AVX2
+			return float8(_mm256_loadu_ps(src));
+#else
+			return float8(_mm_loadu_ps(src), _mm_loadu_ps(src + 4));
+#endif
+		}
+
+		void store(float* dst) const
+		{
+#if REV_SIMD8_AVX2
+			_mm256_storeu_ps(dst, v);
+#else
+			_mm_storeu_ps(dst, lo);
+			_mm_storeu_ps(dst + 4, hi);
+#endif
+		}
+
+		// Read one float every strideBytes starting at src. Lanes at or beyond count are set to zero.
+		static float8 gather(const float* src, size_t strideBytes, size_t count = kWidth)
+		{
+#if REV_SIMD8_AVX2
+			if (count >= kWidth)
+			{
+				const int s = int(strideBytes);
+				const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+				return float8(_mm256_i32gather_ps(src, offsets, 1));
+			}
+#endif
+			alignas(32) float lanes[kWidth] = {};
+			auto bytes = reinterpret_cast<const uint8_t*>(src);
+			for (size_t i = 0; i < count && i < kWidth; ++i)
+				lanes[i] = *reinterpret_cast<const float*>(bytes + i * strideBytes);
+			return load(lanes);
+		}
+
+		// Write one float every strideBytes starting at dst. Only the first count lanes are written.
+		void scatter(float* dst, size_t strideBytes, size_t count = kWidth) const
+		{
+			alignas(32) float lanes[kWidth];
+			store(lanes);
+			auto bytes = reinterpret_cast<uint8_t*>(dst);
+			for (size_t i = 0; i < count && i < kWidth; ++i)
+				*reinterpret_cast<float*>(bytes + i * strideBytes) = lanes[i];
+		}
+
+		float operator[](size_t i) const
+		{
+			alignas(32) float lanes[kWidth];
+			store(lanes);
+			return lanes[i];
+		}
+
+		// One bit per lane, from the sign bit of each lane
+		int bits() const
+		{
+#if REV_SIMD8_AVX2
+			return _mm256_movemask_ps(v);
+#else
+			return _mm_movemask_ps(lo) | (_mm_movemask_ps(hi) << 4);
+#endif
+		}
+
+		bool any() const { return bits() != 0; }
+		bool all() const { return bits() == 0xff; }
+
+#if REV_SIMD8_AVX2
+		__m256 v;
+#else
+		__m128 lo;
+		__m128 hi;
+#endif
+	};
+
+	// Lane wise binary operators
+#if REV_SIMD8_AVX2
+#define REV_FLOAT8_BINARY_OP(name, avx, sse) \
+	inline float8 name(const float8& a, const float8& b) { return float8(avx(a.v, b.v)); }
+#define REV_FLOAT8_COMPARE(name, predicate, ssecmp) \
+	inline float8 name(const float8& a, const float8& b) { return float8(_mm256_cmp_ps(a.v, b.v, predicate)); }
+#else
+#define REV_FLOAT8_BINARY_OP(name, avx, sse) \
+	inline float8 name(const float8& a, const float8& b) { return float8(sse(a.lo, b.lo), sse(a.hi, b.hi)); }
+#define REV_FLOAT8_COMPARE(name, predicate, ssecmp) \
+	inline float8 name(const float8& a, const float8& b) { return float8(ssecmp(a.lo, b.lo), ssecmp(a.hi, b.hi)); }
+#endif
+
+	REV_FLOAT8_BINARY_OP(operator+, _mm256_add_ps, _mm_add_ps)
+	REV_FLOAT8_BINARY_OP(operator-, _mm256_sub_ps, _mm_sub_ps)
+	REV_FLOAT8_BINARY_OP(operator*, _mm256_mul_ps, _mm_mul_ps)
+	REV_FLOAT8_BINARY_OP(operator/, _mm256_div_ps, _mm_div_ps)
+	REV_FLOAT8_BINARY_OP(operator&, _mm256_and_ps, _mm_and_ps)
+	REV_FLOAT8_BINARY_OP(operator|, _mm256_or_ps, _mm_or_ps)
+	REV_FLOAT8_BINARY_OP(operator^, _mm256_xor_ps, _mm_xor_ps)
+	REV_FLOAT8_BINARY_OP(andNot, _mm256_andnot_ps, _mm_andnot_ps) // ~a & b
+	// Same NaN behavior as the scalar math::min/max: return the second operand when unordered
+	REV_FLOAT8_BINARY_OP(min, _mm256_min_ps, _mm_min_ps)
+	REV_FLOAT8_BINARY_OP(max, _mm256_max_ps, _mm_max_ps)
+
+	REV_FLOAT8_COMPARE(operator<, _CMP_LT_OQ, _mm_cmplt_ps)
+	REV_FLOAT8_COMPARE(operator<=, _CMP_LE_OQ, _mm_cmple_ps)
+	REV_FLOAT8_COMPARE(operator>, _CMP_GT_OQ, _mm_cmpgt_ps)
+	REV_FLOAT8_COMPARE(operator>=, _CMP_GE_OQ, _mm_cmpge_ps)
+	REV_FLOAT8_COMPARE(operator==, _CMP_EQ_OQ, _mm_cmpeq_ps)
+	REV_FLOAT8_COMPARE(operator!=, _CMP_NEQ_UQ, _mm_cmpneq_ps)
+
+#undef REV_FLOAT8_BINARY_OP
+#undef REV_FLOAT8_COMPARE
+
+	inline float8 operator-(const float8& a) { return a ^ float8(-0.f); }
+
+	inline float8& operator+=(float8& a, const float8& b) { return a = a + b; }
+	inline float8& operator-=(float8& a, const float8& b) { return a = a - b; }
+	inline float8& operator*=(float8& a, const float8& b) { return a = a * b; }
+
+	inline float8 sqrt(const float8& a)
+	{
+#if REV_SIMD8_AVX2
+		return float8(_mm256_sqrt_ps(a.v));
+#else
+		return float8(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi));
+#endif
+	}
+
+	inline float8 abs(const float8& a) { return andNot(float8(-0.f), a); }
+
+	// mask ? a : b, lane wise. Only the sign bit of each mask lane is used
+	inline float8 select(const float8& mask, const float8& a, const float8& b)
+	{
+#if REV_SIMD8_AVX2
+		return float8(_mm256_blendv_ps(b.v, a.v, mask.v));
+#else
+		return float8(_mm_blendv_ps(b.lo, a.lo, mask.lo), _mm_blendv_ps(b.hi, a.hi, mask.hi));
+#endif
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// 8 three dimensional vectors, one component per register
+	struct Vec3f8
+	{
+		Vec3f8() = default;
+		Vec3f8(const float8& _x, const float8& _y, const float8& _z) : x(_x), y(_y), z(_z) {}
+		Vec3f8(const Vec3f& v) : x(v.x()), y(v.y()), z(v.z()) {} // Broadcast
+
+		// Load from an array of structures, where each vector starts strideBytes after the previous one
+		static Vec3f8 load(const Vec3f* src, size_t count = float8::kWidth, size_t strideBytes = sizeof(Vec3f))
+		{
+			const float* base = src->data();
+			return Vec3f8(
+				float8::gather(base + 0, strideBytes, count),
+				float8::gather(base + 1, strideBytes, count),
+				float8::gather(base + 2, strideBytes, count));
+		}
+
+		void store(Vec3f* dst, size_t count = float8::kWidth, size_t strideBytes = sizeof(Vec3f)) const
+		{
+			float* base = dst->data();
+			x.scatter(base + 0, strideBytes, count);
+			y.scatter(base + 1, strideBytes, count);
+			z.scatter(base + 2, strideBytes, count);
+		}
+
+		Vec3f operator[](size_t i) const { return Vec3f(x[i], y[i], z[i]); }
+
+		float8 x, y, z;
+	};
+
+	inline Vec3f8 operator+(const Vec3f8& a, const Vec3f8& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline Vec3f8 operator-(const Vec3f8& a, const Vec3f8& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Vec3f8 operator*(const Vec3f8& a, const Vec3f8& b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+	inline Vec3f8 operator*(const Vec3f8& a, const float8& k) { return { a.x * k, a.y * k, a.z * k }; }
+	inline Vec3f8 operator*(const float8& k, const Vec3f8& a) { return { k * a.x, k * a.y, k * a.z }; }
+	inline Vec3f8 operator-(const Vec3f8& a) { return { -a.x, -a.y, -a.z }; }
+
+	inline float8 dot(const Vec3f8& a, const Vec3f8& b)
+	{
+		// Accumulate from zero, like the scalar dot product, so the sign of zero results matches
+		return float8::zero() + a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline Vec3f8 cross(const Vec3f8& a, const Vec3f8& b)
+	{
+		return {
+			a.y * b.z - a.z * b.y,
+			a.z * b.x - a.x * b.z,
+			a.x * b.y - a.y * b.x
+		};
+	}
+
+	inline float8 squaredNorm(const Vec3f8& a) { return dot(a, a); }
+	inline float8 norm(const Vec3f8& a) { return sqrt(squaredNorm(a)); }
+	inline Vec3f8 normalize(const Vec3f8& a) { return a * (float8(1.f) / norm(a)); }
+
+	inline Vec3f8 min(const Vec3f8& a, const Vec3f8& b) { return { min(a.x, b.x), min(a.y, b.y), min(a.z, b.z) }; }
+	inline Vec3f8 max(const Vec3f8& a, const Vec3f8& b) { return { max(a.x, b.x), max(a.y, b.y), max(a.z, b.z) }; }
+
+	inline Vec3f8 select(const float8& mask, const Vec3f8& a, const Vec3f8& b)
+	{
+		return { select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z) };
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// 8 four dimensional vectors, one component per register
+	struct Vec4f8
+	{
+		Vec4f8() = default;
+		Vec4f8(const float8& _x, const float8& _y, const float8& _z, const float8& _w) : x(_x), y(_y), z(_z), w(_w) {}
+		Vec4f8(const Vec3f8& v, const float8& _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
+		Vec4f8(const Vec4f& v) : x(v.x()), y(v.y()), z(v.z()), w(v.w()) {} // Broadcast
+
+		static Vec4f8 load(const Vec4f* src, size_t count = float8::kWidth, size_t strideBytes = sizeof(Vec4f))
+		{
+			const float* base = src->data();
+			return Vec4f8(
+				float8::gather(base + 0, strideBytes, count),
+				float8::gather(base + 1, strideBytes, count),
+				float8::gather(base + 2, strideBytes, count),
+				float8::gather(base + 3, strideBytes, count));
+		}
+
+		void store(Vec4f* dst, size_t count = float8::kWidth, size_t strideBytes = sizeof(Vec4f)) const
+		{
+			float* base = dst->data();
+			x.scatter(base + 0, strideBytes, count);
+			y.scatter(base + 1, strideBytes, count);
+			z.scatter(base + 2, strideBytes, count);
+			w.scatter(base + 3, strideBytes, count);
+		}
+
+		Vec4f operator[](size_t i) const { return Vec4f(x[i], y[i], z[i], w[i]); }
+		Vec3f8 xyz() const { return { x, y, z }; }
+
+		float8 x, y, z, w;
+	};
+
+	inline Vec4f8 operator+(const Vec4f8& a, const Vec4f8& b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+	inline Vec4f8 operator-(const Vec4f8& a, const Vec4f8& b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+	inline Vec4f8 operator*(const Vec4f8& a, const Vec4f8& b) { return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w }; }
+	inline Vec4f8 operator*(const Vec4f8& a, const float8& k) { return { a.x * k, a.y * k, a.z * k, a.w * k }; }
+	inline Vec4f8 operator*(const float8& k, const Vec4f8& a) { return { k * a.x, k * a.y, k * a.z, k * a.w }; }
+	inline Vec4f8 operator-(const Vec4f8& a) { return { -a.x, -a.y, -a.z, -a.w }; }
+
+	inline float8 dot(const Vec4f8& a, const Vec4f8& b)
+	{
+		return float8::zero() + a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	inline float8 squaredNorm(const Vec4f8& a) { return dot(a, a); }
+	inline float8 norm(const Vec4f8& a) { return sqrt(squaredNorm(a)); }
+	inline Vec4f8 normalize(const Vec4f8& a) { return a * (float8(1.f) / norm(a)); }
+
+	inline Vec4f8 min(const Vec4f8& a, const Vec4f8& b) { return { min(a.x, b.x), min(a.y, b.y), min(a.z, b.z), min(a.w, b.w) }; }
+	inline Vec4f8 max(const Vec4f8& a, const Vec4f8& b) { return { max(a.x, b.x), max(a.y, b.y), max(a.z, b.z), max(a.w, b.w) }; }
+
+	inline Vec4f8 select(const float8& mask, const Vec4f8& a, const Vec4f8& b)
+	{
+		return { select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w) };
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// A single Mat44f broadcast to all lanes, to transform 8 vectors at once
+	struct Mat44f8
+	{
+		Mat44f8() = default;
+		Mat44f8(const Mat44f& m)
+		{
+			for (size_t j = 0; j < 4; ++j)
+				for (size_t i = 0; i < 4; ++i)
+					cols[j][i] = float8(m(i, j));
+		}
+
+		float8 operator()(size_t i, size_t j) const { return cols[j][i]; }
+
+		// Same summation order as the scalar matrix vector product
+		Vec4f8 operator*(const Vec4f8& v) const
+		{
+			return {
+				row(0, v.x, v.y, v.z, v.w),
+				row(1, v.x, v.y, v.z, v.w),
+				row(2, v.x, v.y, v.z, v.w),
+				row(3, v.x, v.y, v.z, v.w)
+			};
+		}
+
+		// (m * Vec4f(p, 1)).xyz()
+		Vec3f8 transformPosition(const Vec3f8& p) const
+		{
+			const float8 one(1.f);
+			return { row(0, p.x, p.y, p.z, one), row(1, p.x, p.y, p.z, one), row(2, p.x, p.y, p.z, one) };
+		}
+
+		// (m * Vec4f(d, 0)).xyz()
+		Vec3f8 transformDirection(const Vec3f8& d) const
+		{
+			const float8 zero = float8::zero();
+			return { row(0, d.x, d.y, d.z, zero), row(1, d.x, d.y, d.z, zero), row(2, d.x, d.y, d.z, zero) };
+		}
+
+		float8 cols[4][4];
+
+	private:
+		float8 row(size_t i, const float8& x, const float8& y, const float8& z, const float8& w) const
+		{
+			return cols[0][i] * x + cols[1][i] * y + cols[2][i] * z + cols[3][i] * w;
+		}
+	};
+}
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "cpuFeatures.h"
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace rev::math
+{
+	namespace
+	{
+		void cpuid(int leaf, int subLeaf, uint32_t regs[4])
+		{
+#ifdef _MSC_VER
+			__cpuidex(reinterpret_cast<int*>(regs), leaf, subLeaf);
+#else
+			__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		}
+
+		uint64_t xgetbv0()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32_t eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (uint64_t(edx) << 32) | eax;
+#endif
+		}
+
+		CpuFeatures detectFeatures()
+		{
+			CpuFeatures features;
+			uint32_t regs[4]; // eax, ebx, ecx, edx
+			cpuid(0, 0, regs);
+			const uint32_t maxLeaf = regs[0];
+			if (maxLeaf < 1)
+				return features;
+
+			cpuid(1, 0, regs);
+			features.sse41 = regs[2] & (1u << 19);
+			const bool osxsave = regs[2] & (1u << 27);
+			const bool cpuAvx = regs[2] & (1u << 28);
+			const bool cpuFma = regs[2] & (1u << 12);
+
+			// The OS must save ymm registers on context switches for AVX to be usable
+			const bool osAvx = osxsave && (xgetbv0() & 0x6) == 0x6;
+			features.avx = cpuAvx && osAvx;
+			features.fma = cpuFma && features.avx;
+
+			if (maxLeaf >= 7)
+			{
+				cpuid(7, 0, regs);
+				features.avx2 = features.avx && (regs[1] & (1u << 5));
+			}
+			return features;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	const CpuFeatures& cpuFeatures()
+	{
+		static const CpuFeatures features = detectFeatures();
+		return features;
+	}
+}
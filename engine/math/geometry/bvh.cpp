@@ -0,0 +1,394 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <numeric>
+#include <core/tasks/threadPool.h>
+
+namespace rev::math
+{
+	//------------------------------------------------------------------------------------------------------------------
+	// Recursive builder. Subtrees are built into a temporary linked tree so they can be built in parallel,
+	// then flattened depth first.
+	struct BVH::Builder
+	{
+		struct BuildNode
+		{
+			AABB bounds;
+			uint32_t begin = 0;
+			uint32_t end = 0;
+			uint32_t depth = 0;
+			std::unique_ptr<BuildNode> children[2];
+		};
+
+		// Subtrees with fewer primitives than this are built in the calling thread
+		static constexpr uint32_t kMinParallelPrimitives = 4096;
+
+		const BuildOptions& options;
+		std::span<const AABB> boxes;
+		std::vector<Vec3f> centroids;
+		std::vector<uint32_t>& indices;
+		std::atomic<uint32_t> numNodes = 0;
+		std::atomic<uint32_t> maxDepth = 0;
+
+		Builder(const BuildOptions& _options, std::span<const AABB> _boxes, std::vector<uint32_t>& _indices)
+			: options(_options)
+			, boxes(_boxes)
+			, indices(_indices)
+		{
+			centroids.resize(boxes.size());
+			for (size_t i = 0; i < boxes.size(); ++i)
+				centroids[i] = boxes[i].center();
+		}
+
+		struct Split
+		{
+			int axis = -1;
+			uint32_t bin = 0; // Primitives in bins <= bin go to the left child
+			float cost = std::numeric_limits<float>::infinity();
+		};
+
+		uint32_t binIndex(const Vec3f& centroid, int axis, const AABB& centroidBounds, float scale) const
+		{
+			auto bin = uint32_t((centroid[axis] - centroidBounds.min()[axis]) * scale);
+			return std::min(bin, options.numBins - 1);
+		}
+
+		// Bounds accumulated on plain floats. Binning is most of the build time, and this keeps the inner loops
+		// simple enough for the compiler to vectorize
+		struct Bin
+		{
+			float min[3] = { kInf, kInf, kInf };
+			float max[3] = { -kInf, -kInf, -kInf };
+			uint32_t count = 0;
+
+			static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+			void add(const AABB& box)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					min[k] = std::min(min[k], box.min()[k]);
+					max[k] = std::max(max[k], box.max()[k]);
+				}
+			}
+
+			void add(const Vec3f& point)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					min[k] = std::min(min[k], point[k]);
+					max[k] = std::max(max[k], point[k]);
+				}
+			}
+
+			void add(const Bin& other)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					min[k] = std::min(min[k], other.min[k]);
+					max[k] = std::max(max[k], other.max[k]);
+				}
+				count += other.count;
+			}
+
+			float area() const
+			{
+				float x = max[0] - min[0];
+				float y = max[1] - min[1];
+				float z = max[2] - min[2];
+				return 2.f * (x * y + x * z + y * z);
+			}
+
+			AABB aabb() const { return AABB(Vec3f(min[0], min[1], min[2]), Vec3f(max[0], max[1], max[2])); }
+		};
+
+		Split findSplit(uint32_t begin, uint32_t end, const AABB& bounds, const AABB& centroidBounds) const
+		{
+			// Bin all three axes in a single pass over the primitives
+			std::vector<Bin> bins[3];
+			float scale[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float extent = centroidBounds.max()[axis] - centroidBounds.min()[axis];
+				scale[axis] = extent > 0.f ? options.numBins / extent : 0.f;
+				bins[axis].resize(extent > 0.f ? options.numBins : 0);
+			}
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				auto prim = indices[i];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (bins[axis].empty())
+						continue;
+					auto& bin = bins[axis][binIndex(centroids[prim], axis, centroidBounds, scale[axis])];
+					bin.add(boxes[prim]);
+					++bin.count;
+				}
+			}
+
+			Split best;
+			std::vector<float> rightCost(options.numBins);
+			const float invParentArea = 1.f / std::max(bounds.area(), std::numeric_limits<float>::min());
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (bins[axis].empty())
+					continue; // All centroids lie on the same plane
+
+				// Sweep from the right to get the cost of every right partition
+				Bin right;
+				for (uint32_t b = options.numBins - 1; b > 0; --b)
+				{
+					right.add(bins[axis][b]);
+					rightCost[b - 1] = right.count ? right.area() * right.count : 0.f;
+				}
+
+				// Then from the left, combining both sides
+				Bin left;
+				for (uint32_t b = 0; b + 1 < options.numBins; ++b)
+				{
+					left.add(bins[axis][b]);
+					if (left.count == 0 || left.count == end - begin)
+						continue;
+					// Unit traversal and intersection costs, relative to the parent's area
+					float cost = 1.f + (left.area() * left.count + rightCost[b]) * invParentArea;
+					if (cost < best.cost)
+					{
+						best.axis = axis;
+						best.bin = b;
+						best.cost = cost;
+					}
+				}
+			}
+			return best;
+		}
+
+		void build(BuildNode& node, core::ThreadPool* pool)
+		{
+			numNodes.fetch_add(1, std::memory_order_relaxed);
+			uint32_t depth = maxDepth.load(std::memory_order_relaxed);
+			while (node.depth > depth && !maxDepth.compare_exchange_weak(depth, node.depth, std::memory_order_relaxed))
+			{}
+
+			Bin primBounds, centerBounds;
+			for (uint32_t i = node.begin; i < node.end; ++i)
+			{
+				primBounds.add(boxes[indices[i]]);
+				centerBounds.add(centroids[indices[i]]);
+			}
+			node.bounds = primBounds.aabb();
+			const AABB centroidBounds = centerBounds.aabb();
+
+			const uint32_t count = node.end - node.begin;
+			if (count <= 1 || node.depth + 1 >= kMaxDepth)
+				return; // Leaf
+
+			Split split = findSplit(node.begin, node.end, node.bounds, centroidBounds);
+			const float leafCost = float(count);
+			if (count <= options.maxLeafSize && split.cost >= leafCost)
+				return; // Not worth splitting
+
+			uint32_t middle;
+			if (split.axis >= 0)
+			{
+				const int axis = split.axis;
+				const float scale = options.numBins / (centroidBounds.max()[axis] - centroidBounds.min()[axis]);
+				auto middleIt = std::partition(indices.begin() + node.begin, indices.begin() + node.end, [&](uint32_t prim) {
+					return binIndex(centroids[prim], axis, centroidBounds, scale) <= split.bin;
+				});
+				middle = uint32_t(middleIt - indices.begin());
+			}
+			else // All centroids overlap. Split the range in half so leaves stay small
+			{
+				middle = node.begin + count / 2;
+			}
+
+			for (int i = 0; i < 2; ++i)
+			{
+				node.children[i] = std::make_unique<BuildNode>();
+				node.children[i]->depth = node.depth + 1;
+			}
+			node.children[0]->begin = node.begin;
+			node.children[0]->end = middle;
+			node.children[1]->begin = middle;
+			node.children[1]->end = node.end;
+
+			if (pool && count >= kMinParallelPrimitives)
+			{
+				auto left = pool->submit([this, &node, pool]() { build(*node.children[0], pool); });
+				build(*node.children[1], pool);
+				pool->wait(left);
+			}
+			else
+			{
+				build(*node.children[0], nullptr);
+				build(*node.children[1], nullptr);
+			}
+		}
+
+		void flatten(const BuildNode& node, std::vector<Node>& nodes) const
+		{
+			const auto index = uint32_t(nodes.size());
+			nodes.push_back({ node.bounds, node.begin, node.end - node.begin });
+			if (node.children[0])
+			{
+				nodes[index].count = 0;
+				flatten(*node.children[0], nodes);
+				nodes[index].offset = uint32_t(nodes.size());
+				flatten(*node.children[1], nodes);
+			}
+		}
+	};
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::build(std::span<const AABB> primitiveBounds, const BuildOptions& options)
+	{
+		assert(options.numBins >= 2);
+		clear();
+		if (primitiveBounds.empty())
+			return;
+
+		m_primitiveIndices.resize(primitiveBounds.size());
+		std::iota(m_primitiveIndices.begin(), m_primitiveIndices.end(), 0);
+
+		Builder builder(options, primitiveBounds, m_primitiveIndices);
+		Builder::BuildNode root;
+		root.end = uint32_t(primitiveBounds.size());
+		builder.build(root, options.pool);
+
+		m_nodes.reserve(builder.numNodes);
+		builder.flatten(root, m_nodes);
+		m_depth = builder.maxDepth + 1;
+
+		m_slotBounds.resize(m_primitiveIndices.size());
+		for (size_t slot = 0; slot < m_primitiveIndices.size(); ++slot)
+			m_slotBounds[slot] = primitiveBounds[m_primitiveIndices[slot]];
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void BVH::clear()
+	{
+		m_nodes.clear();
+		m_primitiveIndices.clear();
+		m_slotBounds.clear();
+		m_depth = 0;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool BVH::closestHit(const Ray& ray, float tMax, Hit& hit) const
+	{
+		const auto implicitRay = ray.implicit();
+		uint32_t closestSlot = 0;
+		float closestT = tMax;
+		bool found = traverse(implicitRay, tMax, false, [&](uint32_t slot, float& tClosest) {
+			float tEnter;
+			if (m_slotBounds[slot].intersect(implicitRay, tClosest, tEnter) && tEnter < tClosest)
+			{
+				tClosest = closestT = tEnter;
+				closestSlot = slot;
+				return true;
+			}
+			return false;
+		});
+		if (found)
+		{
+			hit.primitive = m_primitiveIndices[closestSlot];
+			hit.t = closestT;
+		}
+		return found;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool BVH::anyHit(const Ray& ray, float tMax) const
+	{
+		const auto implicitRay = ray.implicit();
+		return traverse(implicitRay, tMax, true, [&](uint32_t slot, float& tClosest) {
+			float tEnter;
+			return m_slotBounds[slot].intersect(implicitRay, tClosest, tEnter);
+		});
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void TriangleBVH::build(std::span<const Vec3f> positions, std::span<const uint32_t> indices, const BVH::BuildOptions& options)
+	{
+		assert(indices.size() % 3 == 0);
+		const size_t numTriangles = indices.size() / 3;
+		std::vector<AABB> bounds(numTriangles);
+		for (size_t i = 0; i < numTriangles; ++i)
+		{
+			bounds[i].add(positions[indices[3 * i + 0]]);
+			bounds[i].add(positions[indices[3 * i + 1]]);
+			bounds[i].add(positions[indices[3 * i + 2]]);
+		}
+		m_bvh.build(bounds, options);
+
+		m_triangles.resize(numTriangles);
+		for (uint32_t slot = 0; slot < numTriangles; ++slot)
+		{
+			auto t = m_bvh.primitiveIndex(slot);
+			const Vec3f& v0 = positions[indices[3 * t + 0]];
+			m_triangles[slot] = {
+				v0,
+				positions[indices[3 * t + 1]] - v0,
+				positions[indices[3 * t + 2]] - v0
+			};
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool TriangleBVH::closestHit(const Ray& ray, float tMax, Hit& hit) const
+	{
+		Hit closest;
+		uint32_t closestSlot = 0;
+		bool found = m_bvh.traverse(ray.implicit(), tMax, false, [&](uint32_t slot, float& tClosest) {
+			auto& tri = m_triangles[slot];
+			float t, u, v;
+			if (intersectTriangle(ray.origin(), ray.direction(), tri.v0, tri.e1, tri.e2, t, u, v) && t >= 0.f && t < tClosest)
+			{
+				tClosest = closest.t = t;
+				closest.u = u;
+				closest.v = v;
+				closestSlot = slot;
+				return true;
+			}
+			return false;
+		});
+		if (found)
+		{
+			hit = closest;
+			hit.primitive = m_bvh.primitiveIndex(closestSlot);
+		}
+		return found;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool TriangleBVH::anyHit(const Ray& ray, float tMax) const
+	{
+		return m_bvh.traverse(ray.implicit(), tMax, true, [&](uint32_t slot, float& tClosest) {
+			auto& tri = m_triangles[slot];
+			float t, u, v;
+			return intersectTriangle(ray.origin(), ray.direction(), tri.v0, tri.e1, tri.e2, t, u, v) && t >= 0.f && t <= tClosest;
+		});
+	}
+}
@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "ray.h"
+
+namespace rev::core {
+	class ThreadPool;
+}
+
+namespace rev::math
+{
+	// Bounding volume hierarchy over axis aligned boxes, built with binned SAH (Wald 2007).
+	// Nodes are stored depth first in a flat array: the left child of an interior node always follows its parent,
+	// so only the right child's index is stored, and every node fits in 32 bytes.
+	// Primitives are referenced through slots: leaves cover contiguous ranges of slots, and primitiveIndex(slot)
+	// maps them back to the index of the box passed to build().
+	class BVH
+	{
+	public:
+		struct alignas(32) Node
+		{
+			AABB bounds;
+			uint32_t offset; // First primitive slot for leaves, right child for interior nodes
+			uint32_t count; // Number of primitives. 0 for interior nodes
+
+			bool isLeaf() const { return count > 0; }
+		};
+
+		struct BuildOptions
+		{
+			uint32_t maxLeafSize = 4;
+			uint32_t numBins = 16;
+			core::ThreadPool* pool = nullptr; // When set, large subtrees are built in parallel
+		};
+
+		struct Hit
+		{
+			uint32_t primitive = uint32_t(-1); // Index of the box or triangle that was hit
+			float t = std::numeric_limits<float>::infinity();
+			float u = 0.f; // Barycentrics, only for triangle hits
+			float v = 0.f;
+		};
+
+		static constexpr uint32_t kMaxDepth = 64;
+
+		void build(std::span<const AABB> primitiveBounds, const BuildOptions& options);
+		void build(std::span<const AABB> primitiveBounds) { build(primitiveBounds, BuildOptions()); }
+		void clear();
+
+		bool empty() const { return m_nodes.empty(); }
+		const std::vector<Node>& nodes() const { return m_nodes; }
+		size_t numPrimitives() const { return m_primitiveIndices.size(); }
+		uint32_t primitiveIndex(uint32_t slot) const { return m_primitiveIndices[slot]; }
+		uint32_t depth() const { return m_depth; }
+		const AABB& bounds() const { return m_nodes.front().bounds; }
+
+		// Closest box the ray enters within [0, tMax]. Rays starting inside a box hit it at t = 0
+		bool closestHit(const Ray& ray, float tMax, Hit& hit) const;
+		bool anyHit(const Ray& ray, float tMax) const;
+
+		// Generic traversal. primitiveTest(slot, tMax) must return true when it finds a hit closer than tMax,
+		// and shrink tMax to the hit's distance. Nodes are visited front to back.
+		// With anyHit set, traversal stops at the first hit. Returns whether any primitive was hit.
+		template<class PrimitiveTest>
+		bool traverse(const Ray::Implicit& ray, float tMax, bool anyHit, PrimitiveTest&& primitiveTest) const;
+
+	private:
+		struct Builder;
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_primitiveIndices;
+		std::vector<AABB> m_slotBounds; // Primitive bounds in slot order, for box queries
+		uint32_t m_depth = 0;
+	};
+
+	// BVH over an indexed triangle mesh.
+	// Triangle vertices are copied in leaf order, so leaves read contiguous memory.
+	class TriangleBVH
+	{
+	public:
+		using Hit = BVH::Hit;
+
+		void build(std::span<const Vec3f> positions, std::span<const uint32_t> indices, const BVH::BuildOptions& options);
+		void build(std::span<const Vec3f> positions, std::span<const uint32_t> indices) { build(positions, indices, BVH::BuildOptions()); }
+
+		const BVH& bvh() const { return m_bvh; }
+		size_t numTriangles() const { return m_bvh.numPrimitives(); }
+
+		// Closest triangle hit in [0, tMax]. hit.primitive is the triangle index in the original index buffer.
+		bool closestHit(const Ray& ray, float tMax, Hit& hit) const;
+		// Any triangle hit in [0, tMax]. Cheaper than closestHit, for occlusion and line of sight tests
+		bool anyHit(const Ray& ray, float tMax) const;
+
+	private:
+		struct Triangle
+		{
+			Vec3f v0;
+			Vec3f e1; // v1 - v0
+			Vec3f e2; // v2 - v0
+		};
+
+		BVH m_bvh;
+		std::vector<Triangle> m_triangles; // In slot order
+	};
+
+	// Möller-Trumbore ray/triangle intersection.
+	// Returns true when the ray's line crosses the triangle. t can still be negative or beyond the query range.
+	inline bool intersectTriangle(
+		const Vec3f& origin, const Vec3f& direction,
+		const Vec3f& v0, const Vec3f& e1, const Vec3f& e2,
+		float& t, float& u, float& v)
+	{
+		constexpr float kEpsilon = 1e-8f;
+		Vec3f p = cross(direction, e2);
+		float det = dot(e1, p);
+		if (std::abs(det) < kEpsilon) // Parallel to the triangle
+			return false;
+		float invDet = 1.f / det;
+		Vec3f s = origin - v0;
+		u = dot(s, p) * invDet;
+		if (u < 0.f || u > 1.f)
+			return false;
+		Vec3f q = cross(s, e1);
+		v = dot(direction, q) * invDet;
+		if (v < 0.f || u + v > 1.f)
+			return false;
+		t = dot(e2, q) * invDet;
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// Inline implementation
+	//------------------------------------------------------------------------------------------------------------------
+	template<class PrimitiveTest>
+	bool BVH::traverse(const Ray::Implicit& ray, float tMax, bool anyHit, PrimitiveTest&& primitiveTest) const
+	{
+		if (m_nodes.empty())
+			return false;
+
+		float tEnter;
+		if (!m_nodes[0].bounds.intersect(ray, tMax, tEnter))
+			return false;
+
+		// Pending far children, with the distance at which the ray enters them
+		std::pair<uint32_t, float> stack[kMaxDepth];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+		bool hitAny = false;
+
+		for (;;)
+		{
+			const Node& node = m_nodes[nodeIndex];
+			if (node.isLeaf())
+			{
+				for (uint32_t slot = node.offset; slot < node.offset + node.count; ++slot)
+				{
+					if (primitiveTest(slot, tMax))
+					{
+						hitAny = true;
+						if (anyHit)
+							return true;
+					}
+				}
+			}
+			else
+			{
+				uint32_t near = nodeIndex + 1;
+				uint32_t far = node.offset;
+				float tNear, tFar;
+				bool hitNear = m_nodes[near].bounds.intersect(ray, tMax, tNear);
+				bool hitFar = m_nodes[far].bounds.intersect(ray, tMax, tFar);
+				if (hitNear && hitFar)
+				{
+					if (tFar < tNear)
+					{
+						std::swap(near, far);
+						std::swap(tNear, tFar);
+					}
+					stack[stackSize++] = { far, tFar };
+					nodeIndex = near;
+					continue;
+				}
+				if (hitNear || hitFar)
+				{
+					nodeIndex = hitNear ? near : far;
+					continue;
+				}
+			}
+
+			// Pop the next node that can still hold a closer hit
+			for (;;)
+			{
+				if (stackSize == 0)
+					return hitAny;
+				auto [next, tNext] = stack[--stackSize];
+				if (tNext <= tMax)
+				{
+					nodeIndex = next;
+					break;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,248 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "frustumCulling.h"
+
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <core/tasks/parallelFor.h>
+#include <math/algebra/simd8.h>
+
+using namespace rev::math::simd;
+
+namespace rev::math
+{
+	//------------------------------------------------------------------------------------------------------------------
+	void AABBSoA::clear()
+	{
+		m_size = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			m_min[i].clear();
+			m_max[i].clear();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void AABBSoA::reserve(size_t n)
+	{
+		const size_t padded = (n + 7) & ~size_t(7);
+		for (int i = 0; i < 3; ++i)
+		{
+			m_min[i].reserve(padded);
+			m_max[i].reserve(padded);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void AABBSoA::assign(std::span<const AABB> boxes)
+	{
+		clear();
+		reserve(boxes.size());
+		for (auto& box : boxes)
+			push_back(box);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void AABBSoA::push_back(const AABB& box)
+	{
+		if (m_size % 8 == 0) // Grow by a whole pack of empty boxes
+		{
+			const size_t padded = m_size + 8;
+			for (int i = 0; i < 3; ++i)
+			{
+				m_min[i].resize(padded, std::numeric_limits<float>::infinity());
+				m_max[i].resize(padded, -std::numeric_limits<float>::infinity());
+			}
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			m_min[i][m_size] = box.min()[i];
+			m_max[i][m_size] = box.max()[i];
+		}
+		++m_size;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void AABBSoA::set(size_t i, const AABB& box)
+	{
+		assert(i < m_size);
+		for (int j = 0; j < 3; ++j)
+		{
+			m_min[j][i] = box.min()[j];
+			m_max[j][i] = box.max()[j];
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	AABB AABBSoA::operator[](size_t i) const
+	{
+		return AABB(
+			Vec3f(m_min[0][i], m_min[1][i], m_min[2][i]),
+			Vec3f(m_max[0][i], m_max[1][i], m_max[2][i]));
+	}
+
+	namespace
+	{
+		// Frustum planes and bounding box, broadcast to 8 lanes
+		struct CullVolume
+		{
+			CullVolume(const Frustum& frustum)
+			{
+				for (size_t i = 0; i < 6; ++i)
+				{
+					normals[i] = Vec3f8(frustum.plane(i).normal);
+					offsets[i] = float8(frustum.plane(i).t);
+				}
+				AABB bbox = frustum.boundingBox();
+				boundsMin = Vec3f8(bbox.min());
+				boundsMax = Vec3f8(bbox.max());
+			}
+
+			Vec3f8 normals[6];
+			float8 offsets[6];
+			Vec3f8 boundsMin;
+			Vec3f8 boundsMax;
+		};
+
+		// Lanes where the boxes are fully outside the plane.
+		// Same operations and order as the scalar test, so both agree bit for bit.
+		__forceinline float8 outsidePlane(const CullVolume& volume, size_t plane, const Vec3f8& boxMin, const Vec3f8& boxMax)
+		{
+			const Vec3f8& n = volume.normals[plane];
+			Vec3f8 vMin = min(boxMin * n, boxMax * n);
+			float8 tMin = vMin.x + vMin.y + vMin.z;
+			return tMin > volume.offsets[plane];
+		}
+
+		// Cull one pack of boxes. Returns the bitmask of potentially visible lanes.
+		__forceinline int cullPack(const CullVolume& volume, const Vec3f8& boxMin, const Vec3f8& boxMax, size_t& lastRejectingPlane)
+		{
+			float8 outside = outsidePlane(volume, lastRejectingPlane, boxMin, boxMax);
+			if (outside.all())
+				return 0;
+			for (size_t plane = 0; plane < 6; ++plane)
+			{
+				if (plane == lastRejectingPlane)
+					continue;
+				outside = outside | outsidePlane(volume, plane, boxMin, boxMax);
+				if (outside.all())
+				{
+					lastRejectingPlane = plane;
+					return 0;
+				}
+			}
+			// Overlap with the frustum's bounding box
+			outside = outside
+				| (boxMax.x < volume.boundsMin.x) | (volume.boundsMax.x < boxMin.x)
+				| (boxMax.y < volume.boundsMin.y) | (volume.boundsMax.y < boxMin.y)
+				| (boxMax.z < volume.boundsMin.z) | (volume.boundsMax.z < boxMin.z);
+			return ~outside.bits() & 0xff;
+		}
+
+		__forceinline void appendVisible(int visibleMask, size_t base, std::vector<uint32_t>& out)
+		{
+			while (visibleMask)
+			{
+				int lane = std::countr_zero(unsigned(visibleMask));
+				out.push_back(uint32_t(base + lane));
+				visibleMask &= visibleMask - 1;
+			}
+		}
+
+		void cullRange(const CullVolume& volume, std::span<const AABB> boxes, size_t begin, size_t end, std::vector<uint32_t>& out)
+		{
+			constexpr size_t stride = sizeof(AABB);
+			size_t lastRejectingPlane = 0;
+			for (size_t i = begin; i < end; i += 8)
+			{
+				const size_t count = std::min<size_t>(8, end - i);
+				const float* base = boxes[i].min().data();
+				Vec3f8 boxMin(
+					float8::gather(base + 0, stride, count),
+					float8::gather(base + 1, stride, count),
+					float8::gather(base + 2, stride, count));
+				const float* maxBase = boxes[i].max().data();
+				Vec3f8 boxMax(
+					float8::gather(maxBase + 0, stride, count),
+					float8::gather(maxBase + 1, stride, count),
+					float8::gather(maxBase + 2, stride, count));
+				int validLanes = (1 << count) - 1;
+				appendVisible(cullPack(volume, boxMin, boxMax, lastRejectingPlane) & validLanes, i, out);
+			}
+		}
+
+		void cullRange(const CullVolume& volume, const AABBSoA& boxes, size_t begin, size_t end, std::vector<uint32_t>& out)
+		{
+			size_t lastRejectingPlane = 0;
+			for (size_t i = begin; i < end; i += 8)
+			{
+				Vec3f8 boxMin(float8::load(boxes.minX() + i), float8::load(boxes.minY() + i), float8::load(boxes.minZ() + i));
+				Vec3f8 boxMax(float8::load(boxes.maxX() + i), float8::load(boxes.maxY() + i), float8::load(boxes.maxZ() + i));
+				const size_t count = std::min<size_t>(8, end - i);
+				int validLanes = (1 << count) - 1;
+				appendVisible(cullPack(volume, boxMin, boxMax, lastRejectingPlane) & validLanes, i, out);
+			}
+		}
+
+		// Boxes per job when culling in parallel. Multiple of the pack size
+		constexpr size_t kParallelChunkSize = 16 * 1024;
+
+		template<class Boxes>
+		void cull(const Frustum& frustum, const Boxes& boxes, size_t numBoxes, std::vector<uint32_t>& out, core::ThreadPool* pool)
+		{
+			out.clear();
+			const CullVolume volume(frustum);
+			if (!pool || numBoxes <= kParallelChunkSize)
+			{
+				cullRange(volume, boxes, 0, numBoxes, out);
+				return;
+			}
+
+			// Each chunk compacts into its own list, then lists are concatenated in order
+			const size_t numChunks = (numBoxes + kParallelChunkSize - 1) / kParallelChunkSize;
+			std::vector<std::vector<uint32_t>> chunkResults(numChunks);
+			core::parallelFor(*pool, 0, numChunks, 1, [&](size_t chunk) {
+				const size_t begin = chunk * kParallelChunkSize;
+				const size_t end = std::min(numBoxes, begin + kParallelChunkSize);
+				cullRange(volume, boxes, begin, end, chunkResults[chunk]);
+			});
+
+			size_t numVisible = 0;
+			for (auto& chunk : chunkResults)
+				numVisible += chunk.size();
+			out.reserve(numVisible);
+			for (auto& chunk : chunkResults)
+				out.insert(out.end(), chunk.begin(), chunk.end());
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void cullAABBs(const Frustum& frustum, std::span<const AABB> boxes, std::vector<uint32_t>& outVisibleIndices, core::ThreadPool* pool)
+	{
+		cull(frustum, boxes, boxes.size(), outVisibleIndices, pool);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void cullAABBs(const Frustum& frustum, const AABBSoA& boxes, std::vector<uint32_t>& outVisibleIndices, core::ThreadPool* pool)
+	{
+		cull(frustum, boxes, boxes.size(), outVisibleIndices, pool);
+	}
+}
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aabb.h"
+#include "types.h"
+
+namespace rev::core {
+	class ThreadPool;
+}
+
+namespace rev::math
+{
+	// Axis aligned boxes in structure of arrays layout, ready for 8-wide tests.
+	// Storage is padded to a multiple of 8 boxes with empty boxes, so packs can always be loaded in full.
+	class AABBSoA
+	{
+	public:
+		AABBSoA() = default;
+		AABBSoA(std::span<const AABB> boxes) { assign(boxes); }
+
+		void clear();
+		void reserve(size_t n);
+		void assign(std::span<const AABB> boxes);
+		void push_back(const AABB& box);
+		void set(size_t i, const AABB& box);
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		AABB operator[](size_t i) const;
+
+		// Component arrays. Each holds size() rounded up to a multiple of 8 elements
+		const float* minX() const { return m_min[0].data(); }
+		const float* minY() const { return m_min[1].data(); }
+		const float* minZ() const { return m_min[2].data(); }
+		const float* maxX() const { return m_max[0].data(); }
+		const float* maxY() const { return m_max[1].data(); }
+		const float* maxZ() const { return m_max[2].data(); }
+
+	private:
+		size_t m_size = 0;
+		std::vector<float> m_min[3];
+		std::vector<float> m_max[3];
+	};
+
+	// Batch version of intersect(const Frustum&, const AABB&), with the same results.
+	// outVisibleIndices is overwritten with the indices of the boxes that may be visible, in increasing order.
+	// Boxes are tested 8 at a time against planes pre-swizzled into packs. Each batch starts with the plane that
+	// rejected the previous one, which with spatially coherent input usually discards the whole batch in one test.
+	// When a pool is given, the boxes are split in chunks across its workers.
+	void cullAABBs(
+		const Frustum& frustum,
+		std::span<const AABB> boxes,
+		std::vector<uint32_t>& outVisibleIndices,
+		core::ThreadPool* pool = nullptr);
+
+	void cullAABBs(
+		const Frustum& frustum,
+		const AABBSoA& boxes,
+		std::vector<uint32_t>& outVisibleIndices,
+		core::ThreadPool* pool = nullptr);
+}
@@ -7,32 +7,332 @@
 #ifndef _REV_MATH_GEOMETRY_KDTREE_H_
 #define _REV_MATH_GEOMETRY_KDTREE_H_
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <core/tasks/threadPool.h>
 #include <math/algebra/vector.h>
-#include <core/types/typeTraits.h>
 
 namespace rev {
 	namespace math {
 
 		// --- Notes ---
-		// - Voxel size (maximun) is given at run-time in the dataset. This defines the max
-		// level of recursion in the tree
-		// - All nodes have either 0 or 2^k children
-
+		// - Static kd-tree over points in dim_ dimensions. grid_ selects integer coordinates, for voxel grids,
+		// instead of floats. Squared distances are computed in 64 bits in that case, which can't overflow as long as
+		// coordinates differ by less than 2^30.
+		// - The tree is implicit: points are reordered so that the median of every range [begin, end) sits at
+		// (begin + end) / 2, with the lower half to its left and the upper half to its right. That point is the node,
+		// and the only extra per node data is its split axis, so queries touch two flat arrays and nothing else.
+		// - Medians are found with median of medians selection, so builds are O(n log n) even for adversarial input
+		// like points sorted along an axis, or many duplicates. Large subtrees can be built in parallel.
 		template<unsigned dim_,bool grid_>
 		class Kdtree {
 		public:
-			typedef Select<int,float,grid_>	Coordinate;
-			typedef Vector<Coordinate,dim_>	Vector;
+			using Coordinate = std::conditional_t<grid_, int32_t, float>;
+			using Distance = std::conditional_t<grid_, int64_t, float>; // Squared distances
+			using Point = Vector<Coordinate, dim_>;
+
+			struct Neighbor
+			{
+				uint32_t index; // Index of the point in the array passed to build()
+				Distance distanceSq;
+
+				bool operator<(const Neighbor& other) const { return distanceSq < other.distanceSq; }
+			};
 
 		public:
-			template<class BuildPolicy_, class DataSet_>
-			Kdtree(const DataSet_&);
+			Kdtree() = default;
+			Kdtree(std::span<const Point> points, core::ThreadPool* pool = nullptr) { build(points, pool); }
+
+			void build(std::span<const Point> points, core::ThreadPool* pool = nullptr);
+			void clear() { m_points.clear(); m_indices.clear(); m_axes.clear(); }
+
+			size_t size() const { return m_points.size(); }
+			bool empty() const { return m_points.empty(); }
+
+			// The k points closest to p, nearest first. Ties are broken arbitrarily
+			void nearest(const Point& p, size_t k, std::vector<Neighbor>& result) const;
+			// Index of the point closest to p. The tree must not be empty
+			uint32_t nearest(const Point& p) const;
+			// All points at a distance <= radius from p, in no particular order
+			void radiusSearch(const Point& p, Coordinate radius, std::vector<Neighbor>& result) const;
+			// Occupancy test: true if no point lies at a distance <= radius from p
+			bool isFree(const Point& p, Coordinate radius = Coordinate(0)) const;
+
+		private:
+			// Subtrees smaller than this are built in the calling thread
+			static constexpr uint32_t kMinParallelPoints = 1 << 14;
+			static constexpr Distance kUnbounded = std::numeric_limits<Distance>::has_infinity
+				? std::numeric_limits<Distance>::infinity()
+				: std::numeric_limits<Distance>::max();
+
+			struct Builder;
+
+			static Distance distanceSq(const Point& a, const Point& b)
+			{
+				Distance result = 0;
+				for (unsigned i = 0; i < dim_; ++i)
+				{
+					Distance d = Distance(a[i]) - Distance(b[i]);
+					result += d * d;
+				}
+				return result;
+			}
+
+			// Visit every point within sqrt(maxDistanceSq) of p, closest subtrees first. The visitor returns the
+			// new search radius, so it can shrink as closer points are found, or a negative one to stop the search.
+			template<class Visitor>
+			Distance visit(uint32_t begin, uint32_t end, const Point& p, Distance maxDistanceSq, Visitor& visitor) const;
+
+			std::vector<Point> m_points; // In tree order
+			std::vector<uint32_t> m_indices; // Original index of each point in m_points
+			std::vector<uint8_t> m_axes; // Split axis of the node at each position
+		};
+
+		//--------------------------------------------------------------------------------------------------------------
+		// Inline implementation
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		struct Kdtree<dim_, grid_>::Builder
+		{
+			std::span<const Point> points;
+			std::vector<uint32_t>& order;
+			std::vector<uint8_t>& axes;
+
+			Coordinate key(uint32_t i, unsigned axis) const { return points[i][axis]; }
 
-			bool ray		(Point _a, Point _b, float& _distance) const override;
-			bool isFree		(Point) const override;
+			// Axis with the largest spread in [begin, end)
+			unsigned splitAxis(uint32_t begin, uint32_t end) const
+			{
+				Point lo = points[order[begin]];
+				Point hi = lo;
+				for (uint32_t i = begin + 1; i < end; ++i)
+				{
+					const Point& x = points[order[i]];
+					for (unsigned a = 0; a < dim_; ++a)
+					{
+						lo[a] = std::min(lo[a], x[a]);
+						hi[a] = std::max(hi[a], x[a]);
+					}
+				}
+				unsigned axis = 0;
+				for (unsigned a = 1; a < dim_; ++a)
+					if (hi[a] - lo[a] > hi[axis] - lo[axis])
+						axis = a;
+				return axis;
+			}
+
+			void insertionSort(uint32_t* first, uint32_t* last, unsigned axis) const
+			{
+				for (uint32_t* i = first + 1; i < last; ++i)
+				{
+					uint32_t x = *i;
+					uint32_t* j = i;
+					for (; j > first && key(*(j - 1), axis) > key(x, axis); --j)
+						*j = *(j - 1);
+					*j = x;
+				}
+			}
+
+			// Median of medians of groups of 5 (Blum, Floyd, Pratt, Rivest, Tarjan 1973).
+			// Guarantees the pivot has at least 30% of the range on each side.
+			Coordinate pivot(uint32_t* first, uint32_t* last, unsigned axis) const
+			{
+				uint32_t numGroups = 0;
+				for (uint32_t* group = first; group < last; group += 5)
+				{
+					uint32_t* groupEnd = std::min(group + 5, last);
+					insertionSort(group, groupEnd, axis);
+					std::swap(first[numGroups++], group[(groupEnd - group) / 2]);
+				}
+				uint32_t* median = first + numGroups / 2;
+				select(first, median, first + numGroups, axis);
+				return key(*median, axis);
+			}
+
+			// Reorder [first, last) so that nth holds the element that would be there if the range was sorted along
+			// axis, with no larger elements before it and no smaller ones after it
+			void select(uint32_t* first, uint32_t* nth, uint32_t* last, unsigned axis) const
+			{
+				while (last - first > 16)
+				{
+					const Coordinate p = pivot(first, last, axis);
+					// Three way partition, so runs of equal keys can't unbalance the recursion
+					uint32_t* lt = first;
+					uint32_t* gt = last;
+					for (uint32_t* i = first; i < gt;)
+					{
+						const Coordinate k = key(*i, axis);
+						if (k < p)
+							std::swap(*lt++, *i++);
+						else if (k > p)
+							std::swap(*i, *--gt);
+						else
+							++i;
+					}
+					if (nth < lt)
+						last = lt;
+					else if (nth >= gt)
+						first = gt;
+					else
+						return; // nth is within the run of keys equal to the pivot
+				}
+				insertionSort(first, last, axis);
+			}
+
+			void build(uint32_t begin, uint32_t end, core::ThreadPool* pool)
+			{
+				if (end - begin <= 1)
+				{
+					if (end > begin)
+						axes[begin] = 0;
+					return;
+				}
+				const unsigned axis = splitAxis(begin, end);
+				const uint32_t middle = (begin + end) / 2;
+				select(&order[begin], &order[middle], order.data() + end, axis);
+				axes[middle] = uint8_t(axis);
+
+				if (pool && end - begin >= kMinParallelPoints)
+				{
+					auto left = pool->submit([this, begin, middle, pool]() { build(begin, middle, pool); });
+					build(middle + 1, end, pool);
+					pool->wait(left);
+				}
+				else
+				{
+					build(begin, middle, nullptr);
+					build(middle + 1, end, nullptr);
+				}
+			}
 		};
 
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		void Kdtree<dim_, grid_>::build(std::span<const Point> points, core::ThreadPool* pool)
+		{
+			static_assert(dim_ > 0 && dim_ <= 255);
+			assert(points.size() < std::numeric_limits<uint32_t>::max());
+			m_indices.resize(points.size());
+			std::iota(m_indices.begin(), m_indices.end(), 0);
+			m_axes.resize(points.size());
+
+			Builder builder { points, m_indices, m_axes };
+			builder.build(0, uint32_t(points.size()), pool);
+
+			m_points.resize(points.size());
+			for (size_t i = 0; i < points.size(); ++i)
+				m_points[i] = points[m_indices[i]];
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		template<class Visitor>
+		auto Kdtree<dim_, grid_>::visit(uint32_t begin, uint32_t end, const Point& p, Distance maxDistanceSq, Visitor& visitor) const -> Distance
+		{
+			while (begin < end)
+			{
+				const uint32_t middle = (begin + end) / 2;
+				const Distance d = distanceSq(p, m_points[middle]);
+				if (d <= maxDistanceSq)
+				{
+					maxDistanceSq = visitor(middle, d);
+					if (maxDistanceSq < 0)
+						return maxDistanceSq;
+				}
+
+				// Descend into the side of the split plane that holds p first. The far side is only visited if the
+				// plane is within the search radius
+				const unsigned axis = m_axes[middle];
+				const Distance planeDistance = Distance(p[axis]) - Distance(m_points[middle][axis]);
+				uint32_t nearBegin = begin, nearEnd = middle;
+				uint32_t farBegin = middle + 1, farEnd = end;
+				if (planeDistance > 0)
+				{
+					std::swap(nearBegin, farBegin);
+					std::swap(nearEnd, farEnd);
+				}
+				maxDistanceSq = visit(nearBegin, nearEnd, p, maxDistanceSq, visitor);
+				if (maxDistanceSq < 0 || planeDistance * planeDistance > maxDistanceSq)
+					return maxDistanceSq;
+				// Tail iteration on the far side
+				begin = farBegin;
+				end = farEnd;
+			}
+			return maxDistanceSq;
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		void Kdtree<dim_, grid_>::nearest(const Point& p, size_t k, std::vector<Neighbor>& result) const
+		{
+			result.clear();
+			k = std::min(k, size());
+			if (k == 0)
+				return;
+
+			// Max heap with the best k candidates so far. Once full, the search radius is the farthest of them
+			auto visitor = [&](uint32_t i, Distance d) -> Distance {
+				if (result.size() < k)
+				{
+					result.push_back({ m_indices[i], d });
+					std::push_heap(result.begin(), result.end());
+				}
+				else if (d < result.front().distanceSq)
+				{
+					std::pop_heap(result.begin(), result.end());
+					result.back() = { m_indices[i], d };
+					std::push_heap(result.begin(), result.end());
+				}
+				return result.size() < k ? kUnbounded : result.front().distanceSq;
+			};
+			visit(0, uint32_t(size()), p, kUnbounded, visitor);
+			std::sort_heap(result.begin(), result.end());
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		uint32_t Kdtree<dim_, grid_>::nearest(const Point& p) const
+		{
+			assert(!empty());
+			uint32_t closest = 0;
+			auto visitor = [&](uint32_t i, Distance d) -> Distance {
+				closest = i;
+				return d;
+			};
+			visit(0, uint32_t(size()), p, kUnbounded, visitor);
+			return m_indices[closest];
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		void Kdtree<dim_, grid_>::radiusSearch(const Point& p, Coordinate radius, std::vector<Neighbor>& result) const
+		{
+			result.clear();
+			const Distance radiusSq = Distance(radius) * Distance(radius);
+			auto visitor = [&](uint32_t i, Distance d) -> Distance {
+				result.push_back({ m_indices[i], d });
+				return radiusSq;
+			};
+			visit(0, uint32_t(size()), p, radiusSq, visitor);
+		}
+
+		//--------------------------------------------------------------------------------------------------------------
+		template<unsigned dim_, bool grid_>
+		bool Kdtree<dim_, grid_>::isFree(const Point& p, Coordinate radius) const
+		{
+			const Distance radiusSq = Distance(radius) * Distance(radius);
+			auto visitor = [](uint32_t, Distance) -> Distance { return -1; }; // Stop at the first point found
+			return visit(0, uint32_t(size()), p, radiusSq, visitor) >= 0;
+		}
+
 	}	// namespace math
 }	// namespace rev
 
-#endif // _REV_MATH_GEOMETRY_KDTREE_H_
\ No newline at end of file
+#endif // _REV_MATH_GEOMETRY_KDTREE_H_
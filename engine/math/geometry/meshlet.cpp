@@ -0,0 +1,324 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace rev::math
+{
+	namespace
+	{
+		// Greedy meshlet growth over the vertex to triangle adjacency of the mesh
+		struct MeshletBuilder
+		{
+			static constexpr uint32_t kNone = uint32_t(-1);
+
+			std::span<const uint32_t> indices;
+			uint32_t maxVertices;
+			uint32_t maxTriangles;
+
+			// Triangles around each vertex, in compressed rows
+			std::vector<uint32_t> vertexTriangleStart;
+			std::vector<uint32_t> vertexTriangles;
+
+			std::vector<uint32_t> vertexMeshlet; // Last meshlet each vertex was added to. Avoids clearing a set per meshlet
+			std::vector<bool> emitted;
+			std::vector<uint32_t> candidates; // Triangles next to the current meshlet. May contain emitted ones
+			uint32_t nextSeed = 0;
+
+			MeshletBuilder(size_t numVertices, std::span<const uint32_t> _indices, uint32_t _maxVertices, uint32_t _maxTriangles)
+				: indices(_indices)
+				, maxVertices(_maxVertices)
+				, maxTriangles(_maxTriangles)
+			{
+				const auto numTriangles = uint32_t(indices.size() / 3);
+				vertexTriangleStart.assign(numVertices + 1, 0);
+				for (auto v : indices)
+					++vertexTriangleStart[v + 1];
+				for (size_t v = 0; v < numVertices; ++v)
+					vertexTriangleStart[v + 1] += vertexTriangleStart[v];
+
+				vertexTriangles.resize(indices.size());
+				std::vector<uint32_t> fill(vertexTriangleStart.begin(), vertexTriangleStart.end() - 1);
+				for (uint32_t t = 0; t < numTriangles; ++t)
+				{
+					for (uint32_t k = 0; k < 3; ++k)
+						vertexTriangles[fill[indices[3 * t + k]]++] = t;
+				}
+
+				vertexMeshlet.assign(numVertices, kNone);
+				emitted.assign(numTriangles, false);
+			}
+
+			// Vertices of the triangle that are not in the meshlet yet
+			uint32_t newVertices(uint32_t t, uint32_t meshletNdx) const
+			{
+				const uint32_t a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+				uint32_t count = (vertexMeshlet[a] != meshletNdx) ? 1 : 0;
+				count += (vertexMeshlet[b] != meshletNdx && b != a) ? 1 : 0;
+				count += (vertexMeshlet[c] != meshletNdx && c != a && c != b) ? 1 : 0;
+				return count;
+			}
+
+			void addTriangle(uint32_t t, uint32_t meshletNdx, Meshlet& meshlet, std::vector<uint32_t>& order)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = indices[3 * t + k];
+					if (vertexMeshlet[v] == meshletNdx)
+						continue;
+					vertexMeshlet[v] = meshletNdx;
+					++meshlet.numVertices;
+					candidates.insert(candidates.end(),
+						vertexTriangles.begin() + vertexTriangleStart[v],
+						vertexTriangles.begin() + vertexTriangleStart[v + 1]);
+				}
+				emitted[t] = true;
+				order.push_back(t);
+				++meshlet.numTriangles;
+			}
+
+			// The candidate that adds the fewest vertices, or kNone if there are no candidates left
+			uint32_t bestCandidate(uint32_t meshletNdx, uint32_t& bestNewVertices)
+			{
+				uint32_t best = kNone;
+				bestNewVertices = 4;
+				size_t live = 0;
+				for (size_t i = 0; i < candidates.size(); ++i)
+				{
+					const uint32_t t = candidates[i];
+					if (emitted[t])
+						continue;
+					candidates[live++] = t; // Compact away emitted triangles as we go
+
+					const uint32_t score = newVertices(t, meshletNdx);
+					if (score < bestNewVertices)
+					{
+						best = t;
+						bestNewVertices = score;
+					}
+				}
+				candidates.resize(live);
+				return best;
+			}
+
+			// Next triangle in index order that hasn't been emitted, or kNone
+			uint32_t nextUnemitted()
+			{
+				while (nextSeed < emitted.size() && emitted[nextSeed])
+					++nextSeed;
+				return nextSeed < emitted.size() ? nextSeed : kNone;
+			}
+
+			void build(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& order)
+			{
+				for (uint32_t seed = nextUnemitted(); seed != kNone; seed = nextUnemitted())
+				{
+					const auto meshletNdx = (uint32_t)meshlets.size();
+					auto& meshlet = meshlets.emplace_back();
+					meshlet.firstTriangle = (uint32_t)order.size();
+					meshlet.numTriangles = 0;
+					meshlet.numVertices = 0;
+					candidates.clear();
+					addTriangle(seed, meshletNdx, meshlet, order);
+
+					while (meshlet.numTriangles < maxTriangles)
+					{
+						uint32_t numNew;
+						uint32_t next = bestCandidate(meshletNdx, numNew);
+						if (next == kNone)
+						{
+							// Nothing connected left. Keep filling with the next triangles in index order
+							next = nextUnemitted();
+							if (next == kNone)
+								break;
+							numNew = newVertices(next, meshletNdx);
+						}
+						if (meshlet.numVertices + numNew > maxVertices)
+							break;
+						addTriangle(next, meshletNdx, meshlet, order);
+					}
+				}
+			}
+		};
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void buildMeshlets(
+		std::span<const Vec3f> positions,
+		std::span<uint32_t> indices,
+		std::vector<Meshlet>& meshlets,
+		std::vector<MeshletBounds>& bounds,
+		uint32_t maxVertices,
+		uint32_t maxTriangles)
+	{
+		assert(indices.size() % 3 == 0);
+		assert(maxVertices >= 3 && maxTriangles >= 1);
+		meshlets.clear();
+		bounds.clear();
+
+		std::vector<uint32_t> order; // Triangles in meshlet order
+		order.reserve(indices.size() / 3);
+		MeshletBuilder builder(positions.size(), indices, maxVertices, maxTriangles);
+		builder.build(meshlets, order);
+		assert(order.size() == indices.size() / 3);
+
+		// Reorder triangles
+		std::vector<uint32_t> sourceIndices(indices.begin(), indices.end());
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			for (size_t k = 0; k < 3; ++k)
+				indices[3 * i + k] = sourceIndices[3 * order[i] + k];
+		}
+
+		bounds.reserve(meshlets.size());
+		for (auto& meshlet : meshlets)
+			bounds.push_back(computeMeshletBounds(positions, indices.subspan(3 * meshlet.firstTriangle, 3 * meshlet.numTriangles)));
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	MeshletBounds computeMeshletBounds(std::span<const Vec3f> positions, std::span<const uint32_t> triangleIndices)
+	{
+		MeshletBounds bounds;
+
+		// Sphere around the center of the bounding box
+		AABB box;
+		for (auto v : triangleIndices)
+			box.add(positions[v]);
+		bounds.center = box.center();
+		float radiusSq = 0.f;
+		for (auto v : triangleIndices)
+			radiusSq = std::max(radiusSq, squaredNorm(positions[v] - bounds.center));
+		bounds.radius = std::sqrt(radiusSq);
+
+		// Cone of normals. Degenerate triangles don't face anywhere, so they don't limit it
+		std::vector<Vec3f> normals;
+		normals.reserve(triangleIndices.size() / 3);
+		Vec3f normalSum = Vec3f::zero();
+		for (size_t i = 0; i + 2 < triangleIndices.size(); i += 3)
+		{
+			const Vec3f& a = positions[triangleIndices[i]];
+			const Vec3f ab = positions[triangleIndices[i + 1]] - a;
+			const Vec3f ac = positions[triangleIndices[i + 2]] - a;
+			const Vec3f n = cross(ab, ac);
+			const float area = norm(n);
+			normals.push_back(area > 0.f ? n * (1.f / area) : Vec3f::zero());
+			normalSum = normalSum + normals.back();
+		}
+
+		// Can't cull cones wider than ~85 degrees, since the apex goes too far back to be useful
+		bounds.coneApex = bounds.center;
+		bounds.coneAxis = Vec3f::zero();
+		bounds.coneCutoff = 1.f;
+		const float sumNorm = norm(normalSum);
+		if (sumNorm == 0.f)
+			return bounds;
+
+		const Vec3f axis = normalSum * (1.f / sumNorm);
+		float minDot = 1.f;
+		for (auto& n : normals)
+		{
+			if (n != Vec3f::zero())
+				minDot = std::min(minDot, dot(n, axis));
+		}
+		if (minDot <= 0.1f)
+			return bounds;
+
+		// Move the apex back along the axis until it is behind the planes of all triangles.
+		// Then any point inside the cone opening, away from the apex, sees every triangle from behind
+		float maxT = 0.f;
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			const auto& n = normals[i];
+			if (n == Vec3f::zero())
+				continue;
+			const Vec3f& p0 = positions[triangleIndices[3 * i]];
+			maxT = std::max(maxT, dot(bounds.center - p0, n) / dot(axis, n));
+		}
+
+		bounds.coneApex = bounds.center - axis * maxT;
+		bounds.coneAxis = axis;
+		bounds.coneCutoff = std::sqrt(1.f - minDot * minDot);
+		return bounds;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool preservesNormalCone(const Mat44f& m)
+	{
+		const Vec3f x(m(0, 0), m(1, 0), m(2, 0));
+		const Vec3f y(m(0, 1), m(1, 1), m(2, 1));
+		const Vec3f z(m(0, 2), m(1, 2), m(2, 2));
+		if (dot(cross(x, y), z) <= 0.f) // Mirrored, or degenerate
+			return false;
+
+		// Orthogonal axes of the same length, up to rounding
+		const float scaleSq = squaredNorm(x);
+		const float tolerance = 1e-3f * scaleSq;
+		return std::abs(squaredNorm(y) - scaleSq) <= tolerance
+			&& std::abs(squaredNorm(z) - scaleSq) <= tolerance
+			&& std::abs(dot(x, y)) <= tolerance
+			&& std::abs(dot(y, z)) <= tolerance
+			&& std::abs(dot(z, x)) <= tolerance;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	MeshletBounds operator*(const Mat44f& m, const MeshletBounds& bounds)
+	{
+		MeshletBounds result;
+		result.center = (m * Vec4f(bounds.center, 1.f)).xyz();
+		result.coneApex = (m * Vec4f(bounds.coneApex, 1.f)).xyz();
+
+		float maxScaleSq = 0.f;
+		for (int i = 0; i < 3; ++i)
+			maxScaleSq = std::max(maxScaleSq, squaredNorm(Vec3f(m(0, i), m(1, i), m(2, i))));
+		result.radius = bounds.radius * std::sqrt(maxScaleSq);
+
+		result.coneAxis = Vec3f::zero();
+		result.coneCutoff = 1.f;
+		if (bounds.coneCutoff < 1.f && preservesNormalCone(m))
+		{
+			result.coneAxis = normalize((m * Vec4f(bounds.coneAxis, 0.f)).xyz());
+			result.coneCutoff = bounds.coneCutoff;
+		}
+		return result;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool isMeshletVisible(const MeshletBounds& bounds, const Frustum& frustum, const Vec3f& viewPoint)
+	{
+		for (size_t i = 0; i < 6; ++i)
+		{
+			const auto& plane = frustum.plane(i);
+			if (dot(bounds.center, plane.normal) - bounds.radius * norm(plane.normal) > plane.t) // Fully outside
+				return false;
+		}
+
+		if (bounds.coneCutoff < 1.f)
+		{
+			const Vec3f toApex = bounds.coneApex - viewPoint;
+			const float distance = norm(toApex);
+			if (distance > 0.f && dot(toApex, bounds.coneAxis) >= bounds.coneCutoff * distance) // Back facing
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <math/algebra/matrix.h>
+#include <math/algebra/vector.h>
+#include "types.h"
+
+namespace rev::math
+{
+	// Cluster of neighboring triangles of a mesh, small enough to be culled as a unit.
+	// Meshlets index a reordered index buffer, where the triangles of each meshlet are contiguous.
+	// So each of them can be drawn with a plain indexed draw of 3 * numTriangles indices.
+	struct Meshlet
+	{
+		static constexpr uint32_t kMaxVertices = 64;
+		static constexpr uint32_t kMaxTriangles = 124;
+
+		uint32_t firstTriangle; // First index is 3 * firstTriangle
+		uint32_t numTriangles;
+		uint32_t numVertices; // Unique vertices referenced by the triangles
+	};
+
+	// Bounding sphere and normal cone of a meshlet, with the same conventions as meshoptimizer's cluster bounds.
+	// The meshlet is back facing, and can be culled, when seen from any point p with
+	// dot(normalize(coneApex - p), coneAxis) >= coneCutoff.
+	struct MeshletBounds
+	{
+		Vec3f center;
+		float radius;
+		Vec3f coneApex;
+		Vec3f coneAxis;
+		float coneCutoff; // Sine of the half angle of the cone of normals. 1 when the cone is too wide to cull
+	};
+
+	// Splits a triangle list in meshlets, growing each one over the triangles that share the most vertices with it.
+	// Reorders the triangles in indices so that each meshlet is a contiguous range. Triangles are kept intact, with
+	// their original winding, so the reordered list draws exactly the same mesh.
+	void buildMeshlets(
+		std::span<const Vec3f> positions,
+		std::span<uint32_t> indices,
+		std::vector<Meshlet>& meshlets,
+		std::vector<MeshletBounds>& bounds,
+		uint32_t maxVertices = Meshlet::kMaxVertices,
+		uint32_t maxTriangles = Meshlet::kMaxTriangles);
+
+	// Bounds of the triangles of a triangle list
+	MeshletBounds computeMeshletBounds(std::span<const Vec3f> positions, std::span<const uint32_t> triangleIndices);
+
+	// Whether normal cones stay valid in the space m transforms to. Only true when m has uniform scale and
+	// doesn't mirror, which would flip the front face of the triangles.
+	bool preservesNormalCone(const Mat44f& m);
+
+	// Bounds in another space. The radius grows with the largest axis scale.
+	// The cone is dropped, so the bounds can't be culled by facing, unless preservesNormalCone(m).
+	MeshletBounds operator*(const Mat44f& m, const MeshletBounds& bounds);
+
+	// Frustum and back face test. Frustum, view point and bounds must be in the same space.
+	bool isMeshletVisible(const MeshletBounds& bounds, const Frustum& frustum, const Vec3f& viewPoint);
+}
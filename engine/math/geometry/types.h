@@ -75,6 +75,8 @@ namespace rev {
 			const math::Vec3f& viewDir() const { return mPlanes[1].normal; }
 			const Plane& plane(size_t i) const { return mPlanes[i]; }
 			const Vec3f& vertex(size_t i) const { return mVertices[i]; }
+			// Point of view, where the side planes meet
+			Vec3f origin() const { return mVertices[0] + (mVertices[0] - mVertices[4]) * (mNear / (mFar - mNear)); }
 
 			const Mat44f& projection() const { return mProjection; }
 			AABB boundingBox() const;
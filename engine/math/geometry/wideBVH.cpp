@@ -0,0 +1,475 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "wideBVH.h"
+
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+namespace rev::math
+{
+	using simd::float8;
+	using simd::Vec3f8;
+
+	namespace
+	{
+		// Every level of the tree pushes at most kWidth-1 siblings of the child it descends into
+		constexpr uint32_t kStackSize = BVH::kMaxDepth * (WideBVH::kWidth - 1) + 1;
+		constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+		struct StackEntry
+		{
+			uint32_t child;
+			uint32_t numPackets;
+			float tEnter;
+		};
+
+		// Push a child keeping the entries above "first" sorted far to near, so the nearest child is popped first
+		void pushSorted(StackEntry* stack, uint32_t first, uint32_t& stackSize, const StackEntry& entry)
+		{
+			uint32_t i = stackSize++;
+			while (i > first && stack[i - 1].tEnter < entry.tEnter)
+			{
+				stack[i] = stack[i - 1];
+				--i;
+			}
+			stack[i] = entry;
+		}
+
+		// Slab test of 8 ray/box pairs, with the same operation order as AABB::intersect
+		float8 intersectBoxes(
+			const Vec3f8& origin, const Vec3f8& invDirection,
+			const Vec3f8& boxMin, const Vec3f8& boxMax,
+			const float8& tMax, float8& tEnter)
+		{
+			Vec3f8 t1 = (boxMin - origin) * invDirection;
+			Vec3f8 t2 = (boxMax - origin) * invDirection;
+			Vec3f8 enter = min(t1, t2);
+			Vec3f8 leave = max(t2, t1);
+			tEnter = max(enter.x, max(enter.y, max(enter.z, float8::zero())));
+			float8 tLeave = min(leave.x, min(leave.y, min(leave.z, tMax)));
+			return tLeave >= tEnter;
+		}
+
+		Vec3f8 loadMin(const WideBVH::Node& node)
+		{
+			return Vec3f8(float8::load(node.minX), float8::load(node.minY), float8::load(node.minZ));
+		}
+
+		Vec3f8 loadMax(const WideBVH::Node& node)
+		{
+			return Vec3f8(float8::load(node.maxX), float8::load(node.maxY), float8::load(node.maxZ));
+		}
+
+		Vec3f8 load(const float (&v)[3][WideBVH::kWidth])
+		{
+			return Vec3f8(float8::load(v[0]), float8::load(v[1]), float8::load(v[2]));
+		}
+
+		Vec3f8 broadcast(const float (&v)[3][WideBVH::kWidth], uint32_t lane)
+		{
+			return Vec3f8(float8(v[0][lane]), float8(v[1][lane]), float8(v[2][lane]));
+		}
+
+		// Slots covered by a binary subtree. They are contiguous because the binary BVH is stored depth first
+		std::pair<uint32_t, uint32_t> slotRange(const std::vector<BVH::Node>& nodes, uint32_t index)
+		{
+			uint32_t first = index;
+			while (!nodes[first].isLeaf())
+				++first;
+			uint32_t last = index;
+			while (!nodes[last].isLeaf())
+				last = nodes[last].offset;
+			return { nodes[first].offset, nodes[last].offset + nodes[last].count };
+		}
+
+		// Subtrees that fit in a single triangle packet become one leaf
+		bool isWideLeaf(const std::vector<BVH::Node>& nodes, uint32_t index)
+		{
+			auto [begin, end] = slotRange(nodes, index);
+			return nodes[index].isLeaf() || end - begin <= WideBVH::kWidth;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void WideBVH::build(std::span<const Vec3f> positions, std::span<const uint32_t> indices, const BVH::BuildOptions& options)
+	{
+		assert(indices.size() % 3 == 0);
+		clear();
+		m_numTriangles = indices.size() / 3;
+		if (m_numTriangles == 0)
+			return;
+
+		std::vector<AABB> bounds(m_numTriangles);
+		for (size_t i = 0; i < m_numTriangles; ++i)
+		{
+			bounds[i].add(positions[indices[3 * i + 0]]);
+			bounds[i].add(positions[indices[3 * i + 1]]);
+			bounds[i].add(positions[indices[3 * i + 2]]);
+		}
+		BVH bvh;
+		bvh.build(bounds, options);
+
+		// A full 8-wide tree has about a quarter of the binary tree's interior nodes
+		m_nodes.reserve(bvh.nodes().size() / 4 + 1);
+		m_packets.reserve((m_numTriangles + kWidth - 1) / kWidth);
+		collapse(bvh, 0, positions, indices);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	void WideBVH::clear()
+	{
+		m_nodes.clear();
+		m_packets.clear();
+		m_numTriangles = 0;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t WideBVH::collapse(const BVH& bvh, uint32_t binaryNode, std::span<const Vec3f> positions, std::span<const uint32_t> indices)
+	{
+		const auto& binaryNodes = bvh.nodes();
+
+		// Pull binary descendants up into this node, always opening the interior child with the largest area,
+		// until there are kWidth children or only leaves are left
+		uint32_t children[kWidth];
+		uint32_t numChildren = 0;
+		if (isWideLeaf(binaryNodes, binaryNode))
+			children[numChildren++] = binaryNode;
+		else
+		{
+			children[numChildren++] = binaryNode + 1;
+			children[numChildren++] = binaryNodes[binaryNode].offset;
+		}
+		while (numChildren < kWidth)
+		{
+			int largest = -1;
+			float largestArea = -1.f;
+			for (uint32_t i = 0; i < numChildren; ++i)
+			{
+				const auto& child = binaryNodes[children[i]];
+				if (!isWideLeaf(binaryNodes, children[i]) && child.bounds.area() > largestArea)
+				{
+					largest = int(i);
+					largestArea = child.bounds.area();
+				}
+			}
+			if (largest < 0)
+				break;
+			const uint32_t opened = children[largest];
+			children[largest] = opened + 1;
+			children[numChildren++] = binaryNodes[opened].offset;
+		}
+
+		const auto nodeIndex = uint32_t(m_nodes.size());
+		{
+			Node& node = m_nodes.emplace_back();
+			for (uint32_t i = 0; i < kWidth; ++i)
+			{
+				node.minX[i] = node.minY[i] = node.minZ[i] = kInfinity;
+				node.maxX[i] = node.maxY[i] = node.maxZ[i] = kInfinity;
+				node.child[i] = kInvalidChild;
+				node.numPackets[i] = 0;
+			}
+		}
+
+		for (uint32_t i = 0; i < numChildren; ++i)
+		{
+			const auto& child = binaryNodes[children[i]];
+			uint32_t childIndex;
+			uint32_t numPackets = 0;
+			if (isWideLeaf(binaryNodes, children[i]))
+			{
+				auto [begin, end] = slotRange(binaryNodes, children[i]);
+				childIndex = addLeaf(bvh, begin, end, positions, indices);
+				numPackets = uint32_t(m_packets.size()) - childIndex;
+			}
+			else
+				childIndex = collapse(bvh, children[i], positions, indices);
+
+			// Recursion may have reallocated the node array
+			Node& node = m_nodes[nodeIndex];
+			node.minX[i] = child.bounds.min().x();
+			node.minY[i] = child.bounds.min().y();
+			node.minZ[i] = child.bounds.min().z();
+			node.maxX[i] = child.bounds.max().x();
+			node.maxY[i] = child.bounds.max().y();
+			node.maxZ[i] = child.bounds.max().z();
+			node.child[i] = childIndex;
+			node.numPackets[i] = numPackets;
+		}
+		return nodeIndex;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t WideBVH::addLeaf(const BVH& bvh, uint32_t beginSlot, uint32_t endSlot, std::span<const Vec3f> positions, std::span<const uint32_t> indices)
+	{
+		const auto first = uint32_t(m_packets.size());
+		for (uint32_t begin = beginSlot; begin < endSlot; begin += kWidth)
+		{
+			// Unused lanes hold degenerate triangles, which never pass the determinant test
+			TrianglePacket& packet = m_packets.emplace_back();
+			for (uint32_t lane = 0; lane < kWidth; ++lane)
+			{
+				Vec3f v0 = Vec3f::zero(), e1 = Vec3f::zero(), e2 = Vec3f::zero();
+				uint32_t primitive = uint32_t(-1);
+				if (begin + lane < endSlot)
+				{
+					primitive = bvh.primitiveIndex(begin + lane);
+					v0 = positions[indices[3 * primitive + 0]];
+					e1 = positions[indices[3 * primitive + 1]] - v0;
+					e2 = positions[indices[3 * primitive + 2]] - v0;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					packet.v0[k][lane] = v0[k];
+					packet.e1[k][lane] = e1[k];
+					packet.e2[k][lane] = e2[k];
+				}
+				packet.primitive[lane] = primitive;
+			}
+		}
+		return first;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool WideBVH::closestHit(const Ray& ray, float tMax, Hit& hit) const
+	{
+		return traceRay<false>(ray, tMax, &hit);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	bool WideBVH::anyHit(const Ray& ray, float tMax) const
+	{
+		return traceRay<true>(ray, tMax, nullptr);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t WideBVH::closestHit(std::span<const Ray> rays, float tMax, Hit* hits) const
+	{
+		return tracePacket<false>(rays, tMax, hits);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	uint32_t WideBVH::anyHit(std::span<const Ray> rays, float tMax) const
+	{
+		return tracePacket<true>(rays, tMax, nullptr);
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	template<bool anyHit>
+	bool WideBVH::traceRay(const Ray& ray, float tMax, Hit* hit) const
+	{
+		if (m_nodes.empty())
+			return false;
+
+		const auto implicit = ray.implicit();
+		const Vec3f8 origin(implicit.o);
+		const Vec3f8 invDirection(implicit.n);
+		const Vec3f8 direction(ray.direction());
+
+		StackEntry stack[kStackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, 0.f };
+
+		bool found = false;
+		Hit closest;
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.tEnter > tMax)
+				continue;
+
+			if (entry.numPackets == 0)
+			{
+				const Node& node = m_nodes[entry.child];
+				float8 tEnter;
+				auto mask = uint32_t(intersectBoxes(origin, invDirection, loadMin(node), loadMax(node), float8(tMax), tEnter).bits());
+				if (!mask)
+					continue;
+
+				alignas(32) float enter[kWidth];
+				tEnter.store(enter);
+				const uint32_t first = stackSize;
+				for (; mask; mask &= mask - 1)
+				{
+					const int i = std::countr_zero(mask);
+					pushSorted(stack, first, stackSize, { node.child[i], node.numPackets[i], enter[i] });
+				}
+				continue;
+			}
+
+			for (uint32_t p = entry.child; p < entry.child + entry.numPackets; ++p)
+			{
+				const TrianglePacket& packet = m_packets[p];
+				float8 t, u, v;
+				auto mask = uint32_t(intersectTriangle(origin, direction, load(packet.v0), load(packet.e1), load(packet.e2), float8(tMax), t, u, v).bits());
+				if (!mask)
+					continue;
+				if constexpr (anyHit)
+					return true;
+
+				alignas(32) float ts[kWidth];
+				t.store(ts);
+				int nearest = -1;
+				for (; mask; mask &= mask - 1)
+				{
+					const int i = std::countr_zero(mask);
+					if (ts[i] < tMax)
+					{
+						tMax = ts[i];
+						nearest = i;
+					}
+				}
+				closest.primitive = packet.primitive[nearest];
+				closest.t = tMax;
+				closest.u = u[nearest];
+				closest.v = v[nearest];
+				found = true;
+			}
+		}
+
+		if (found)
+			*hit = closest;
+		return found;
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	template<bool anyHit>
+	uint32_t WideBVH::tracePacket(std::span<const Ray> rays, float tMax, Hit* hits) const
+	{
+		assert(rays.size() <= kWidth);
+		if (m_nodes.empty() || rays.empty())
+			return 0;
+
+		// One ray per lane. Lanes past the end of the span repeat the first ray, and are never active
+		alignas(32) float lanes[9][kWidth];
+		for (uint32_t i = 0; i < kWidth; ++i)
+		{
+			const Ray& ray = rays[i < rays.size() ? i : 0];
+			const auto implicit = ray.implicit();
+			for (int k = 0; k < 3; ++k)
+			{
+				lanes[k][i] = implicit.o[k];
+				lanes[3 + k][i] = implicit.n[k];
+				lanes[6 + k][i] = ray.direction()[k];
+			}
+		}
+		const Vec3f8 origin(float8::load(lanes[0]), float8::load(lanes[1]), float8::load(lanes[2]));
+		const Vec3f8 invDirection(float8::load(lanes[3]), float8::load(lanes[4]), float8::load(lanes[5]));
+		const Vec3f8 direction(float8::load(lanes[6]), float8::load(lanes[7]), float8::load(lanes[8]));
+
+		uint32_t active = (1u << rays.size()) - 1;
+		uint32_t hitMask = 0;
+		float8 tFar(tMax); // Per ray query range, shrinks as closer hits are found
+		float packetTMax = tMax; // Largest tFar among active rays
+		float8 hitU = float8::zero();
+		float8 hitV = float8::zero();
+		uint32_t hitPrimitive[kWidth];
+
+		StackEntry stack[kStackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, 0.f };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.tEnter > packetTMax)
+				continue;
+
+			if (entry.numPackets == 0)
+			{
+				// All rays against one child box at a time
+				const Node& node = m_nodes[entry.child];
+				const uint32_t first = stackSize;
+				for (uint32_t c = 0; c < kWidth && node.child[c] != kInvalidChild; ++c)
+				{
+					const Vec3f8 boxMin(float8(node.minX[c]), float8(node.minY[c]), float8(node.minZ[c]));
+					const Vec3f8 boxMax(float8(node.maxX[c]), float8(node.maxY[c]), float8(node.maxZ[c]));
+					float8 tEnter;
+					auto mask = uint32_t(intersectBoxes(origin, invDirection, boxMin, boxMax, tFar, tEnter).bits()) & active;
+					if (!mask)
+						continue;
+
+					// Order children by the nearest entry among the rays that hit them
+					alignas(32) float enter[kWidth];
+					tEnter.store(enter);
+					float nearest = kInfinity;
+					for (; mask; mask &= mask - 1)
+						nearest = std::min(nearest, enter[std::countr_zero(mask)]);
+					pushSorted(stack, first, stackSize, { node.child[c], node.numPackets[c], nearest });
+				}
+				continue;
+			}
+
+			// All rays against one triangle at a time
+			for (uint32_t p = entry.child; p < entry.child + entry.numPackets; ++p)
+			{
+				const TrianglePacket& packet = m_packets[p];
+				for (uint32_t j = 0; j < kWidth && packet.primitive[j] != uint32_t(-1); ++j)
+				{
+					float8 t, u, v;
+					const float8 hit = intersectTriangle(origin, direction, broadcast(packet.v0, j), broadcast(packet.e1, j), broadcast(packet.e2, j), tFar, t, u, v);
+					auto mask = uint32_t(hit.bits()) & active;
+					if (!mask)
+						continue;
+
+					hitMask |= mask;
+					if constexpr (anyHit)
+					{
+						// Occluded rays are done
+						active &= ~mask;
+						if (!active)
+							return hitMask;
+						continue;
+					}
+					else
+					{
+						tFar = select(hit, t, tFar);
+						hitU = select(hit, u, hitU);
+						hitV = select(hit, v, hitV);
+						for (; mask; mask &= mask - 1)
+							hitPrimitive[std::countr_zero(mask)] = packet.primitive[j];
+
+						alignas(32) float far[kWidth];
+						tFar.store(far);
+						packetTMax = 0.f;
+						for (uint32_t i = active; i; i &= i - 1)
+							packetTMax = std::max(packetTMax, far[std::countr_zero(i)]);
+					}
+				}
+			}
+		}
+
+		if constexpr (!anyHit)
+		{
+			alignas(32) float t[kWidth], u[kWidth], v[kWidth];
+			tFar.store(t);
+			hitU.store(u);
+			hitV.store(v);
+			for (uint32_t i = hitMask; i; i &= i - 1)
+			{
+				const int lane = std::countr_zero(i);
+				hits[lane] = { hitPrimitive[lane], t[lane], u[lane], v[lane] };
+			}
+		}
+		return hitMask;
+	}
+}
@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------------------
+// Revolution Engine
+//--------------------------------------------------------------------------------------------------
+// Copyright 2021 Carmelo J Fdez-Aguera
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <math/algebra/simd8.h>
+#include "bvh.h"
+
+namespace rev::math
+{
+	// 8-wide BVH over an indexed triangle mesh, for high throughput CPU ray casting.
+	// Built by collapsing a binary SAH BVH: every node holds the bounds of up to 8 children in SoA layout, so one ray
+	// is tested against all of them with a single pack of slab tests. Binary subtrees with up to 8 triangles become
+	// leaves holding a packet of 8 triangles, also in SoA, tested with an 8-wide Möller-Trumbore.
+	// Rays can be traced one at a time, or in packets of up to 8 coherent rays (e.g. primary rays from neighbouring
+	// pixels) that share a single traversal of the tree.
+	class WideBVH
+	{
+	public:
+		static constexpr uint32_t kWidth = simd::float8::kWidth;
+		static constexpr uint32_t kInvalidChild = uint32_t(-1);
+		using Hit = BVH::Hit;
+
+		struct alignas(32) Node
+		{
+			// Child bounds. Unused slots are set to +inf on both ends, which no ray can enter
+			float minX[kWidth], minY[kWidth], minZ[kWidth];
+			float maxX[kWidth], maxY[kWidth], maxZ[kWidth];
+			uint32_t child[kWidth]; // Node index for interior children, first triangle packet for leaves. Unused slots are last, set to kInvalidChild
+			uint32_t numPackets[kWidth]; // Number of triangle packets in leaf children. 0 for interior children
+		};
+
+		struct alignas(32) TrianglePacket
+		{
+			float v0[3][kWidth];
+			float e1[3][kWidth]; // v1 - v0
+			float e2[3][kWidth]; // v2 - v0
+			uint32_t primitive[kWidth]; // Triangle index in the original index buffer. -1 for unused lanes
+		};
+
+		// Binary build options. A larger leaf size than the BVH default fills triangle packets better
+		static BVH::BuildOptions defaultBuildOptions()
+		{
+			BVH::BuildOptions options;
+			options.maxLeafSize = kWidth;
+			return options;
+		}
+
+		void build(std::span<const Vec3f> positions, std::span<const uint32_t> indices, const BVH::BuildOptions& options);
+		void build(std::span<const Vec3f> positions, std::span<const uint32_t> indices) { build(positions, indices, defaultBuildOptions()); }
+		void clear();
+
+		bool empty() const { return m_nodes.empty(); }
+		const std::vector<Node>& nodes() const { return m_nodes; }
+		const std::vector<TrianglePacket>& packets() const { return m_packets; }
+		size_t numTriangles() const { return m_numTriangles; }
+
+		// Single ray queries. Same semantics as TriangleBVH
+		bool closestHit(const Ray& ray, float tMax, Hit& hit) const;
+		bool anyHit(const Ray& ray, float tMax) const;
+
+		// Packet queries, for up to kWidth rays at once. Return a bit mask with the rays that hit something.
+		// closestHit only writes hits[i] for the rays that hit.
+		uint32_t closestHit(std::span<const Ray> rays, float tMax, Hit* hits) const;
+		uint32_t anyHit(std::span<const Ray> rays, float tMax) const;
+
+	private:
+		uint32_t collapse(const BVH& bvh, uint32_t binaryNode, std::span<const Vec3f> positions, std::span<const uint32_t> indices);
+		uint32_t addLeaf(const BVH& bvh, uint32_t beginSlot, uint32_t endSlot, std::span<const Vec3f> positions, std::span<const uint32_t> indices);
+
+		template<bool anyHit>
+		bool traceRay(const Ray& ray, float tMax, Hit* hit) const;
+		template<bool anyHit>
+		uint32_t tracePacket(std::span<const Ray> rays, float tMax, Hit* hits) const;
+
+		std::vector<Node> m_nodes;
+		std::vector<TrianglePacket> m_packets;
+		size_t m_numTriangles = 0;
+	};
+
+	namespace simd
+	{
+		// Möller-Trumbore for 8 ray/triangle pairs. Either side can be broadcast, to test one ray against 8 triangles
+		// or 8 rays against one triangle. Returns a lane mask with the pairs that hit in [0, tMax).
+		inline float8 intersectTriangle(
+			const Vec3f8& origin, const Vec3f8& direction,
+			const Vec3f8& v0, const Vec3f8& e1, const Vec3f8& e2,
+			const float8& tMax,
+			float8& t, float8& u, float8& v)
+		{
+			const float8 kEpsilon = 1e-8f;
+			Vec3f8 p = cross(direction, e2);
+			float8 det = dot(e1, p);
+			float8 valid = abs(det) >= kEpsilon; // Not parallel to the triangle
+			float8 invDet = float8(1.f) / det;
+			Vec3f8 s = origin - v0;
+			u = dot(s, p) * invDet;
+			valid = valid & (u >= float8::zero()) & (u <= float8(1.f));
+			Vec3f8 q = cross(s, e1);
+			v = dot(direction, q) * invDet;
+			valid = valid & (v >= float8::zero()) & (u + v <= float8(1.f));
+			t = dot(e2, q) * invDet;
+			return valid & (t >= float8::zero()) & (t < tMax);
+		}
+	}
+}
@@ -11,6 +11,7 @@
 #include <core/platform/fileSystem/fileSystem.h>
 #include <core/platform/fileSystem/FolderWatcher.h>
 #include <core/platform/cmdLineParser.h>
+#include <core/tasks/parallelFor.h>
 #include <core/tools/log.h>
 #include <input/pointingInput.h>
 
@@ -80,8 +81,10 @@ namespace rev {
 			"../shaders/",
 			envProbe
 		);
+		m_renderer.setRecordingPool(&core::defaultThreadPool());
 
 		m_loadedScene->updateDescriptorSet(m_renderer.batchDescriptorLayout());
+		m_loadedScene->updateCullingDescriptorSet(m_renderer.cullingDescriptorLayout());
 
 		return true;
 	}
@@ -141,6 +144,7 @@ namespace rev {
 
 		m_sceneGraphics.proj = mFlybyCam->projection(aspect);
 		m_sceneGraphics.view = mFlybyCam->view();
+		m_sceneGraphics.cullFrustum = mFlybyCam->world().matrix() * mFlybyCam->frustum(aspect);
 
 		ImGui_ImplWin32_NewFrame();
 		ImGui_ImplVulkan_NewFrame();
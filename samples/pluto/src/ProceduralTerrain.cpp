@@ -19,6 +19,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ProceduralTerrain.h"
 
+#include <core/tasks/parallelFor.h>
 #include <core/tools/profiler.h>
 #include <math/algebra/vector.h>
 #include <gfx/Image.h>
@@ -470,13 +471,15 @@ namespace rev
 		Vec3f size = bounds.size();
 		Vec3f cubeSide = { size.x() / resolution.x(), size.y() / resolution.y(), size.z() / resolution.z() };
 
-		// Pre-evaluate all densities
+		// Pre-evaluate all densities, one x slice per task
 		int numCorners = (resolution.x() + 1) * (resolution.y() + 1) * (resolution.z() + 1);
-		std::vector<float> sampledDensity; sampledDensity.reserve(numCorners);
-		Vec3f cellMin;
-		for (uint32_t i = 0; i <= resolution.x(); ++i) // x
+		std::vector<float> sampledDensity(numCorners);
+		const size_t sliceSize = size_t(resolution.y() + 1) * (resolution.z() + 1);
+		core::parallelFor(0, resolution.x() + 1, 1, [&](size_t i) // x
 		{
+			Vec3f cellMin;
 			cellMin.x() = i * cubeSide.x();
+			float* dst = &sampledDensity[i * sliceSize];
 			for (uint32_t j = 0; j <= resolution.y(); ++j) // y
 			{
 				cellMin.y() = j * cubeSide.y();
@@ -485,10 +488,11 @@ namespace rev
 					cellMin.z() = k * cubeSide.z();
 
 					Vec3f samplePosition = cellMin + bounds.min();
-					sampledDensity.push_back(density(samplePosition));
+					*dst++ = density(samplePosition);
 				}
 			}
-		}
+		});
+		Vec3f cellMin;
 
 		std::unordered_map<uint32_t, uint32_t> vertexDictionary;
 		vertexDictionary.reserve(numCorners);
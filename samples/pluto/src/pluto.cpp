@@ -27,6 +27,7 @@
 #include <core/platform/fileSystem/fileSystem.h>
 #include <core/platform/fileSystem/FolderWatcher.h>
 #include <core/platform/cmdLineParser.h>
+#include <core/tasks/parallelFor.h>
 #include <core/tools/log.h>
 #include <input/pointingInput.h>
 
@@ -100,8 +101,10 @@ namespace rev
 			"./shaders",
             nullptr
 		);
+		m_renderer.setRecordingPool(&core::defaultThreadPool());
 
 		m_opaqueGeometry->updateDescriptorSet(m_renderer.batchDescriptorLayout());
+		m_opaqueGeometry->updateCullingDescriptorSet(m_renderer.cullingDescriptorLayout());
 
 		return true;
 	}
@@ -145,6 +148,7 @@ namespace rev
 
 		m_sceneGraphics.proj = mFlybyCam->projection(aspect);
 		m_sceneGraphics.view = mFlybyCam->view();
+		m_sceneGraphics.cullFrustum = mFlybyCam->world().matrix() * mFlybyCam->frustum(aspect);
 
 		ImGui_ImplWin32_NewFrame();
 		ImGui_ImplVulkan_NewFrame();
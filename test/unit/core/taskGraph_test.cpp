@@ -0,0 +1,136 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Core unit testing
+// Task graphs
+//----------------------------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cassert>
+#include <vector>
+#include <core/tasks/taskGraph.h>
+
+using namespace rev::core;
+
+void testCycle()
+{
+	TaskGraph graph;
+	auto a = graph.addNode([]() {});
+	auto b = graph.addNode([]() {});
+	auto c = graph.addNode([]() {});
+	graph.addEdge(a, b);
+	graph.addEdge(b, c);
+	graph.addEdge(c, b);
+	assert(!graph.compile());
+	assert(!graph.isCompiled());
+
+	// Self loops are cycles too
+	TaskGraph selfLoop;
+	auto d = selfLoop.addNode([]() {});
+	selfLoop.addEdge(d, d);
+	assert(!selfLoop.compile());
+
+	// Modifying the graph invalidates the compilation
+	TaskGraph acyclic;
+	auto e = acyclic.addNode([]() {});
+	auto f = acyclic.addNode([]() {});
+	acyclic.addEdge(e, f);
+	assert(acyclic.compile());
+	acyclic.addEdge(f, e);
+	assert(!acyclic.isCompiled());
+	assert(!acyclic.compile());
+}
+
+// Every node records its position in the execution order
+struct OrderRecorder
+{
+	std::atomic<uint32_t> counter = 0;
+	std::vector<uint32_t> order;
+
+	explicit OrderRecorder(size_t numNodes) : order(numNodes, ~0u) {}
+
+	auto task(TaskGraph::NodeId node)
+	{
+		return [this, node]() { order[node] = counter++; };
+	}
+};
+
+void testDiamond(ThreadPool& pool)
+{
+	// top -> left, right -> bottom
+	TaskGraph graph;
+	OrderRecorder recorder(4);
+	auto top = graph.addNode(recorder.task(0));
+	auto left = graph.addNode(recorder.task(1));
+	auto right = graph.addNode(recorder.task(2));
+	auto bottom = graph.addNode(recorder.task(3));
+	graph.addEdge(top, left);
+	graph.addEdge(top, right);
+	graph.addEdge(left, bottom);
+	graph.addEdge(right, bottom);
+	assert(graph.compile());
+
+	graph.run(pool);
+	assert(recorder.counter == 4);
+	assert(recorder.order[top] < recorder.order[left]);
+	assert(recorder.order[top] < recorder.order[right]);
+	assert(recorder.order[left] < recorder.order[bottom]);
+	assert(recorder.order[right] < recorder.order[bottom]);
+	assert(graph.metrics().runTimes.size() == 4);
+}
+
+void testRerun(ThreadPool& pool)
+{
+	// A chain of fan outs: each layer depends on every node of the previous one
+	constexpr uint32_t kLayers = 8;
+	constexpr uint32_t kWidth = 16;
+	TaskGraph graph;
+	std::vector<std::atomic<uint32_t>> runs(kLayers * kWidth);
+	std::atomic<uint32_t> finishedPerLayer[kLayers] = {};
+	std::atomic<bool> orderViolated = false;
+	for (uint32_t layer = 0; layer < kLayers; ++layer)
+	{
+		for (uint32_t i = 0; i < kWidth; ++i)
+		{
+			const auto node = graph.addNode([&, layer, node = layer * kWidth + i]() {
+				// The whole previous layer must be done before any node of this one starts
+				if (layer > 0 && finishedPerLayer[layer - 1].load() % kWidth != 0)
+					orderViolated = true;
+				++runs[node];
+				++finishedPerLayer[layer];
+			});
+			if (layer > 0)
+			{
+				for (uint32_t j = 0; j < kWidth; ++j)
+					graph.addEdge((layer - 1) * kWidth + j, node);
+			}
+		}
+	}
+	assert(graph.compile());
+
+	// The same compiled graph runs many times, every node exactly once per run
+	constexpr uint32_t kRuns = 100;
+	for (uint32_t run = 0; run < kRuns; ++run)
+	{
+		graph.run(pool);
+		for (auto& count : runs)
+			assert(count == run + 1);
+	}
+	assert(!orderViolated);
+
+	// Recompiling after adding nodes keeps the graph usable
+	std::atomic<bool> extraRan = false;
+	auto extra = graph.addNode([&]() { extraRan = true; });
+	graph.addEdge(kLayers * kWidth - 1, extra);
+	assert(graph.compile());
+	graph.run(pool);
+	assert(extraRan);
+	for (auto& count : runs)
+		assert(count == kRuns + 1);
+}
+
+int main()
+{
+	testCycle();
+	ThreadPool pool(3);
+	testDiamond(pool);
+	testRerun(pool);
+	return 0;
+}
@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Game unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <game/animation/animator.h>
+#include <game/animation/skeleton.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+
+using namespace rev::game;
+using namespace rev::math;
+
+// Each channel holds a constant rotation around z, of (channel + 1) * 0.1 radians
+std::shared_ptr<rev::gfx::Animation> createAnimation(size_t numChannels)
+{
+	auto animation = std::make_shared<rev::gfx::Animation>();
+	for (size_t c = 0; c < numChannels; ++c)
+	{
+		auto& channel = animation->m_rotationChannels.emplace_back();
+		channel.t = { 0.f, 1.f };
+		const auto rotation = Quatf({ 0.f, 0.f, 1.f }, 0.1f * (c + 1));
+		channel.values = { rotation, rotation };
+	}
+	return animation;
+}
+
+float angle(const SceneNode& node)
+{
+	const auto rotation = node.component<Transform>()->xForm.rotation();
+	return 2.f * std::atan2(rotation.z(), rotation.w());
+}
+
+struct Rig
+{
+	Rig(size_t numJoints)
+	{
+		root = std::make_shared<SceneNode>("root");
+		for (size_t i = 0; i < numJoints; ++i)
+		{
+			joints.push_back(root->createChild("joint"));
+			joints.back()->addComponent<Transform>();
+		}
+		animator = root->addComponent<Animator>();
+	}
+
+	std::shared_ptr<SceneNode> root;
+	std::vector<std::shared_ptr<SceneNode>> joints;
+	Animator* animator;
+};
+
+void testChannelToJointMap()
+{
+	Rig rig(3);
+	// Channels ordered differently than joints, and one channel for a node outside the skeleton
+	auto animation = createAnimation(3);
+	animation->m_channelNodes = { 12, 10, 99 };
+	auto skeleton = std::make_shared<Skeleton>(rig.joints, std::vector<uint32_t>{ 10, 11, 12 });
+	const auto channelJoints = skeleton->channelJoints(*animation);
+	assert(channelJoints.size() == 3);
+	assert(channelJoints[0] == 2 && channelJoints[1] == 0 && channelJoints[2] == Skeleton::kNoJoint);
+
+	rig.animator->playAnimation(animation, true);
+	rig.animator->setSkeleton(skeleton);
+	rig.root->init();
+	rig.root->update(0.5f);
+	assert(std::abs(angle(*rig.joints[0]) - 0.2f) < 1e-5f);
+	assert(std::abs(angle(*rig.joints[1])) < 1e-5f); // Not animated. Keeps its reference pose
+	assert(std::abs(angle(*rig.joints[2]) - 0.1f) < 1e-5f);
+}
+
+void testMoreChannelsThanJoints()
+{
+	// Without node ids, channel i drives joint i, and extra channels are ignored
+	Rig rig(2);
+	auto animation = createAnimation(5);
+	auto skeleton = std::make_shared<Skeleton>(rig.joints);
+	rig.animator->playAnimation(animation, true);
+	rig.animator->setSkeleton(skeleton);
+	rig.root->init();
+	rig.root->update(0.5f);
+	assert(std::abs(angle(*rig.joints[0]) - 0.1f) < 1e-5f);
+	assert(std::abs(angle(*rig.joints[1]) - 0.2f) < 1e-5f);
+}
+
+int main()
+{
+	testChannelToJointMap();
+	testMoreChannelsThanJoints();
+	return 0;
+}
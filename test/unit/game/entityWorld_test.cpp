@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Game unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <core/tasks/threadPool.h>
+#include <game/animation/animator.h>
+#include <game/scene/ecs/entityWorld.h>
+#include <game/scene/ecs/sceneNodeAdapter.h>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+
+using namespace rev::game;
+using namespace rev::math;
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+struct Tag { uint32_t value; };
+struct Name { std::string value; }; // Not trivially movable
+struct alignas(64) Wide { float values[16]; };
+
+void testEntityLifetime()
+{
+	EntityWorld world;
+	auto a = world.create(Position{ 1.f, 2.f, 3.f }, Velocity{ 0.f, 1.f, 0.f });
+	auto b = world.create(Position{ 4.f, 5.f, 6.f });
+	auto c = world.create(Tag{ 7 }, Name{ "c" });
+	assert(world.size() == 3);
+	assert(world.numArchetypes() == 3);
+
+	assert(world.get<Position>(a)->x == 1.f);
+	assert(world.get<Velocity>(a)->y == 1.f);
+	assert(!world.get<Velocity>(b));
+	assert(world.get<Name>(c)->value == "c");
+
+	// Adding and removing components moves entities between archetypes, keeping their data
+	world.add(b, Velocity{ 2.f, 0.f, 0.f });
+	assert(world.numArchetypes() == 3); // Same types as a
+	assert(world.get<Position>(b)->z == 6.f);
+	assert(world.get<Velocity>(b)->x == 2.f);
+	world.add(b, Velocity{ 3.f, 0.f, 0.f }); // Replaces
+	assert(world.get<Velocity>(b)->x == 3.f);
+	world.remove<Position>(a);
+	assert(!world.get<Position>(a));
+	assert(world.get<Velocity>(a)->y == 1.f);
+	assert(world.get<Position>(b)->x == 4.f);
+	world.remove<Position>(a); // Nothing to remove
+
+	// Handles to destroyed entities are invalid, even when their slot is reused
+	world.destroy(c);
+	assert(!world.isAlive(c));
+	auto d = world.create(Name{ "d" });
+	assert(d.index == c.index && d.generation != c.generation);
+	assert(world.isAlive(d) && !world.isAlive(c));
+	assert(world.get<Name>(d)->value == "d");
+	assert(world.size() == 3);
+
+	// Over-aligned components
+	auto e = world.create(Wide{}, Tag{ 1 });
+	assert(reinterpret_cast<uintptr_t>(world.get<Wide>(e)) % 64 == 0);
+}
+
+void testManyEntities()
+{
+	EntityWorld world;
+	std::vector<Entity> entities;
+	auto shared = std::make_shared<int>(0);
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		if (i % 3 == 0)
+			entities.push_back(world.create(Tag{ i }, Position{ float(i), 0.f, 0.f }, std::shared_ptr<int>(shared)));
+		else
+			entities.push_back(world.create(Tag{ i }, Position{ float(i), 0.f, 0.f }));
+	}
+
+	// Removals and archetype changes shuffle rows around. Each entity must keep its own components
+	std::default_random_engine rng;
+	std::vector<bool> alive(entities.size(), true);
+	for (int i = 0; i < 8000; ++i)
+	{
+		const auto ndx = rng() % entities.size();
+		if (!alive[ndx])
+			continue;
+		if (i % 2)
+		{
+			world.destroy(entities[ndx]);
+			alive[ndx] = false;
+		}
+		else
+			world.add(entities[ndx], Velocity{ 1.f, 0.f, 0.f });
+	}
+	size_t numAlive = 0;
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		assert(world.isAlive(entities[i]) == alive[i]);
+		if (!alive[i])
+			continue;
+		++numAlive;
+		assert(world.get<Tag>(entities[i])->value == i);
+		assert(world.get<Position>(entities[i])->x == float(i));
+		assert((world.get<std::shared_ptr<int>>(entities[i]) != nullptr) == (i % 3 == 0));
+	}
+	assert(world.size() == numAlive);
+	size_t numShared = 0;
+	for (size_t i = 0; i < entities.size(); i += 3)
+		numShared += alive[i] ? 1 : 0;
+	assert(size_t(shared.use_count()) == numShared + 1); // Destroyed components released their references
+
+	// Queries visit every matching entity once
+	size_t numVisited = 0;
+	world.forEach<Tag, Position>([&](Entity entity, Tag& tag, Position& position) {
+		assert(entity == entities[tag.value]);
+		assert(position.x == float(tag.value));
+		++numVisited;
+	});
+	assert(numVisited == numAlive);
+
+	size_t numMoving = 0;
+	world.forEachChunk<Position, Velocity>([&](size_t count, Position* positions, Velocity* velocities) {
+		assert(count > 0);
+		for (size_t i = 0; i < count; ++i)
+			positions[i].y += velocities[i].x;
+		numMoving += count;
+	});
+	rev::core::ThreadPool pool(3);
+	world.parallelForEach<Position, Velocity>(pool, [](Position& position, const Velocity& velocity) {
+		position.y += velocity.x;
+	});
+	world.forEach<Position>([&](Position& position) {
+		if (position.y != 0.f)
+		{
+			assert(position.y == 2.f);
+			--numMoving;
+		}
+	});
+	assert(numMoving == 0);
+}
+
+void testSceneNodeImport()
+{
+	// Root, with a child without transform whose children have transforms
+	auto root = std::make_shared<SceneNode>("root");
+	root->addComponent<Transform>()->xForm.position() = Vec3f(1.f, 0.f, 0.f);
+	auto group = root->createChild("group");
+	auto a = group->createChild("a");
+	// Animated. The animator goes first so the node's transform sees this frame's pose
+	auto animator = a->addComponent<Animator>();
+	a->addComponent<Transform>(); // Animation only has rotation channels
+	auto b = a->createChild("b");
+	b->addComponent<Transform>()->xForm.position() = Vec3f(3.f, 0.f, 0.f);
+
+	auto animation = std::make_shared<rev::gfx::Animation>();
+	auto& channel = animation->m_rotationChannels.emplace_back();
+	channel.t = { 0.f, 1.f };
+	channel.values = { Quatf::identity(), Quatf({ 0.f, 0.f, 1.f }, HalfPi) };
+	animator->playAnimation(animation, true);
+	root->init();
+
+	EntityWorld world;
+	TransformHierarchy transforms;
+	const auto rootEntity = importSceneNodes(*root, world, transforms);
+	assert(world.size() == 4);
+	assert(world.get<SceneNodeRef>(rootEntity)->node == root.get());
+	assert(transforms.size() == 3);
+
+	// Same animation and world transforms as the scene nodes
+	const float dt = 0.25f;
+	root->update(dt);
+	updateAnimations(world, transforms, dt);
+	transforms.update();
+
+	size_t numTransforms = 0;
+	world.forEach<SceneNodeRef, TransformRef>([&](SceneNodeRef& ref, TransformRef& transform) {
+		const auto& expected = ref.node->component<Transform>()->absoluteXForm().matrix();
+		const auto& world = transforms.world(transform.node);
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 4; ++j)
+				assert(std::abs(world(i, j) - expected(i, j)) < 1e-5f);
+		++numTransforms;
+	});
+	assert(numTransforms == 3);
+
+	size_t numAnimated = 0;
+	world.forEach<AnimationPlayback>([&](AnimationPlayback& playback) {
+		assert(playback.time == dt);
+		++numAnimated;
+	});
+	assert(numAnimated == 1);
+}
+
+int main()
+{
+	testEntityLifetime();
+	testManyEntities();
+	testSceneNodeImport();
+	return 0;
+}
@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Game unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <game/application/frameStatistics.h>
+
+using namespace rev::game;
+
+FrameStatistics::Frame frame(float ms)
+{
+	FrameStatistics::Frame f;
+	f.updateMs = ms;
+	f.renderMs = 2 * ms;
+	f.totalMs = 3 * ms;
+	f.logicSteps = 1;
+	return f;
+}
+
+void testPercentiles()
+{
+	// Frames of 1 to 100 ms, shuffled. Nearest rank percentiles are exact on this set
+	FrameStatistics stats(100);
+	for (int i = 0; i < 100; ++i)
+		stats.addFrame(frame(float((i * 37) % 100 + 1)));
+
+	const auto update = stats.update();
+	assert(update.min == 1.f);
+	assert(update.max == 100.f);
+	assert(update.avg == 50.5f);
+	assert(update.p95 == 95.f);
+	assert(update.p99 == 99.f);
+	assert(stats.render().p95 == 190.f);
+	assert(stats.total().max == 300.f);
+
+	// Single frame
+	FrameStatistics single(8);
+	single.addFrame(frame(4.f));
+	const auto total = single.total();
+	assert(total.min == 12.f && total.p95 == 12.f && total.p99 == 12.f && total.max == 12.f);
+
+	// Empty
+	FrameStatistics empty(8);
+	assert(empty.update().max == 0.f);
+}
+
+void testRingWraparound()
+{
+	FrameStatistics stats(4);
+	for (int i = 1; i <= 10; ++i)
+	{
+		auto f = frame(float(i));
+		f.droppedSteps = i % 2;
+		f.hitIterationCap = i == 3;
+		stats.addFrame(f);
+	}
+
+	// Only the last 4 frames stay in the window, oldest first
+	assert(stats.historySize() == 4);
+	assert(stats.historyCapacity() == 4);
+	for (size_t i = 0; i < 4; ++i)
+		assert(stats.history(i).updateMs == float(7 + i));
+	assert(stats.update().min == 7.f);
+	assert(stats.update().max == 10.f);
+	assert(stats.update().avg == 8.5f);
+
+	// Counters cover the whole run
+	assert(stats.numFrames() == 10);
+	assert(stats.logicSteps() == 10);
+	assert(stats.droppedSteps() == 5);
+	assert(stats.iterationCapHits() == 1);
+
+	stats.clear();
+	assert(stats.historySize() == 0);
+	assert(stats.numFrames() == 0);
+	stats.addFrame(frame(1.f));
+	assert(stats.history(0).updateMs == 1.f);
+}
+
+void testCSV()
+{
+	FrameStatistics stats(2);
+	stats.addFrame(frame(1.f));
+	stats.addFrame(frame(2.f));
+	auto last = frame(3.f);
+	last.droppedSteps = 2;
+	last.hitIterationCap = true;
+	stats.addFrame(last);
+
+	// Frame numbers count from the start of the run, not the window
+	std::ostringstream out;
+	stats.writeCSV(out);
+	assert(out.str() ==
+		"frame,update_ms,render_ms,total_ms,logic_steps,dropped_steps,hit_cap\n"
+		"1,2,4,6,1,0,0\n"
+		"2,3,6,9,1,2,1\n");
+}
+
+int main()
+{
+	testPercentiles();
+	testRingWraparound();
+	testCSV();
+	return 0;
+}
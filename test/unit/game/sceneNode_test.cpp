@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Game unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <game/scene/sceneNode.h>
+#include <game/scene/transform/transform.h>
+
+using namespace rev::game;
+
+struct Health : Component
+{
+	Health(int _points = 0) : points(_points) {}
+	int points;
+};
+
+struct Armor : Component {};
+struct HeavyArmor : Armor {};
+
+void testComponentLookup()
+{
+	// Ids are stable per type
+	assert(componentTypeId<Health>() == componentTypeId<Health>());
+	assert(componentTypeId<Health>() != componentTypeId<Armor>());
+	assert(componentTypeId<Armor>() != componentTypeId<HeavyArmor>());
+	assert(componentTypeId<Health>() == componentTypeId(typeid(Health)));
+
+	SceneNode node;
+	assert(!node.component<Health>());
+	assert(node.componentMask() == 0);
+
+	auto health = node.addComponent<Health>(10);
+	node.addComponent<Health>(20); // Lookups keep returning the first one
+	auto transform = node.addComponent<Transform>();
+	assert(node.component<Health>() == health);
+	assert(node.component<Health>()->points == 10);
+	assert(node.component<Transform>() == transform);
+	assert(node.components().size() == 3);
+
+	// Exact types only, like the typeid comparison it replaces
+	node.addComponent(std::make_unique<HeavyArmor>());
+	assert(!node.component<Armor>());
+	assert(node.component<HeavyArmor>());
+	assert(node.component<HeavyArmor>()->node() == &node);
+
+	assert(node.hasComponents(componentMask<Health, Transform>()));
+	assert(!node.hasComponents(componentMask<Health, Armor>()));
+	assert(node.hasComponents(0));
+}
+
+void testFilteredTraversal()
+{
+	auto root = std::make_shared<SceneNode>("root");
+	root->addComponent<Transform>();
+	auto a = root->createChild("a");
+	a->addComponent<Transform>();
+	a->addComponent<Health>(5);
+	auto b = root->createChild("b");
+	b->addComponent<Health>(7);
+	auto c = a->createChild("c");
+	c->addComponent<Health>(1);
+	c->addComponent<Transform>();
+
+	size_t numVisited = 0;
+	root->traverseSubtree([&](SceneNode&) { ++numVisited; });
+	assert(numVisited == 4);
+
+	numVisited = 0;
+	root->traverseSubtree(componentMask<Transform>(), [&](SceneNode& node) {
+		assert(node.component<Transform>());
+		++numVisited;
+	});
+	assert(numVisited == 3);
+
+	int totalHealth = 0;
+	root->traverseComponents<Health, Transform>([&](SceneNode& node, Health& health, Transform& transform) {
+		assert(&health == node.component<Health>());
+		assert(&transform == node.component<Transform>());
+		totalHealth += health.points;
+	});
+	assert(totalHealth == 6); // a and c
+
+	// Components of a type no node has
+	numVisited = 0;
+	root->traverseComponents<Armor>([&](SceneNode&, Armor&) { ++numVisited; });
+	assert(numVisited == 0);
+}
+
+int main()
+{
+	testComponentLookup();
+	testFilteredTraversal();
+	return 0;
+}
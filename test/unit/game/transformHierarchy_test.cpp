@@ -0,0 +1,143 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Game unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <game/scene/transform/transformHierarchy.h>
+
+using namespace rev::game;
+using namespace rev::math;
+
+Mat44f translation(float x, float y, float z)
+{
+	Mat44f m = Mat44f::identity();
+	m(0, 3) = x;
+	m(1, 3) = y;
+	m(2, 3) = z;
+	return m;
+}
+
+bool approx(const Mat44f& a, const Mat44f& b)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			if (std::abs(a(i, j) - b(i, j)) > 1e-3f * (1.f + std::abs(b(i, j))))
+				return false;
+	return true;
+}
+
+// Reference world matrix, walking up the hierarchy
+Mat44f referenceWorld(const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node)
+{
+	Mat44f world = hierarchy.local(node);
+	for (auto parent = hierarchy.parent(node); parent != TransformHierarchy::kNoParent; parent = hierarchy.parent(parent))
+		world = hierarchy.local(parent) * world;
+	return world;
+}
+
+void checkWorldMatrices(const TransformHierarchy& hierarchy)
+{
+	for (TransformHierarchy::NodeId node = 0; node < hierarchy.size(); ++node)
+		assert(approx(hierarchy.world(node), referenceWorld(hierarchy, node)));
+}
+
+void testChain()
+{
+	TransformHierarchy hierarchy;
+	const auto root = hierarchy.addNode(translation(1.f, 0.f, 0.f));
+	const auto child = hierarchy.addNode(translation(0.f, 1.f, 0.f), root);
+	const auto grandChild = hierarchy.addNode(translation(0.f, 0.f, 1.f), child);
+	const auto sibling = hierarchy.addNode(translation(0.f, 2.f, 0.f), root);
+	assert(hierarchy.update() == 4);
+	assert(approx(hierarchy.world(grandChild), translation(1.f, 1.f, 1.f)));
+	assert(approx(hierarchy.world(sibling), translation(1.f, 2.f, 0.f)));
+
+	// Nothing changed
+	assert(hierarchy.update() == 0);
+
+	// Only the changed subtree is updated
+	hierarchy.setLocal(child, translation(0.f, 3.f, 0.f));
+	assert(hierarchy.update() == 2);
+	assert(approx(hierarchy.world(grandChild), translation(1.f, 3.f, 1.f)));
+	assert(approx(hierarchy.world(sibling), translation(1.f, 2.f, 0.f)));
+
+	hierarchy.setLocal(root, translation(2.f, 0.f, 0.f));
+	assert(hierarchy.update() == 4);
+	assert(approx(hierarchy.world(grandChild), translation(2.f, 3.f, 1.f)));
+
+	// Reparenting keeps ids
+	hierarchy.setParent(grandChild, sibling);
+	hierarchy.update();
+	assert(hierarchy.parent(grandChild) == sibling);
+	assert(approx(hierarchy.world(grandChild), translation(2.f, 2.f, 1.f)));
+	hierarchy.setParent(child, TransformHierarchy::kNoParent);
+	hierarchy.update();
+	assert(approx(hierarchy.world(child), translation(0.f, 3.f, 0.f)));
+	checkWorldMatrices(hierarchy);
+
+	hierarchy.clear();
+	assert(hierarchy.size() == 0);
+	assert(hierarchy.update() == 0);
+}
+
+void testRandomHierarchy()
+{
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> coord(-1.f, 1.f);
+	auto randomMatrix = [&]() {
+		Mat44f m = Mat44f::identity();
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 4; ++j)
+				m(i, j) = (i == j ? 1.f : 0.f) + 0.1f * coord(rng);
+		return m;
+	};
+
+	// Nodes added out of depth order
+	TransformHierarchy hierarchy;
+	const uint32_t numNodes = 2000;
+	for (uint32_t i = 0; i < numNodes; ++i)
+	{
+		const auto parent = (i == 0 || i % 97 == 0) ? TransformHierarchy::kNoParent : TransformHierarchy::NodeId(rng() % i);
+		assert(hierarchy.addNode(randomMatrix(), parent) == i);
+	}
+	assert(hierarchy.update() == numNodes);
+	checkWorldMatrices(hierarchy);
+
+	// Scattered changes
+	for (int round = 0; round < 10; ++round)
+	{
+		for (int i = 0; i < 20; ++i)
+			hierarchy.setLocal(TransformHierarchy::NodeId(rng() % numNodes), randomMatrix());
+		const auto numUpdated = hierarchy.update();
+		assert(numUpdated > 0 && numUpdated < numNodes);
+		checkWorldMatrices(hierarchy);
+	}
+
+	// Moving subtrees around
+	for (int i = 0; i < 50; ++i)
+	{
+		const auto node = TransformHierarchy::NodeId(rng() % numNodes);
+		auto parent = TransformHierarchy::NodeId(rng() % numNodes);
+		for (auto ancestor = parent; ancestor != TransformHierarchy::kNoParent; ancestor = hierarchy.parent(ancestor))
+			if (ancestor == node)
+				parent = TransformHierarchy::kNoParent; // Would make a cycle
+		hierarchy.setParent(node, parent);
+	}
+	hierarchy.update();
+	checkWorldMatrices(hierarchy);
+
+	// Growing a sorted hierarchy
+	const auto leaf = hierarchy.addNode(randomMatrix(), 5);
+	assert(hierarchy.update() >= 1);
+	assert(approx(hierarchy.world(leaf), referenceWorld(hierarchy, leaf)));
+	checkWorldMatrices(hierarchy);
+}
+
+int main()
+{
+	testChain();
+	testRandomHierarchy();
+	return 0;
+}
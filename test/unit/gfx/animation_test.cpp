@@ -0,0 +1,207 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Gfx unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <gfx/scene/animation/animation.h>
+#include <gfx/scene/animation/clipSampling.h>
+#include <math/cpuFeatures.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Keys at t = 0, 1, 2, ..., with the angle around z growing 0.01 radians per second
+Animation createAnimation(size_t numChannels, size_t numKeys)
+{
+	Animation animation;
+	for (size_t c = 0; c < numChannels; ++c)
+	{
+		auto& rotation = animation.m_rotationChannels.emplace_back();
+		auto& translation = animation.m_translationChannels.emplace_back();
+		for (size_t i = 0; i < numKeys; ++i)
+		{
+			rotation.t.push_back(float(i));
+			rotation.values.push_back(Quatf({ 0.f, 0.f, 1.f }, 0.01f * i));
+			translation.t.push_back(float(i));
+			translation.values.push_back(Vec3f(float(c), float(i), 0.f));
+		}
+	}
+	return animation;
+}
+
+void testFindKey()
+{
+	const std::vector<float> times = { 0.f, 0.5f, 1.f, 3.f, 4.f };
+	// Every hint gives the same result, including hints out of range
+	for (uint32_t hint = 0; hint < 8; ++hint)
+	{
+		assert(Animation::findKey(times, 0.f, hint) == 0);
+		assert(Animation::findKey(times, 0.25f, hint) == 0);
+		assert(Animation::findKey(times, 0.5f, hint) == 1);
+		assert(Animation::findKey(times, 2.f, hint) == 2);
+		assert(Animation::findKey(times, 3.f, hint) == 3);
+		assert(Animation::findKey(times, 3.99f, hint) == 3);
+	}
+}
+
+void testCursorPlayback()
+{
+	const auto animation = createAnimation(3, 100);
+	Animation::Cursor cursor;
+	Pose pose, expected;
+	// Forward, looping, and seeking back. The cursor must never change the sampled pose
+	const float times[] = { -1.f, 0.f, 0.3f, 0.6f, 2.2f, 7.9f, 50.5f, 98.9f, 99.f, 120.f, 0.1f, 30.f, 29.5f };
+	for (float t : times)
+	{
+		animation.getPose(t, pose, cursor);
+		animation.getPose(t, expected);
+		assert(pose.joints.size() == 3);
+		const float clamped = std::fmin(std::fmax(t, 0.f), 99.f);
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const auto& joint = pose.joints[c];
+			assert(joint.rotation == expected.joints[c].rotation);
+			assert(joint.translation == expected.joints[c].translation);
+			assert(std::abs(joint.translation.x() - float(c)) < 1e-5f);
+			assert(std::abs(joint.translation.y() - clamped) < 1e-4f);
+			// Angles interpolated between keys 0.01 radians apart stay close to linear
+			const float angle = 2.f * std::atan2(joint.rotation.z(), joint.rotation.w());
+			assert(std::abs(angle - 0.01f * clamped) < 1e-4f);
+		}
+	}
+}
+
+void testChannelPose()
+{
+	auto animation = createAnimation(2, 10);
+	Animation::Cursor cursor;
+	Pose::JointPose pose;
+	animation.getChannelPose(1, 4.5f, pose, cursor);
+	assert(cursor.rotationKeys.size() == 2 && cursor.rotationKeys[1] == 4);
+	assert(cursor.translationKeys[1] == 4);
+	assert(pose.translation == Vec3f(1.f, 4.5f, 0.f));
+	animation.getChannelPose(1, 5.5f, pose, cursor);
+	assert(cursor.rotationKeys[1] == 5);
+
+	// Channels without keys leave the pose untouched
+	animation.m_translationChannels[0] = {};
+	pose.translation = Vec3f(7.f, 7.f, 7.f);
+	animation.getChannelPose(0, 4.5f, pose);
+	assert(pose.translation == Vec3f(7.f, 7.f, 7.f));
+}
+
+// Random rotations and translations, with keys at different times on each channel.
+// Fewer translation channels than rotations, and a few channels without keys.
+Animation createRandomAnimation(size_t numChannels)
+{
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	Animation animation;
+	animation.m_rotationChannels.resize(numChannels);
+	animation.m_translationChannels.resize(numChannels - 2);
+	for (size_t c = 0; c < numChannels; ++c)
+	{
+		if (c % 5 == 3)
+			continue;
+		auto& rotation = animation.m_rotationChannels[c];
+		for (float t = 0.f; t < 10.f; t += 0.1f + 0.1f * float(c % 4))
+		{
+			rotation.t.push_back(t);
+			rotation.values.push_back(Quatf(normalize(Vec3f(unit(rng), unit(rng), unit(rng))), 4.f * unit(rng)));
+		}
+		if (c >= animation.m_translationChannels.size())
+			continue;
+		auto& translation = animation.m_translationChannels[c];
+		for (float t = 0.5f; t < 9.f; t += 0.3f)
+		{
+			translation.t.push_back(t);
+			translation.values.push_back(Vec3f(unit(rng), unit(rng), unit(rng)));
+		}
+	}
+	return animation;
+}
+
+bool approx(const Quatf& a, const Quatf& b, float tolerance)
+{
+	return std::abs(a.x() - b.x()) < tolerance && std::abs(a.y() - b.y()) < tolerance
+		&& std::abs(a.z() - b.z()) < tolerance && std::abs(a.w() - b.w()) < tolerance;
+}
+
+// Reference slerp along the shortest path
+Quatf slerp(const Quatf& a, const Quatf& b, float f)
+{
+	float cosTheta = a.x() * b.x() + a.y() * b.y() + a.z() * b.z() + a.w() * b.w();
+	const float sign = cosTheta < 0.f ? -1.f : 1.f;
+	cosTheta *= sign;
+	if (cosTheta > 0.99999f)
+		return Quatf::lerp(a, Quatf(sign * b.x(), sign * b.y(), sign * b.z(), sign * b.w()), f);
+	const float theta = std::acos(cosTheta);
+	const float w0 = std::sin((1 - f) * theta) / std::sin(theta);
+	const float w1 = sign * std::sin(f * theta) / std::sin(theta);
+	return Quatf(
+		w0 * a.x() + w1 * b.x(), w0 * a.y() + w1 * b.y(),
+		w0 * a.z() + w1 * b.z(), w0 * a.w() + w1 * b.w());
+}
+
+using SampleClipFn = std::function<void(const Animation&, float, Pose&, Animation::Cursor&, RotationInterpolation)>;
+
+void testSampleClip(const SampleClipFn& sampleClip)
+{
+	const auto animation = createRandomAnimation(21); // Not a multiple of 8 joints
+	Animation::Cursor cursor;
+	Pose pose, expected;
+	const Vec3f untouched = Vec3f(7.f, 7.f, 7.f);
+	for (float t = -0.5f; t < 11.f; t += 0.07f)
+	{
+		// Channels without keys keep their previous pose
+		pose.joints.resize(animation.m_rotationChannels.size());
+		for (auto& joint : pose.joints)
+		{
+			joint.rotation = Quatf::identity();
+			joint.translation = untouched;
+		}
+
+		sampleClip(animation, t, pose, cursor, RotationInterpolation::NLerp);
+		for (size_t c = 0; c < pose.joints.size(); ++c)
+		{
+			Pose::JointPose joint;
+			joint.rotation = Quatf::identity();
+			joint.translation = untouched;
+			animation.getChannelPose(c, t, joint);
+			assert(approx(pose.joints[c].rotation, joint.rotation, 1e-5f));
+			assert(std::abs(pose.joints[c].translation.x() - joint.translation.x()) < 1e-5f);
+			assert(std::abs(pose.joints[c].translation.y() - joint.translation.y()) < 1e-5f);
+			assert(std::abs(pose.joints[c].translation.z() - joint.translation.z()) < 1e-5f);
+		}
+		assert(pose.joints.back().translation == untouched);
+
+		sampleClip(animation, t, pose, cursor, RotationInterpolation::SLerp);
+		for (size_t c = 0; c < pose.joints.size(); ++c)
+		{
+			const auto& channel = animation.m_rotationChannels[c];
+			if (channel.t.empty())
+			{
+				assert(pose.joints[c].rotation == Quatf::identity());
+				continue;
+			}
+			if (t <= channel.t[0] || t >= channel.t.back())
+				continue;
+			const auto key = Animation::findKey(channel.t, t, 0);
+			const float f = (t - channel.t[key]) / (channel.t[key + 1] - channel.t[key]);
+			assert(approx(pose.joints[c].rotation, slerp(channel.values[key], channel.values[key + 1], f), 1e-5f));
+		}
+	}
+}
+
+int main()
+{
+	testFindKey();
+	testCursorPlayback();
+	testChannelPose();
+	testSampleClip(rev::gfx::scalar::sampleClip);
+	if (cpuFeatures().hasAVX2FMA())
+		testSampleClip(rev::gfx::avx2::sampleClip);
+	return 0;
+}
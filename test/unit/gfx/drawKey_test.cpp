@@ -0,0 +1,87 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Graphics unit testing
+// Draw sort keys
+//----------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+#include <gfx/renderer/DrawKey.h>
+
+using namespace rev::gfx;
+
+void testEncoding()
+{
+	const uint64_t key = DrawKey::encode(3, 1000, 4000, 200000, 65000);
+	assert(DrawKey::pipeline(key) == 3);
+	assert(DrawKey::descriptorSet(key) == 1000);
+	assert(DrawKey::geometry(key) == 4000);
+	assert(DrawKey::material(key) == 200000);
+	assert(DrawKey::depthBucket(key) == 65000);
+
+	// More expensive state takes precedence
+	assert(DrawKey::encode(1, 0, 0, 0, 0) > DrawKey::encode(0, 4095, 4095, 262143, 65535));
+	assert(DrawKey::encode(0, 1, 0, 0, 0) > DrawKey::encode(0, 0, 4095, 262143, 65535));
+	assert(DrawKey::encode(0, 0, 1, 0, 0) > DrawKey::encode(0, 0, 0, 262143, 65535));
+	assert(DrawKey::encode(0, 0, 0, 1, 0) > DrawKey::encode(0, 0, 0, 0, 65535));
+
+	// Out of range fields don't leak into their neighbours
+	assert(DrawKey::encode(0, 0, 0, 0, 1 << 16) == 0);
+	assert(DrawKey::encode(0, 0, 1 << 12, 0, 0) == 0);
+}
+
+void testDepthBuckets()
+{
+	assert(DrawKey::depthToBucket(0.f, 0.1f, 1000.f) == 0);
+	assert(DrawKey::depthToBucket(0.1f, 0.1f, 1000.f) == 0);
+	assert(DrawKey::depthToBucket(1000.f, 0.1f, 1000.f) == 65535);
+	assert(DrawKey::depthToBucket(1e9f, 0.1f, 1000.f) == 65535);
+
+	uint32_t lastBucket = 0;
+	for (float depth = 0.1f; depth < 1000.f; depth *= 1.01f)
+	{
+		const uint32_t bucket = DrawKey::depthToBucket(depth, 0.1f, 1000.f);
+		assert(bucket >= lastBucket);
+		lastBucket = bucket;
+	}
+}
+
+void testRadixSort()
+{
+	std::default_random_engine rng;
+	std::uniform_int_distribution<uint32_t> descriptorSets(0, 3);
+	std::uniform_int_distribution<uint32_t> materials(0, 100);
+	std::uniform_int_distribution<uint32_t> depths(0, 65535);
+
+	std::vector<SortedDraw> scratch;
+	for (uint32_t numDraws : { 0, 1, 2, 100, 10000 })
+	{
+		std::vector<SortedDraw> draws;
+		for (uint32_t i = 0; i < numDraws; ++i)
+			draws.push_back({ DrawKey::encode(0, descriptorSets(rng), 0, materials(rng), depths(rng) & 0xff00), i });
+
+		auto expected = draws;
+		std::stable_sort(expected.begin(), expected.end(), [](auto& a, auto& b) { return a.key < b.key; });
+
+		radixSort(draws, scratch);
+		assert(draws.size() == expected.size());
+		for (size_t i = 0; i < draws.size(); ++i)
+		{
+			assert(draws[i].key == expected[i].key);
+			assert(draws[i].drawNdx == expected[i].drawNdx); // Stable
+		}
+	}
+
+	// Keys that are all the same don't need any pass
+	std::vector<SortedDraw> sameKey = { { 7, 0 }, { 7, 1 }, { 7, 2 } };
+	radixSort(sameKey, scratch);
+	assert(sameKey[0].drawNdx == 0 && sameKey[1].drawNdx == 1 && sameKey[2].drawNdx == 2);
+}
+
+int main()
+{
+	testEncoding();
+	testDepthBuckets();
+	testRadixSort();
+	return 0;
+}
@@ -0,0 +1,189 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Graphics unit testing
+// Splitting the geometry pass in recording jobs, and skipping redundant binds. No command buffers are recorded.
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gfx/renderer/DrawKey.h>
+#include <gfx/renderer/DrawRecording.h>
+
+using namespace rev::gfx;
+
+void testJobRanges()
+{
+	const size_t kMinDraws = 512;
+	for (size_t numDraws : { 0, 1, 511, 512, 1023, 1024, 5000, 100000 })
+	{
+		for (size_t maxJobs : { 1, 3, 4, 16 })
+		{
+			const size_t numJobs = numRecordingJobs(numDraws, maxJobs, kMinDraws);
+			assert(numJobs <= maxJobs);
+			if (numJobs == 0)
+			{
+				assert(numDraws < kMinDraws);
+				continue;
+			}
+
+			// Contiguous ranges that cover all draws in order, each of them big enough and about the same size
+			size_t end = 0;
+			for (size_t job = 0; job < numJobs; ++job)
+			{
+				const auto [begin, jobEnd] = recordingJobRange(numDraws, numJobs, job);
+				assert(begin == end);
+				assert(jobEnd - begin >= kMinDraws);
+				assert(jobEnd - begin <= numDraws / numJobs + 1);
+				end = jobEnd;
+			}
+			assert(end == numDraws);
+		}
+	}
+}
+
+struct TestScene
+{
+	std::vector<char> buffers; // Stand in for GPUBuffers. Only their addresses are used
+	std::vector<RasterQueue::Batch> batches;
+	std::vector<uint32_t> drawBatch;
+	std::vector<SortedDraw> sortedDraws;
+	std::vector<RasterQueue::Batch> indirectBatches;
+};
+
+// Batches with a few descriptor sets and geometry buffers, shared in different combinations
+TestScene createScene(uint32_t numDraws)
+{
+	TestScene scene;
+	scene.buffers.resize(8);
+	auto buffer = [&](size_t i) { return reinterpret_cast<GPUBuffer*>(&scene.buffers[i]); };
+	const uint32_t kNumDescriptorSets = 3;
+	const uint32_t kNumGeometries = 2;
+	for (uint32_t i = 0; i < 12; ++i)
+	{
+		auto& batch = scene.batches.emplace_back();
+		const uint32_t geometry = (i / kNumDescriptorSets) % kNumGeometries;
+		batch.descriptorSet = vk::DescriptorSet(VkDescriptorSet(uintptr_t(1 + i % kNumDescriptorSets)));
+		batch.indexType = vk::IndexType::eUint32;
+		batch.indexBuffer = buffer(geometry);
+		batch.positionBinding = { buffer(2 + geometry), 0 };
+		batch.normalsBinding = { buffer(2 + geometry), 12 };
+		batch.tangentsBinding = { buffer(4 + geometry), 0 };
+		batch.texCoordBinding = { buffer(6 + geometry), 0 };
+	}
+	scene.indirectBatches.push_back(scene.batches[0]);
+	scene.indirectBatches.push_back(scene.batches[5]);
+
+	// Sorted like DeferredRenderer does, by descriptor set, then geometry, material and depth
+	std::default_random_engine rng;
+	std::uniform_int_distribution<uint32_t> batches(0, uint32_t(scene.batches.size() - 1));
+	std::uniform_int_distribution<uint32_t> materials(0, 50);
+	std::uniform_int_distribution<uint32_t> depths(0, 65535);
+	for (uint32_t i = 0; i < numDraws; ++i)
+	{
+		const uint32_t batchNdx = batches(rng);
+		scene.drawBatch.push_back(batchNdx);
+		const uint32_t descriptorSet = batchNdx % kNumDescriptorSets;
+		const uint32_t geometry = (batchNdx / kNumDescriptorSets) % kNumGeometries;
+		scene.sortedDraws.push_back({ DrawKey::encode(0, descriptorSet, geometry, materials(rng), depths(rng)), i });
+	}
+	std::vector<SortedDraw> scratch;
+	radixSort(scene.sortedDraws, scratch);
+	return scene;
+}
+
+// Same bind logic as DeferredRenderer::recordGeometryDraws, without the command buffer
+BindStats recordDraws(const TestScene& scene, size_t sortedBegin, size_t sortedEnd, bool withIndirectDraws)
+{
+	BindStats stats;
+	BatchBinder binder(stats);
+	stats.draws += uint32_t(sortedEnd - sortedBegin);
+	for (size_t i = sortedBegin; i < sortedEnd; ++i)
+		binder.bind(scene.batches[scene.drawBatch[scene.sortedDraws[i].drawNdx]]);
+	if (withIndirectDraws)
+	{
+		for (auto& batch : scene.indirectBatches)
+		{
+			binder.bind(batch);
+			++stats.indirectDraws;
+		}
+	}
+	return stats;
+}
+
+// Binds a command buffer needs for the draws, found by comparing the state of consecutive batches
+BindStats expectedStats(const TestScene& scene, size_t sortedBegin, size_t sortedEnd, bool withIndirectDraws)
+{
+	std::vector<const RasterQueue::Batch*> sequence;
+	for (size_t i = sortedBegin; i < sortedEnd; ++i)
+		sequence.push_back(&scene.batches[scene.drawBatch[scene.sortedDraws[i].drawNdx]]);
+	if (withIndirectDraws)
+		for (auto& batch : scene.indirectBatches)
+			sequence.push_back(&batch);
+
+	BindStats stats;
+	stats.draws = uint32_t(sortedEnd - sortedBegin);
+	stats.indirectDraws = withIndirectDraws ? uint32_t(scene.indirectBatches.size()) : 0;
+	const RasterQueue::Batch* last = nullptr;
+	for (auto batch : sequence)
+	{
+		if (batch == last)
+			continue;
+		const bool changed[3] = {
+			!last || !(last->descriptorSet == batch->descriptorSet),
+			!last || !sameIndexBuffer(*last, *batch),
+			!last || !sameVertexBuffers(*last, *batch)
+		};
+		for (bool c : changed)
+			++(c ? stats.binds : stats.skippedBinds);
+		last = batch;
+	}
+	return stats;
+}
+
+void assertEqual(const BindStats& a, const BindStats& b)
+{
+	assert(a.draws == b.draws);
+	assert(a.indirectDraws == b.indirectDraws);
+	assert(a.binds == b.binds);
+	assert(a.skippedBinds == b.skippedBinds);
+	assert(a.recordingJobs == b.recordingJobs);
+}
+
+void testJobBindStats()
+{
+	const uint32_t numDraws = 5000;
+	const auto scene = createScene(numDraws);
+
+	// Inline recording
+	const BindStats inlineStats = recordDraws(scene, 0, numDraws, true);
+	assertEqual(inlineStats, expectedStats(scene, 0, numDraws, true));
+	assert(inlineStats.skippedBinds > 0); // Sorting leaves consecutive batches sharing state
+
+	// Split in jobs, with only the last one recording indirect draws, like renderGeometryPass does
+	const size_t numJobs = numRecordingJobs(numDraws, 4, 512);
+	assert(numJobs == 4);
+	BindStats jobStats;
+	for (size_t job = 0; job < numJobs; ++job)
+	{
+		const auto [begin, end] = recordingJobRange(numDraws, numJobs, job);
+		const bool lastJob = job + 1 == numJobs;
+		const BindStats stats = recordDraws(scene, begin, end, lastJob);
+		assertEqual(stats, expectedStats(scene, begin, end, lastJob));
+		jobStats += stats;
+	}
+
+	// Every draw is recorded exactly once. Each job starts with nothing bound, so it may rebind up to the three
+	// pieces of state the previous job left bound
+	assert(jobStats.draws == inlineStats.draws);
+	assert(jobStats.indirectDraws == inlineStats.indirectDraws);
+	assert(jobStats.binds >= inlineStats.binds);
+	assert(jobStats.binds <= inlineStats.binds + 3 * (numJobs - 1));
+	assert(jobStats.binds + jobStats.skippedBinds >= inlineStats.binds + inlineStats.skippedBinds);
+}
+
+int main()
+{
+	testJobRanges();
+	testJobBindStats();
+	return 0;
+}
@@ -0,0 +1,476 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Graphics unit testing
+// These tests only exercise CPU side logic, and never create a render context.
+//----------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <core/tasks/threadPool.h>
+#include <gfx/renderer/RasterScene.h>
+#include <math/geometry/types.h>
+
+using namespace rev::gfx;
+using namespace rev::math;
+
+// Adds a mesh with numPrimitives single triangle primitives, each with its own material
+uint32_t addTestMesh(RasterHeap& heap, uint32_t numPrimitives)
+{
+	const Vec3f positions[3] = { Vec3f(0.f, 0.f, 0.f), Vec3f(1.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f) };
+	const Vec3f normals[3] = { Vec3f(0.f, 0.f, 1.f), Vec3f(0.f, 0.f, 1.f), Vec3f(0.f, 0.f, 1.f) };
+	const Vec4f tangents[3] = { Vec4f(1.f, 0.f, 0.f, 1.f), Vec4f(1.f, 0.f, 0.f, 1.f), Vec4f(1.f, 0.f, 0.f, 1.f) };
+	const Vec2f uvs[3] = { Vec2f(0.f, 0.f), Vec2f(1.f, 0.f), Vec2f(0.f, 1.f) };
+	const uint32_t indices[3] = { 0, 1, 2 };
+
+	RasterHeap::Mesh mesh;
+	for (uint32_t i = 0; i < numPrimitives; ++i)
+	{
+		uint32_t material = heap.addMaterial(PBRMaterial());
+		auto primitive = (uint32_t)heap.addPrimitiveData(3, positions, normals, tangents, uvs, 3, indices, material);
+		if (i == 0)
+			mesh.firstPrimitive = primitive;
+		mesh.endPrimitive = primitive + 1;
+	}
+	return (uint32_t)heap.addMesh(mesh);
+}
+
+// Adds a single primitive mesh with a grid of n x n quads, size units wide, on the XY plane and facing +Z
+uint32_t addGridMesh(RasterHeap& heap, uint32_t n, float size)
+{
+	std::vector<Vec3f> positions, normals;
+	std::vector<Vec4f> tangents;
+	std::vector<Vec2f> uvs;
+	for (uint32_t y = 0; y <= n; ++y)
+	{
+		for (uint32_t x = 0; x <= n; ++x)
+		{
+			uvs.push_back(Vec2f(float(x) / n, float(y) / n));
+			positions.push_back(Vec3f(uvs.back().x() * size, uvs.back().y() * size, 0.f));
+			normals.push_back(Vec3f(0.f, 0.f, 1.f));
+			tangents.push_back(Vec4f(1.f, 0.f, 0.f, 1.f));
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y < n; ++y)
+	{
+		for (uint32_t x = 0; x < n; ++x)
+		{
+			const uint32_t a = y * (n + 1) + x;
+			const uint32_t c = a + n + 1;
+			indices.insert(indices.end(), { a, a + 1, c, a + 1, c + 1, c });
+		}
+	}
+
+	RasterHeap::Mesh mesh;
+	mesh.firstPrimitive = (uint32_t)heap.addPrimitiveData(
+		(uint32_t)positions.size(), positions.data(), normals.data(), tangents.data(), uvs.data(),
+		(uint32_t)indices.size(), indices.data(), heap.addMaterial(PBRMaterial()));
+	mesh.endPrimitive = mesh.firstPrimitive + 1;
+	return (uint32_t)heap.addMesh(mesh);
+}
+
+// Tag each instance's matrix with its mesh and the order it was added in, to track it after sorting
+Mat44f instanceMatrix(uint32_t meshNdx, uint32_t instanceNdx)
+{
+	Mat44f m = Mat44f::identity();
+	m(0, 3) = float(meshNdx);
+	m(1, 3) = float(instanceNdx);
+	return m;
+}
+
+void testInstanceGrouping()
+{
+	RasterScene scene;
+	const uint32_t meshPrimitives[3] = { 1, 3, 2 };
+	uint32_t meshes[3];
+	for (int i = 0; i < 3; ++i)
+		meshes[i] = addTestMesh(scene.m_geometry, meshPrimitives[i]);
+
+	// Interleave instances of all meshes. Mesh 1 has no instances
+	const uint32_t instanceMeshes[] = { 2, 0, 2, 0, 0, 2, 0 };
+	uint32_t instanceNdx = 0;
+	for (auto mesh : instanceMeshes)
+		scene.addInstance(instanceMatrix(meshes[mesh], instanceNdx++), meshes[mesh]);
+
+	const auto& draws = scene.instancedDraws();
+	const auto& matrices = scene.instanceWorldMatrices();
+	assert(matrices.size() == std::size(instanceMeshes));
+
+	// One draw per primitive of each instanced mesh, instead of one per instance and primitive
+	assert(draws.size() == meshPrimitives[0] + meshPrimitives[2]);
+
+	uint32_t drawnInstances = 0;
+	for (auto& draw : draws)
+	{
+		assert(draw.instanceOffset + draw.numInstances <= matrices.size());
+		const float meshNdx = matrices[draw.instanceOffset](0, 3);
+		for (uint32_t i = draw.instanceOffset; i < draw.instanceOffset + draw.numInstances; ++i)
+		{
+			assert(matrices[i](0, 3) == meshNdx); // Contiguous instances of the same mesh
+			if (i > draw.instanceOffset)
+				assert(matrices[i](1, 3) > matrices[i - 1](1, 3)); // Stable
+		}
+
+		const auto& mesh = scene.m_geometry.mesh(uint32_t(meshNdx));
+		bool isMeshPrimitive = false;
+		for (uint32_t p = mesh.firstPrimitive; p != mesh.endPrimitive; ++p)
+		{
+			auto& primitive = scene.m_geometry.getPrimitiveById(p);
+			if (primitive.indexOffset == draw.indexOffset)
+			{
+				isMeshPrimitive = true;
+				assert(primitive.materialNdx == draw.materialIndex);
+				assert(primitive.numIndices == draw.numIndices);
+				assert(primitive.vtxOffset == draw.vtxOffset);
+			}
+		}
+		assert(isMeshPrimitive);
+		drawnInstances += draw.numInstances;
+	}
+	// Every instance is drawn once per primitive of its mesh
+	assert(drawnInstances == 4 * meshPrimitives[0] + 3 * meshPrimitives[2]);
+
+	// Adding instances invalidates the draw list
+	scene.addInstance(instanceMatrix(meshes[1], instanceNdx++), meshes[1]);
+	assert(scene.instancedDraws().size() == meshPrimitives[0] + meshPrimitives[1] + meshPrimitives[2]);
+
+	scene.clearInstances();
+	assert(scene.instancedDraws().empty());
+}
+
+void testManyInstances()
+{
+	// A forest of identical meshes becomes a single draw
+	RasterScene scene;
+	uint32_t tree = addTestMesh(scene.m_geometry, 1);
+	for (uint32_t i = 0; i < 10000; ++i)
+		scene.addInstance(instanceMatrix(tree, i), tree);
+
+	const auto& draws = scene.instancedDraws();
+	assert(draws.size() == 1);
+	assert(draws[0].instanceOffset == 0);
+	assert(draws[0].numInstances == 10000);
+}
+
+void testFrustumCulling()
+{
+	RasterScene scene;
+	const uint32_t meshPrimitives[2] = { 2, 1 };
+	const uint32_t meshes[2] = { addTestMesh(scene.m_geometry, meshPrimitives[0]), addTestMesh(scene.m_geometry, meshPrimitives[1]) };
+
+	// Mesh bounds come from the vertices of their primitives
+	const AABB meshBounds = scene.m_geometry.meshBounds(meshes[0]);
+	assert(meshBounds.min() == Vec3f(0.f, 0.f, 0.f));
+	assert(meshBounds.max() == Vec3f(1.f, 1.f, 0.f));
+
+	// Grid of instances around a camera at the origin looking down -Z
+	uint32_t instanceNdx = 0;
+	for (int z = -30; z <= 30; z += 3)
+	{
+		for (int x = -30; x <= 30; x += 3)
+		{
+			Mat44f m = Mat44f::identity();
+			m(0, 3) = float(x);
+			m(2, 3) = float(z);
+			scene.addInstance(m, meshes[instanceNdx++ % 2]);
+		}
+	}
+
+	const Frustum frustum(1.f, HalfPi, 0.1f, 20.f);
+	std::vector<RasterQueue::Draw> draws;
+	scene.visibleDraws(frustum, draws);
+
+	// Visible instances have their matrices compacted, in the same order as all instances
+	const auto& matrices = scene.instanceWorldMatrices();
+	const auto& bounds = scene.instanceWorldBounds();
+	assert(bounds.size() == matrices.size());
+	std::vector<uint32_t> visible;
+	for (uint32_t i = 0; i < matrices.size(); ++i)
+		if (intersect(frustum, bounds[i]))
+			visible.push_back(i);
+	assert(!visible.empty() && visible.size() < matrices.size());
+	const auto& visibleMatrices = scene.visibleWorldMatrices();
+	assert(visibleMatrices.size() == visible.size());
+	for (uint32_t i = 0; i < visible.size(); ++i)
+		assert(visibleMatrices[i] == matrices[visible[i]]);
+
+	// Culled instances are scattered, but each mesh still gets a single draw per primitive
+	assert(draws.size() == meshPrimitives[0] + meshPrimitives[1]);
+
+	// Each visible instance is drawn once per primitive of its mesh
+	std::vector<uint32_t> timesDrawn(visible.size(), 0);
+	for (auto& draw : draws)
+	{
+		for (uint32_t i = draw.instanceOffset; i < draw.instanceOffset + draw.numInstances; ++i)
+			++timesDrawn[i];
+	}
+	for (uint32_t i = 0; i < visible.size(); ++i)
+	{
+		const bool isMesh0 = visible[i] < (matrices.size() + 1) / 2; // Sorted by mesh
+		assert(timesDrawn[i] == meshPrimitives[isMesh0 ? 0 : 1]);
+	}
+
+	// Culling in world space, with the camera turned around
+	Mat44f turnAround = Mat44f::identity();
+	turnAround(0, 0) = -1.f;
+	turnAround(2, 2) = -1.f;
+	std::vector<RasterQueue::Draw> turnedDraws;
+	scene.visibleDraws(turnAround * frustum, turnedDraws);
+	assert(!turnedDraws.empty());
+	for (auto& draw : turnedDraws)
+		assert(scene.visibleWorldMatrices()[draw.instanceOffset](2, 3) >= 0.f);
+
+	// Adding instances invalidates the cached bounds
+	Mat44f inFront = Mat44f::identity();
+	inFront(2, 3) = -100.f;
+	scene.addInstance(inFront, meshes[1]);
+	rev::core::ThreadPool pool(3);
+	scene.setCullingPool(&pool);
+	assert(scene.instanceWorldBounds().size() == instanceNdx + 1);
+	for (uint32_t i = 0; i < bounds.size(); ++i)
+		assert(scene.instanceWorldBounds()[i].min() == (scene.instanceWorldMatrices()[i] * meshBounds).min());
+	scene.visibleDraws(Frustum(1.f, HalfPi, 50.f, 200.f), draws);
+	assert(draws.size() == 1);
+	assert(draws[0].numInstances == 1);
+	assert(scene.visibleWorldMatrices()[draws[0].instanceOffset](2, 3) == -100.f);
+	assert(std::abs(draws[0].depth - 100.f) < 1e-3f); // Distance to the instance center
+}
+
+void testInstanceTransforms()
+{
+	RasterScene scene;
+	const uint32_t meshes[2] = { addTestMesh(scene.m_geometry, 1), addTestMesh(scene.m_geometry, 2) };
+
+	// Ids follow insertion order, even though instances get sorted by mesh
+	std::vector<uint32_t> ids;
+	const uint32_t instanceMeshes[] = { 1, 0, 1, 0 };
+	for (uint32_t i = 0; i < std::size(instanceMeshes); ++i)
+		ids.push_back(scene.addInstance(instanceMatrix(meshes[instanceMeshes[i]], i), meshes[instanceMeshes[i]]));
+	for (uint32_t i = 0; i < ids.size(); ++i)
+		assert(ids[i] == i);
+
+	// Moving an instance before sorting
+	Mat44f moved = instanceMatrix(meshes[1], 0);
+	moved(2, 3) = 5.f;
+	scene.setInstanceTransform(ids[0], moved);
+
+	const auto draws = scene.instancedDraws();
+	const auto& matrices = scene.instanceWorldMatrices();
+	auto findInstance = [&](uint32_t instanceNdx) {
+		for (uint32_t i = 0; i < matrices.size(); ++i)
+			if (matrices[i](1, 3) == float(instanceNdx))
+				return i;
+		assert(false);
+		return uint32_t(-1);
+	};
+	assert(matrices[findInstance(0)](2, 3) == 5.f);
+
+	// Moving instances after sorting keeps the draws, and updates cached bounds in place
+	const auto meshBounds = scene.m_geometry.meshBounds(meshes[0]);
+	assert(scene.instanceWorldBounds().size() == ids.size());
+	for (uint32_t i = 0; i < ids.size(); ++i)
+	{
+		Mat44f m = instanceMatrix(meshes[instanceMeshes[i]], i);
+		m(2, 3) = -10.f * float(i);
+		scene.setInstanceTransform(ids[i], m);
+	}
+	assert(scene.instancedDraws().size() == draws.size());
+	for (uint32_t i = 0; i < ids.size(); ++i)
+	{
+		const uint32_t slot = findInstance(i);
+		assert(matrices[slot](2, 3) == -10.f * float(i));
+		assert(scene.instanceWorldBounds()[slot].min() == (matrices[slot] * meshBounds).min());
+	}
+}
+
+void testMeshletCulling()
+{
+	RasterScene scene;
+	const uint32_t grid = addGridMesh(scene.m_geometry, 64, 4.f);
+	const uint32_t triangle = addTestMesh(scene.m_geometry, 1);
+	const auto& primitive = scene.m_geometry.getPrimitiveById(scene.m_geometry.mesh(grid).firstPrimitive);
+	const auto meshlets = scene.m_geometry.meshMeshlets(grid);
+	assert(meshlets.end - meshlets.begin > 8); // Large enough to be culled per meshlet
+	assert(scene.m_geometry.meshMeshlets(triangle).end - scene.m_geometry.meshMeshlets(triangle).begin == 1);
+
+	// Facing the camera, facing away, half out of the frustum, mirrored and stretched.
+	// Mirroring in z keeps the vertices in place but flips the winding, so the grid still faces the camera, even
+	// though its transformed normals point away. Stretching a grid that faces away doesn't make it face the camera.
+	Mat44f facing = Mat44f::identity();
+	facing(2, 3) = -10.f;
+	Mat44f away = facing;
+	away(0, 0) = -1.f;
+	away(2, 2) = -1.f;
+	Mat44f clipped = facing;
+	clipped(0, 3) = 8.f;
+	clipped(1, 3) = -2.f;
+	Mat44f mirrored = facing;
+	mirrored(2, 2) = -1.f;
+	Mat44f stretched = away;
+	stretched(1, 1) = 2.f;
+	const Mat44f instances[] = { facing, away, clipped, mirrored, stretched };
+	for (uint32_t i = 0; i < std::size(instances); ++i)
+		assert(scene.addInstance(instances[i], grid) == i);
+	scene.addInstance(facing, triangle);
+
+	const Frustum frustum(1.f, HalfPi, 0.1f, 20.f);
+	std::vector<RasterQueue::Draw> draws;
+	auto drawGrids = [&]() {
+		scene.visibleDraws(frustum, draws);
+		// Instances of the same mesh are sorted in the order they were added, and all of them pass frustum culling
+		assert(scene.visibleWorldMatrices().size() == std::size(instances) + 1);
+		std::vector<uint32_t> drawnIndices(std::size(instances), 0);
+		for (auto& draw : draws)
+		{
+			assert(draw.numInstances == 1);
+			if (draw.vtxOffset != primitive.vtxOffset)
+				continue; // The small mesh
+			// Meshlet draws stay within the primitive
+			assert(draw.indexOffset >= primitive.indexOffset);
+			assert(draw.indexOffset + draw.numIndices <= primitive.indexOffset + primitive.numIndices);
+			assert(draw.numIndices % 3 == 0);
+			drawnIndices[draw.instanceOffset] += draw.numIndices;
+		}
+		return drawnIndices;
+	};
+
+	// The gbuffer pipeline draws back faces, so by default meshlets are only culled against the frustum
+	assert(!scene.backFaceCulling());
+	auto drawnIndices = drawGrids();
+	assert(drawnIndices[0] == primitive.numIndices); // Fully visible, with no index drawn twice
+	assert(drawnIndices[1] == primitive.numIndices);
+	assert(drawnIndices[2] > 0 && drawnIndices[2] < primitive.numIndices);
+	assert(drawnIndices[3] == primitive.numIndices);
+	assert(drawnIndices[4] == primitive.numIndices);
+
+	// Back face culling only applies to instances that keep their normal cones
+	scene.setBackFaceCulling(true);
+	drawnIndices = drawGrids();
+	assert(drawnIndices[0] == primitive.numIndices);
+	assert(drawnIndices[1] == 0); // Back facing
+	assert(drawnIndices[2] > 0 && drawnIndices[2] < primitive.numIndices);
+	assert(drawnIndices[3] == primitive.numIndices); // Mirrored
+	assert(drawnIndices[4] == primitive.numIndices); // Stretched
+
+	// Visible meshlets are merged into as few draws as their order allows
+	size_t facingDraws = 0;
+	for (auto& draw : draws)
+		facingDraws += (draw.instanceOffset == 0) ? 1 : 0;
+	assert(facingDraws == 1);
+}
+
+// Marks the indices drawn for each instance with the vertex offset and material they're drawn with
+struct DrawnIndices
+{
+	struct Index
+	{
+		uint32_t vtxOffset;
+		uint32_t materialIndex;
+		uint32_t timesDrawn = 0;
+		bool operator==(const Index&) const = default;
+	};
+
+	DrawnIndices(size_t numInstances, size_t numIndices)
+		: instances(numInstances, std::vector<Index>(numIndices))
+	{}
+
+	void add(uint32_t instance, const RasterQueue::Draw& draw)
+	{
+		for (uint32_t i = draw.indexOffset; i < draw.indexOffset + draw.numIndices; ++i)
+		{
+			auto& index = instances[instance][i];
+			index.vtxOffset = draw.vtxOffset;
+			index.materialIndex = draw.materialIndex;
+			++index.timesDrawn;
+		}
+	}
+
+	std::vector<std::vector<Index>> instances;
+};
+
+void testCullingTemplates()
+{
+	RasterScene scene;
+	const uint32_t grid = addGridMesh(scene.m_geometry, 64, 4.f);
+	const uint32_t triangles = addTestMesh(scene.m_geometry, 3);
+	assert(grid < triangles); // So grid instances get sorted first
+
+	// Instances in front of and behind a camera looking down -Z, facing either way, and some of them mirrored
+	const uint32_t numInstances = 16;
+	for (uint32_t i = 0; i < numInstances; ++i)
+	{
+		Mat44f m = Mat44f::identity();
+		if (i % 3 == 1)
+		{
+			m(0, 0) = -1.f;
+			m(2, 2) = -1.f;
+		}
+		if (i % 5 == 2)
+			m(2, 2) = -m(2, 2);
+		m(0, 3) = 4.f * float(i % 4) - 8.f;
+		m(2, 3) = i < 12 ? -10.f : 10.f;
+		scene.addInstance(m, i % 2 ? grid : triangles);
+	}
+
+	RasterScene::CullingTemplates templates;
+	scene.buildCullingTemplates(templates);
+	const auto& ranges = templates.meshDrawRanges;
+	assert(ranges.size() == 2 * scene.m_geometry.numMeshes());
+	assert(templates.drawBounds.size() == templates.drawTemplates.size());
+	assert(ranges[2 * grid + 1] - ranges[2 * grid] == scene.m_geometry.meshMeshlets(grid).end - scene.m_geometry.meshMeshlets(grid).begin);
+	assert(ranges[2 * triangles + 1] - ranges[2 * triangles] == 3); // One per primitive
+	uint32_t numIndices = 0;
+	for (auto& draw : templates.drawTemplates)
+		numIndices = std::max(numIndices, draw.indexOffset + draw.numIndices);
+
+	const Frustum frustum(1.f, HalfPi, 0.1f, 20.f);
+	std::vector<RasterQueue::Draw> draws;
+	for (bool cullBackFaces : { false, true })
+	{
+		scene.setBackFaceCulling(cullBackFaces);
+		scene.visibleDraws(frustum, draws);
+		const auto numVisible = scene.visibleWorldMatrices().size();
+		assert(numVisible > 0 && numVisible < numInstances);
+
+		// Replay cullInstances.comp on the CPU. Visible instances are numbered in order, like compacted matrices
+		DrawnIndices gpuDrawn(numVisible, numIndices);
+		const auto& matrices = scene.instanceWorldMatrices();
+		const auto& bounds = scene.instanceWorldBounds();
+		uint32_t visibleNdx = 0;
+		for (uint32_t i = 0; i < numInstances; ++i)
+		{
+			if (!intersect(frustum, bounds[i]))
+				continue;
+			const uint32_t meshNdx = i < numInstances / 2 ? grid : triangles;
+			for (uint32_t t = ranges[2 * meshNdx]; t != ranges[2 * meshNdx + 1]; ++t)
+			{
+				// Instances that can't be culled by facing are uploaded without kCullBackFaces
+				auto drawBounds = matrices[i] * templates.drawBounds[t];
+				if (!cullBackFaces || !preservesNormalCone(matrices[i]))
+					drawBounds.coneCutoff = 1.f;
+				if (isMeshletVisible(drawBounds, frustum, frustum.origin()))
+					gpuDrawn.add(visibleNdx, templates.drawTemplates[t]);
+			}
+			++visibleNdx;
+		}
+		assert(visibleNdx == numVisible);
+
+		// Must draw the same triangles of the same instances as CPU culling
+		DrawnIndices cpuDrawn(numVisible, numIndices);
+		for (auto& draw : draws)
+			for (uint32_t i = draw.instanceOffset; i < draw.instanceOffset + draw.numInstances; ++i)
+				cpuDrawn.add(i, draw);
+		assert(cpuDrawn.instances == gpuDrawn.instances);
+	}
+}
+
+int main()
+{
+	testInstanceGrouping();
+	testManyInstances();
+	testFrustumCulling();
+	testInstanceTransforms();
+	testMeshletCulling();
+	testCullingTemplates();
+	return 0;
+}
@@ -2,11 +2,18 @@
 // Math unit testing
 //----------------------------------------------------------------------------------------------------------------------
 #include <cassert>
+#include <random>
+#include <core/tasks/threadPool.h>
 #include <math/algebra/vector.h>
 #include <math/algebra/matrix.h>
 #include <math/algebra/affineTransform.h>
 #include <math/geometry/aabb.h>
+#include <math/geometry/bvh.h>
+#include <math/geometry/frustumCulling.h>
+#include <math/geometry/kdtree.h>
+#include <math/geometry/meshlet.h>
 #include <math/geometry/types.h>
+#include <math/geometry/wideBVH.h>
 #include <math/numericTraits.h>
 
 using namespace rev::math;
@@ -16,6 +23,13 @@ bool approx(const Vec3f& a, const Vec3f& b)
 	return (1 - dot(a, b)) < 1e-5f;
 }
 
+// Hit distances computed along different code paths may round differently, e.g. when the compiler contracts some
+// of the expressions into FMAs but not others
+bool approxDistance(float a, float b)
+{
+	return std::abs(a - b) <= 1e-5f * std::max(1.f, std::abs(b));
+}
+
 void testAABBTransform()
 {
 	AABB aabb(-Vec3f::ones(), Vec3f::ones());
@@ -104,9 +118,419 @@ void testFrustumCulling()
 	}
 }
 
+void testBatchFrustumCulling()
+{
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> position(-20.f, 20.f);
+	std::uniform_real_distribution<float> halfSize(0.f, 3.f);
+	std::vector<AABB> boxes;
+	for (int i = 0; i < 40000 + 5; ++i) // Not a multiple of the pack size
+	{
+		Vec3f center(position(rng), position(rng), position(rng));
+		Vec3f half(halfSize(rng), halfSize(rng), halfSize(rng));
+		boxes.emplace_back(center - half, center + half);
+	}
+	boxes.push_back(AABB()); // Empty box
+
+	Frustum frustum = Frustum(1.5f, HalfPi, 1.f, 15.f);
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < boxes.size(); ++i)
+		if (intersect(frustum, boxes[i]))
+			expected.push_back(i);
+	assert(!expected.empty() && expected.size() < boxes.size());
+
+	std::vector<uint32_t> visible;
+	cullAABBs(frustum, boxes, visible);
+	assert(visible == expected);
+
+	AABBSoA soa(boxes);
+	assert(soa.size() == boxes.size());
+	cullAABBs(frustum, soa, visible);
+	assert(visible == expected);
+
+	rev::core::ThreadPool pool(3);
+	cullAABBs(frustum, boxes, visible, &pool);
+	assert(visible == expected);
+	cullAABBs(frustum, soa, visible, &pool);
+	assert(visible == expected);
+}
+
+void testBVH()
+{
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> position(-20.f, 20.f);
+	std::uniform_real_distribution<float> halfSize(0.f, 1.f);
+	std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+	std::vector<AABB> boxes;
+	for (int i = 0; i < 10000; ++i)
+	{
+		Vec3f center(position(rng), position(rng), position(rng));
+		Vec3f half(halfSize(rng), halfSize(rng), halfSize(rng));
+		boxes.emplace_back(center - half, center + half);
+	}
+
+	// Triangle soup with shared vertices
+	std::vector<Vec3f> positions;
+	for (int i = 0; i < 6000; ++i)
+		positions.emplace_back(position(rng), position(rng), position(rng));
+	std::uniform_int_distribution<uint32_t> vertex(0, uint32_t(positions.size() - 1));
+	std::vector<uint32_t> indices;
+	for (int i = 0; i < 3 * 8000; ++i)
+		indices.push_back(vertex(rng));
+
+	std::vector<Ray> rays;
+	for (int i = 0; i < 500; ++i)
+	{
+		Vec3f dir(direction(rng), direction(rng), direction(rng));
+		rays.emplace_back(Vec3f(position(rng), position(rng), position(rng)), normalize(dir));
+	}
+	const float tMax = 30.f;
+
+	rev::core::ThreadPool pool(3);
+	for (auto* threads : { (rev::core::ThreadPool*)nullptr, &pool })
+	{
+		BVH::BuildOptions options;
+		options.pool = threads;
+
+		BVH boxBVH;
+		boxBVH.build(boxes, options);
+		assert(boxBVH.numPrimitives() == boxes.size());
+		assert(boxBVH.depth() <= BVH::kMaxDepth);
+		for (auto& ray : rays)
+		{
+			float closest = tMax;
+			bool expected = false;
+			for (auto& box : boxes)
+			{
+				float tEnter;
+				if (box.intersect(ray.implicit(), tMax, tEnter))
+				{
+					expected = true;
+					closest = std::min(closest, tEnter);
+				}
+			}
+			BVH::Hit hit;
+			assert(boxBVH.closestHit(ray, tMax, hit) == expected);
+			assert(boxBVH.anyHit(ray, tMax) == expected);
+			if (expected)
+			{
+				float tEnter;
+				assert(approxDistance(hit.t, closest));
+				assert(boxes[hit.primitive].intersect(ray.implicit(), tMax, tEnter) && approxDistance(tEnter, closest));
+			}
+		}
+
+		TriangleBVH meshBVH;
+		meshBVH.build(positions, indices, options);
+		assert(meshBVH.numTriangles() == indices.size() / 3);
+		WideBVH wideBVH;
+		wideBVH.build(positions, indices, options);
+		assert(wideBVH.numTriangles() == indices.size() / 3);
+		size_t numHits = 0;
+		for (size_t r = 0; r < rays.size(); ++r)
+		{
+			auto& ray = rays[r];
+			float closest = tMax;
+			bool expected = false;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const Vec3f& v0 = positions[indices[i]];
+				float t, u, v;
+				if (intersectTriangle(ray.origin(), ray.direction(), v0, positions[indices[i + 1]] - v0, positions[indices[i + 2]] - v0, t, u, v)
+					&& t >= 0.f && t < closest)
+				{
+					expected = true;
+					closest = t;
+				}
+			}
+			TriangleBVH::Hit hit;
+			assert(meshBVH.closestHit(ray, tMax, hit) == expected);
+			assert(meshBVH.anyHit(ray, tMax) == expected);
+			if (expected)
+			{
+				assert(approxDistance(hit.t, closest));
+				assert(hit.primitive < indices.size() / 3);
+				++numHits;
+			}
+
+			// Same queries through the wide BVH, one ray at a time and in packets. SIMD and scalar code can round
+			// differently, so hit distances are only approximate
+			WideBVH::Hit wideHit;
+			assert(wideBVH.closestHit(ray, tMax, wideHit) == expected);
+			assert(wideBVH.anyHit(ray, tMax) == expected);
+			if (expected)
+				assert(std::abs(wideHit.t - closest) < 1e-4f);
+			if (r % WideBVH::kWidth == 0)
+			{
+				auto packet = std::span(rays).subspan(r, std::min<size_t>(WideBVH::kWidth, rays.size() - r));
+				WideBVH::Hit packetHits[WideBVH::kWidth];
+				uint32_t hitMask = wideBVH.closestHit(packet, tMax, packetHits);
+				assert(wideBVH.anyHit(packet, tMax) == hitMask);
+				for (size_t i = 0; i < packet.size(); ++i)
+				{
+					WideBVH::Hit single;
+					bool singleHit = wideBVH.closestHit(packet[i], tMax, single);
+					assert(singleHit == ((hitMask >> i) & 1));
+					assert(!singleHit || (packetHits[i].t == single.t && packetHits[i].primitive == single.primitive));
+				}
+			}
+		}
+		assert(numHits > 0 && numHits < rays.size());
+	}
+
+	// Degenerate input: all boxes in the same place still produce a valid tree
+	std::vector<AABB> stacked(1000, AABB(Vec3f::zero(), 1.f));
+	BVH stackedBVH;
+	stackedBVH.build(stacked);
+	assert(stackedBVH.nodes().front().bounds.min() == stacked[0].min());
+	assert(stackedBVH.anyHit(Ray(Vec3f(0.f, 0.f, -5.f), Vec3f(0.f, 0.f, 1.f)), tMax));
+}
+
+template<unsigned dim, bool grid>
+void checkKdtree(const std::vector<typename Kdtree<dim, grid>::Point>& points, const std::vector<typename Kdtree<dim, grid>::Point>& queries, rev::core::ThreadPool* pool)
+{
+	using Tree = Kdtree<dim, grid>;
+	using Distance = typename Tree::Distance;
+	auto distanceSq = [](auto& a, auto& b) {
+		Distance result = 0;
+		for (unsigned i = 0; i < dim; ++i)
+			result += (Distance(a[i]) - Distance(b[i])) * (Distance(a[i]) - Distance(b[i]));
+		return result;
+	};
+
+	Tree tree(points, pool);
+	assert(tree.size() == points.size());
+	std::vector<typename Tree::Neighbor> result;
+	std::vector<Distance> expected;
+	const typename Tree::Coordinate radius = 3;
+	for (auto& q : queries)
+	{
+		expected.clear();
+		for (auto& p : points)
+			expected.push_back(distanceSq(p, q));
+		std::sort(expected.begin(), expected.end());
+
+		const size_t k = 10;
+		tree.nearest(q, k, result);
+		assert(result.size() == k);
+		for (size_t i = 0; i < k; ++i)
+		{
+			assert(result[i].distanceSq == expected[i]);
+			assert(distanceSq(points[result[i].index], q) == expected[i]);
+		}
+		assert(distanceSq(points[tree.nearest(q)], q) == expected[0]);
+
+		tree.radiusSearch(q, radius, result);
+		const size_t inside = std::upper_bound(expected.begin(), expected.end(), Distance(radius) * Distance(radius)) - expected.begin();
+		assert(result.size() == inside);
+		for (auto& n : result)
+			assert(distanceSq(points[n.index], q) == n.distanceSq && n.distanceSq <= Distance(radius) * Distance(radius));
+		assert(tree.isFree(q, radius) == (inside == 0));
+	}
+	for (auto& p : points)
+		assert(!tree.isFree(p));
+}
+
+void testKdtree()
+{
+	std::default_random_engine rng;
+	rev::core::ThreadPool pool(3);
+
+	// Scattered points in 3D
+	{
+		std::uniform_real_distribution<float> position(-50.f, 50.f);
+		std::vector<Vec3f> points(40000), queries(200);
+		for (auto& p : points)
+			p = Vec3f(position(rng), position(rng), position(rng));
+		for (auto& q : queries)
+			q = Vec3f(position(rng), position(rng), position(rng));
+		checkKdtree<3, false>(points, queries, nullptr);
+		checkKdtree<3, false>(points, queries, &pool);
+
+		// Sorted input and heavy duplication, worst cases for naive median selection
+		std::sort(points.begin(), points.end(), [](auto& a, auto& b) { return a.x() < b.x(); });
+		for (size_t i = 0; i < points.size(); i += 2)
+			points[i] = points[i / 4];
+		checkKdtree<3, false>(points, queries, &pool);
+	}
+	// Integer grid in 2D, like voxel occupancy
+	{
+		std::uniform_int_distribution<int32_t> cell(-100, 100);
+		std::vector<Vec2i> points(5000), queries(200);
+		for (auto& p : points)
+			p = Vec2i(cell(rng), cell(rng));
+		for (auto& q : queries)
+			q = Vec2i(cell(rng), cell(rng));
+		checkKdtree<2, true>(points, queries, nullptr);
+	}
+	// Empty tree
+	{
+		Kdtree<3, false> tree;
+		std::vector<Kdtree<3, false>::Neighbor> result;
+		tree.nearest(Vec3f::zero(), 3, result);
+		assert(result.empty());
+		assert(tree.isFree(Vec3f::zero(), 1.f));
+	}
+}
+
+// Closed grid sphere, with triangles facing outwards
+void buildSphereMesh(uint32_t rings, uint32_t sectors, std::vector<Vec3f>& positions, std::vector<uint32_t>& indices)
+{
+	for (uint32_t r = 0; r <= rings; ++r)
+	{
+		const float theta = Pi * r / rings;
+		for (uint32_t s = 0; s < sectors; ++s)
+		{
+			const float phi = TwoPi * s / sectors;
+			positions.push_back(Vec3f(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)));
+		}
+	}
+	for (uint32_t r = 0; r < rings; ++r)
+	{
+		for (uint32_t s = 0; s < sectors; ++s)
+		{
+			const uint32_t a = r * sectors + s;
+			const uint32_t b = r * sectors + (s + 1) % sectors;
+			const uint32_t c = a + sectors;
+			const uint32_t d = b + sectors;
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	}
+}
+
+void testMeshlets()
+{
+	std::vector<Vec3f> positions;
+	std::vector<uint32_t> indices;
+	buildSphereMesh(40, 60, positions, indices);
+	// Loose triangles, a degenerate one and a duplicate
+	const auto base = (uint32_t)positions.size();
+	positions.push_back(Vec3f(5.f, 0.f, 0.f));
+	positions.push_back(Vec3f(6.f, 0.f, 0.f));
+	positions.push_back(Vec3f(5.f, 1.f, 0.f));
+	indices.insert(indices.end(), { base, base + 1, base + 2, base, base, base + 1, base, base + 1, base + 2 });
+
+	const auto source = indices;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	buildMeshlets(positions, indices, meshlets, bounds);
+	assert(bounds.size() == meshlets.size());
+	assert(meshlets.size() < source.size() / 3 / 32); // Meshlets should be reasonably full
+
+	// Lossless: the same triangles, with the same winding
+	auto triangleList = [](const std::vector<uint32_t>& idx) {
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < idx.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { idx[i], idx[i + 1], idx[i + 2] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end()); // Canonical rotation keeps winding
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	};
+	assert(triangleList(source) == triangleList(indices));
+
+	// Meshlets are contiguous, within limits, and their bounds contain them
+	uint32_t nextTriangle = 0;
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> viewCoord(-4.f, 4.f);
+	const auto viewFrustum = Frustum(1.f, HalfPi, 0.1f, 100.f);
+	for (size_t m = 0; m < meshlets.size(); ++m)
+	{
+		const auto& meshlet = meshlets[m];
+		assert(meshlet.firstTriangle == nextTriangle);
+		assert(meshlet.numTriangles > 0 && meshlet.numTriangles <= Meshlet::kMaxTriangles);
+		nextTriangle += meshlet.numTriangles;
+
+		std::vector<uint32_t> vertices(indices.begin() + 3 * meshlet.firstTriangle, indices.begin() + 3 * nextTriangle);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		assert(vertices.size() == meshlet.numVertices && meshlet.numVertices <= Meshlet::kMaxVertices);
+
+		const auto& b = bounds[m];
+		for (auto v : vertices)
+			assert(norm(positions[v] - b.center) <= b.radius * 1.0001f);
+
+		// A meshlet culled by its cone must only have back facing triangles
+		for (int i = 0; i < 50; ++i)
+		{
+			const Vec3f viewPoint(viewCoord(rng), viewCoord(rng), viewCoord(rng));
+			// Look at the meshlet, so the frustum never culls it
+			const Vec3f fwd = normalize(b.center - viewPoint);
+			const Vec3f side = normalize(cross(fwd, abs(fwd.y()) < 0.9f ? Vec3f(0.f, 1.f, 0.f) : Vec3f(1.f, 0.f, 0.f)));
+			const Vec3f up = cross(side, fwd);
+			Mat44f viewToWorld = Mat44f::identity();
+			viewToWorld.block<3, 1, 0, 0>() = side;
+			viewToWorld.block<3, 1, 0, 1>() = up;
+			viewToWorld.block<3, 1, 0, 2>() = -fwd;
+			viewToWorld.block<3, 1, 0, 3>() = viewPoint;
+			const auto worldFrustum = viewToWorld * viewFrustum;
+			assert(norm(worldFrustum.origin() - viewPoint) < 1e-3f);
+			if (norm(b.center - viewPoint) <= b.radius + 0.1f || isMeshletVisible(b, worldFrustum, viewPoint))
+				continue;
+
+			for (uint32_t t = meshlet.firstTriangle; t < nextTriangle; ++t)
+			{
+				const Vec3f& p0 = positions[indices[3 * t]];
+				const Vec3f e1 = positions[indices[3 * t + 1]] - p0;
+				const Vec3f e2 = positions[indices[3 * t + 2]] - p0;
+				const Vec3f n = cross(e1, e2);
+				assert(dot(n, viewPoint - p0) <= 0.f);
+			}
+		}
+	}
+	assert(nextTriangle * 3 == indices.size());
+
+	// Seen from the inside, the sphere is fully back facing. Bounds behave the same in another space
+	size_t culledFromOrigin = 0;
+	for (auto& b : bounds)
+	{
+		auto transformed = Mat44f::identity();
+		transformed.block<3, 1, 0, 3>() = Vec3f(1.f, 2.f, 3.f);
+		auto moved = transformed * b;
+		assert(abs(moved.radius - b.radius) < 1e-5f);
+		assert(norm(moved.coneApex - b.coneApex - Vec3f(1.f, 2.f, 3.f)) < 1e-4f);
+		if (b.coneCutoff < 1.f && dot(normalize(b.coneApex), b.coneAxis) >= b.coneCutoff)
+			++culledFromOrigin;
+	}
+	assert(culledFromOrigin > bounds.size() / 2);
+
+	// Rotation and uniform scale keep the cones. Mirroring and non uniform scale drop them
+	Mat44f rotated = Mat44f::identity();
+	rotated(0, 0) = 0.f;
+	rotated(0, 1) = -2.f;
+	rotated(1, 0) = 2.f;
+	rotated(1, 1) = 0.f;
+	rotated(2, 2) = 2.f;
+	assert(preservesNormalCone(rotated));
+	Mat44f mirrored = Mat44f::identity();
+	mirrored(2, 2) = -1.f;
+	assert(!preservesNormalCone(mirrored));
+	Mat44f stretched = Mat44f::identity();
+	stretched(0, 0) = 3.f;
+	assert(!preservesNormalCone(stretched));
+	Mat44f sheared = Mat44f::identity();
+	sheared(0, 1) = 0.5f;
+	assert(!preservesNormalCone(sheared));
+	for (auto& b : bounds)
+	{
+		if (b.coneCutoff >= 1.f)
+			continue;
+		assert((rotated * b).coneCutoff == b.coneCutoff);
+		assert((mirrored * b).coneCutoff == 1.f);
+		assert((stretched * b).coneCutoff == 1.f);
+	}
+}
+
 int main()
 {
 	testAABBTransform();
 	testFrustumCulling();
+	testBatchFrustumCulling();
+	testBVH();
+	testKdtree();
+	testMeshlets();
 	return 0;
 }
\ No newline at end of file
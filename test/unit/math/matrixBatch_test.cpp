@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Math unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <math/algebra/matrixBatch.h>
+#include <math/cpuFeatures.h>
+#include <math/geometry/aabb.h>
+
+using namespace rev::math;
+
+// The SSE kernels multiply and add separately, the AVX2 ones use FMA, so neither matches the scalar code bit for bit
+bool approx(float a, float b)
+{
+	return std::abs(a - b) <= 1e-5f * (1.f + std::abs(b));
+}
+
+bool approx(const Mat44f& a, const Mat44f& b)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			if (!approx(a(i, j), b(i, j)))
+				return false;
+	return true;
+}
+
+bool approx(const Vec3f& a, const Vec3f& b)
+{
+	return approx(a.x(), b.x()) && approx(a.y(), b.y()) && approx(a.z(), b.z());
+}
+
+Mat44f randomMatrix(std::minstd_rand& rng)
+{
+	std::uniform_real_distribution<float> coord(-2.f, 2.f);
+	Mat44f m;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			m(i, j) = coord(rng);
+	return m;
+}
+
+Vec3f randomPoint(std::minstd_rand& rng)
+{
+	std::uniform_real_distribution<float> coord(-10.f, 10.f);
+	return Vec3f(coord(rng), coord(rng), coord(rng));
+}
+
+Vec3f transformPoint(const Mat44f& m, const Vec3f& p)
+{
+	Vec3f r;
+	for (int i = 0; i < 3; ++i)
+		r[i] = m(i, 0) * p.x() + m(i, 1) * p.y() + m(i, 2) * p.z() + m(i, 3);
+	return r;
+}
+
+struct Kernels
+{
+	void (*multiply)(size_t, const Mat44f*, const Mat44f*, Mat44f*);
+	void (*multiplyUniform)(size_t, const Mat44f&, const Mat44f*, Mat44f*);
+	void (*multiplyIndexed)(size_t, const Mat44f*, const uint32_t*, const Mat44f*, Mat44f*);
+	void (*transformPoints)(size_t, const Mat44f&, const Vec3f*, Vec3f*);
+	void (*transformAABBs)(size_t, const Mat44f&, const AABB*, AABB*);
+};
+
+// Odd sizes exercise the single element tail of the 2-wide AVX2 loops
+void testKernels(const Kernels& k)
+{
+	std::minstd_rand rng(1234);
+	for (size_t n : { 0u, 1u, 2u, 7u, 64u })
+	{
+		std::vector<Mat44f> a(n), b(n), out(n);
+		std::vector<uint32_t> indices(n);
+		std::vector<Vec3f> points(n), transformedPoints(n);
+		std::vector<AABB> boxes(n), transformedBoxes(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			a[i] = randomMatrix(rng);
+			b[i] = randomMatrix(rng);
+			indices[i] = uint32_t(rng() % n);
+			points[i] = randomPoint(rng);
+			boxes[i] = AABB(points[i], points[i] + Vec3f(1.f, 2.f, 3.f));
+		}
+		const Mat44f m = randomMatrix(rng);
+
+		k.multiply(n, a.data(), b.data(), out.data());
+		for (size_t i = 0; i < n; ++i)
+			assert(approx(out[i], a[i] * b[i]));
+
+		k.multiplyUniform(n, m, b.data(), out.data());
+		for (size_t i = 0; i < n; ++i)
+			assert(approx(out[i], m * b[i]));
+
+		k.multiplyIndexed(n, a.data(), indices.data(), b.data(), out.data());
+		for (size_t i = 0; i < n; ++i)
+			assert(approx(out[i], a[indices[i]] * b[i]));
+
+		k.transformPoints(n, m, points.data(), transformedPoints.data());
+		for (size_t i = 0; i < n; ++i)
+			assert(approx(transformedPoints[i], transformPoint(m, points[i])));
+
+		k.transformAABBs(n, m, boxes.data(), transformedBoxes.data());
+		for (size_t i = 0; i < n; ++i)
+		{
+			const AABB reference = m * boxes[i];
+			assert(approx(transformedBoxes[i].min(), reference.min()));
+			assert(approx(transformedBoxes[i].max(), reference.max()));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+int main()
+{
+	testKernels({ batchMultiply, batchMultiply, batchMultiply, batchTransformPoints, batchTransformAABBs });
+	testKernels({ sse::batchMultiply, sse::batchMultiply, sse::batchMultiply, sse::batchTransformPoints, sse::batchTransformAABBs });
+	if (cpuFeatures().hasAVX2FMA())
+		testKernels({ avx2::batchMultiply, avx2::batchMultiply, avx2::batchMultiply, avx2::batchTransformPoints, avx2::batchTransformAABBs });
+	return 0;
+}
@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Math unit testing
+//----------------------------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <math/algebra/matrix.h>
+#include <math/algebra/simd8.h>
+#include <math/algebra/vector.h>
+
+using namespace rev::math;
+using namespace rev::math::simd;
+
+// Packs must reproduce the scalar code exactly, so all comparisons are bitwise
+bool bitEqual(float a, float b)
+{
+	return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+bool bitEqual(const Vec3f& a, const Vec3f& b)
+{
+	return bitEqual(a.x(), b.x()) && bitEqual(a.y(), b.y()) && bitEqual(a.z(), b.z());
+}
+
+bool bitEqual(const Vec4f& a, const Vec4f& b)
+{
+	return bitEqual(a.x(), b.x()) && bitEqual(a.y(), b.y()) && bitEqual(a.z(), b.z()) && bitEqual(a.w(), b.w());
+}
+
+std::default_random_engine rng;
+std::uniform_real_distribution<float> reals(-10.f, 10.f);
+
+Vec3f randomVec3()
+{
+	return Vec3f(reals(rng), reals(rng), reals(rng));
+}
+
+Vec4f randomVec4()
+{
+	return Vec4f(reals(rng), reals(rng), reals(rng), reals(rng));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void testFloat8()
+{
+	float src[8] = { 1.f, -2.f, 3.f, -0.f, 5.f, 6.f, -7.f, 8.f };
+	auto a = float8::load(src);
+	for (size_t i = 0; i < 8; ++i)
+		assert(bitEqual(a[i], src[i]));
+
+	// Masks and select
+	auto negative = a < float8(0.f);
+	assert(negative.bits() == ((1 << 1) | (1 << 6)));
+	assert(negative.any());
+	assert(!negative.all());
+	auto clamped = select(negative, float8(0.f), a);
+	for (size_t i = 0; i < 8; ++i)
+		assert(bitEqual(clamped[i], src[i] < 0.f ? 0.f : src[i]));
+
+	// Same NaN behavior as scalar min and max
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	auto withNan = float8(nan);
+	for (size_t i = 0; i < 8; ++i)
+	{
+		assert(bitEqual(min(withNan, a)[i], rev::math::min(nan, src[i])));
+		assert(bitEqual(min(a, withNan)[i], rev::math::min(src[i], nan)));
+		assert(bitEqual(max(withNan, a)[i], rev::math::max(nan, src[i])));
+	}
+
+	// Strided access with partial counts
+	struct Particle { float mass; Vec3f position; };
+	Particle particles[5];
+	for (size_t i = 0; i < 5; ++i)
+		particles[i].mass = float(i);
+	auto masses = float8::gather(&particles[0].mass, sizeof(Particle), 5);
+	for (size_t i = 0; i < 8; ++i)
+		assert(masses[i] == (i < 5 ? float(i) : 0.f));
+	(masses * float8(2.f)).scatter(&particles[0].mass, sizeof(Particle), 5);
+	for (size_t i = 0; i < 5; ++i)
+		assert(particles[i].mass == 2.f * i);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void testVec3f8()
+{
+	for (int iteration = 0; iteration < 100; ++iteration)
+	{
+		Vec3f a[8], b[8];
+		for (size_t i = 0; i < 8; ++i)
+		{
+			a[i] = randomVec3();
+			b[i] = randomVec3();
+		}
+		a[3] = Vec3f(-0.f, 0.f, 1.f); // Signed zeros
+
+		auto pa = Vec3f8::load(a);
+		auto pb = Vec3f8::load(b);
+		const float k = reals(rng);
+
+		auto sum = pa + pb;
+		auto diff = pa - pb;
+		auto scaled = pa * float8(k);
+		auto d = dot(pa, pb);
+		auto c = cross(pa, pb);
+		auto n = normalize(pa);
+		auto lo = min(pa, pb);
+		auto hi = max(pa, pb);
+		auto closer = select(dot(pa, pa) < dot(pb, pb), pa, pb);
+
+		for (size_t i = 0; i < 8; ++i)
+		{
+			assert(bitEqual(pa[i], a[i]));
+			assert(bitEqual(sum[i], Vec3f(a[i] + b[i])));
+			assert(bitEqual(diff[i], Vec3f(a[i] - b[i])));
+			assert(bitEqual(scaled[i], a[i] * k));
+			assert(bitEqual(d[i], dot(a[i], b[i])));
+			assert(bitEqual(c[i], cross(a[i], b[i])));
+			assert(bitEqual(n[i], normalize(a[i])));
+			assert(bitEqual(lo[i], Vec3f(rev::math::min(a[i], b[i]))));
+			assert(bitEqual(hi[i], Vec3f(rev::math::max(a[i], b[i]))));
+			assert(bitEqual(closer[i], dot(a[i], a[i]) < dot(b[i], b[i]) ? a[i] : b[i]));
+		}
+
+		// Round trip through AoS storage
+		Vec3f out[8];
+		c.store(out);
+		for (size_t i = 0; i < 8; ++i)
+			assert(bitEqual(out[i], c[i]));
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void testVec4f8()
+{
+	for (int iteration = 0; iteration < 100; ++iteration)
+	{
+		Vec4f a[8], b[8];
+		for (size_t i = 0; i < 8; ++i)
+		{
+			a[i] = randomVec4();
+			b[i] = randomVec4();
+		}
+
+		auto pa = Vec4f8::load(a);
+		auto pb = Vec4f8::load(b);
+
+		auto sum = pa + pb;
+		auto d = dot(pa, pb);
+		auto n = normalize(pa);
+		auto lo = min(pa, pb);
+		auto hi = max(pa, pb);
+
+		for (size_t i = 0; i < 8; ++i)
+		{
+			assert(bitEqual(sum[i], Vec4f(a[i] + b[i])));
+			assert(bitEqual(d[i], dot(a[i], b[i])));
+			assert(bitEqual(n[i], normalize(a[i])));
+			assert(bitEqual(lo[i], Vec4f(rev::math::min(a[i], b[i]))));
+			assert(bitEqual(hi[i], Vec4f(rev::math::max(a[i], b[i]))));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void testMat44f8()
+{
+	Mat44f m;
+	for (size_t i = 0; i < 16; ++i)
+		m.data()[i] = reals(rng);
+	Mat44f8 pm(m);
+
+	Vec4f v[8];
+	Vec3f p[8];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		v[i] = randomVec4();
+		p[i] = randomVec3();
+	}
+
+	auto mv = pm * Vec4f8::load(v);
+	auto mp = pm.transformPosition(Vec3f8::load(p));
+	auto md = pm.transformDirection(Vec3f8::load(p));
+	for (size_t i = 0; i < 8; ++i)
+	{
+		assert(bitEqual(mv[i], Vec4f(m * v[i])));
+		Vec4f position = m * Vec4f(p[i], 1.f);
+		assert(bitEqual(mp[i], Vec3f(position.x(), position.y(), position.z())));
+		Vec4f direction = m * Vec4f(p[i], 0.f);
+		assert(bitEqual(md[i], Vec3f(direction.x(), direction.y(), direction.z())));
+	}
+}
+
+int main()
+{
+	testFloat8();
+	testVec3f8();
+	testVec4f8();
+	testMat44f8();
+	return 0;
+}